@@ -3,9 +3,31 @@
  *
  * A command-line wrapper for the WSJT-X jt9 decoder engine that supports:
  * - FT2, FT4, and FT8 digital modes
- * - WAV file decoding
- * - Continuous streaming from stdin (PCM audio)
+ * - WAV file decoding, and tar/zip archives of recordings without extraction
+ * - Follow mode: decode a WAV file while it is recorded, tailed with inotify
+ * - Multi-node batch reprocessing through a shared work queue directory
+ * - Continuous streaming from stdin (PCM audio) or an rtl_tcp server
+ * - Supervised capture commands restarted with backoff, audio gaps skipped
  * - Mode-specific cycle timing with UTC alignment
+ * - Optional spectrum/waterfall output computed on the ingest path
+ * - Optional AP hint passes targeting recently heard stations
+ * - Staged cycle pipeline with optional concurrent jt9 workers
+ * - Per-cycle decode yield: synced vs decoded, SNR spread, band occupancy, pass flags
+ * - Online decode-duration cost model fed by cheap pre-decode features
+ * - Shared work-stealing DSP pool with priority lanes and CPU pinning
+ * - Allocation-free steady-state cycle path, with an allocation-counting build
+ * - Host-wide staggering of decode starts across instances sharing a boundary
+ * - jt9 output read and parsed on one epoll thread, off the event loop
+ * - Seeded HF channel simulator (fading, drift, QSB, clicks, crowding) for benchmark audio
+ * - Batch backfill of archive files into idle live decode capacity
+ * - Zero-downtime upgrade by handing the live ring to a new process
+ * - TX-aware cycle skipping and even/odd sequence selection
+ * - Activity-weighted band hopping through a Hamlib rigctld client
+ * - Decode cluster: capture nodes ship cycles to decode nodes over TCP
+ * - Watchlist alerts (callsigns, prefixes, grids, entities, patterns) with hot reload
+ * - MQTT 3.1.1/5.0 publisher with per-cycle batching and a disk spool
+ * - Ingest scalability benchmark with synthetic streams
+ * - Registry of per-run shared memory and temp dirs, swept for dead owners ("gc")
  *
  * Uses Qt's QSharedMemory for IPC with jt9, implementing the same
  * shared memory protocol as WSJT-X.
@@ -28,13 +50,52 @@
 #include <QMutex>
 #include <QWaitCondition>
 #include <QDir>
+#include <QFileInfo>
+#include <QRegularExpression>
 #include <QDateTime>
 #include <QTimer>
 #include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QMap>
+#include <QQueue>
+#include <QVector>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QMetaObject>
+#include <QSocketNotifier>
+#include <QBuffer>
+#include <QSemaphore>
+#include <QSystemSemaphore>
+#include <QPointer>
 #include <cstring>
+#include <cerrno>
 #include <ctime>
 #include <cmath>
 #include <atomic>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <sys/un.h>
+#include <zlib.h>
 
 extern "C" {
 #include "commons.h"
@@ -44,15 +105,8 @@ extern "C" {
 QTextStream qStdErr(stderr);
 QTextStream qStdOut(stdout);
 
-// Read WAV file
-int read_wav_file(const QString &filename, short *audio_data, int max_samples) {
-    QFile file(filename);
-    if (!file.open(QIODevice::ReadOnly)) {
-        qStdErr << "Error: Cannot open file " << filename << "\n";
-        qStdErr.flush();
-        return -1;
-    }
-    
+// Read WAV data from an open device (a file, or an archive member in memory)
+int read_wav(QIODevice &file, short *audio_data, int max_samples, bool verbose = true) {
     QDataStream in(&file);
     in.setByteOrder(QDataStream::LittleEndian);
     
@@ -101,9 +155,9 @@ int read_wav_file(const QString &filename, short *audio_data, int max_samples) {
         if (memcmp(chunk_id, "data", 4) == 0) {
             data_size = chunk_size;
             found_data = true;
-            qStdErr << "Found data chunk, size: " << data_size << " bytes\n";
+            if (verbose) qStdErr << "Found data chunk, size: " << data_size << " bytes\n";
         } else {
-            qStdErr << "Skipping chunk \"" << QString::fromLatin1(chunk_id, 4) << "\" (" << chunk_size << " bytes)\n";
+            if (verbose) qStdErr << "Skipping chunk \"" << QString::fromLatin1(chunk_id, 4) << "\" (" << chunk_size << " bytes)\n";
             file.seek(file.pos() + chunk_size);
         }
     }
@@ -114,11 +168,13 @@ int read_wav_file(const QString &filename, short *audio_data, int max_samples) {
         return -1;
     }
     
-    qStdErr << "WAV file info:\n";
-    qStdErr << "  Sample rate: " << sample_rate << " Hz\n";
-    qStdErr << "  Channels: " << num_channels << "\n";
-    qStdErr << "  Bits per sample: " << bits_per_sample << "\n";
-    qStdErr << "  Data size: " << data_size << " bytes\n";
+    if (verbose) {
+        qStdErr << "WAV file info:\n";
+        qStdErr << "  Sample rate: " << sample_rate << " Hz\n";
+        qStdErr << "  Channels: " << num_channels << "\n";
+        qStdErr << "  Bits per sample: " << bits_per_sample << "\n";
+        qStdErr << "  Data size: " << data_size << " bytes\n";
+    }
     
     int samples_to_read = data_size / sizeof(short);
     if (num_channels == 2) {
@@ -132,7 +188,7 @@ int read_wav_file(const QString &filename, short *audio_data, int max_samples) {
     if (num_channels == 1) {
         // Mono
         int read = in.readRawData((char*)audio_data, samples_to_read * sizeof(short)) / sizeof(short);
-        qStdErr << "  Read " << read << " samples\n";
+        if (verbose) qStdErr << "  Read " << read << " samples\n";
         qStdErr.flush();
         return read;
     } else {
@@ -143,12 +199,64 @@ int read_wav_file(const QString &filename, short *audio_data, int max_samples) {
             if (in.readRawData((char*)stereo_buf, 4) != 4) break;
             audio_data[i] = stereo_buf[0];
         }
-        qStdErr << "  Read " << i << " samples (stereo -> mono)\n";
+        if (verbose) qStdErr << "  Read " << i << " samples (stereo -> mono)\n";
         qStdErr.flush();
         return i;
     }
 }
 
+// Read WAV file
+int read_wav_file(const QString &filename, short *audio_data, int max_samples) {
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qStdErr << "Error: Cannot open file " << filename << "\n";
+        qStdErr.flush();
+        return -1;
+    }
+    return read_wav(file, audio_data, max_samples);
+}
+
+// Write 12 kHz 16-bit mono samples as a WAV file
+bool write_wav_file(const QString &filename, const short *audio_data, int nsamples) {
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qStdErr << "Error: Cannot create file " << filename << "\n";
+        qStdErr.flush();
+        return false;
+    }
+    QDataStream out(&file);
+    out.setByteOrder(QDataStream::LittleEndian);
+    quint32 data_size = nsamples * sizeof(short);
+    out.writeRawData("RIFF", 4);
+    out << quint32(36 + data_size);
+    out.writeRawData("WAVEfmt ", 8);
+    out << quint32(16) << quint16(1) << quint16(1) << quint32(RX_SAMPLE_RATE)
+        << quint32(RX_SAMPLE_RATE * sizeof(short)) << quint16(sizeof(short)) << quint16(16);
+    out.writeRawData("data", 4);
+    out << data_size;
+    for (int i = 0; i < nsamples; i++) {
+        out << qint16(audio_data[i]);
+    }
+    return out.status() == QDataStream::Ok;
+}
+
+// WSJT-X style recording names carry the start time (..._yymmdd_hhmm[ss].wav); otherwise use 'fallback'
+QDateTime utc_from_name(const QString &name, const QDateTime &fallback) {
+    QRegularExpressionMatch m = QRegularExpression("_(\\d{6})_(\\d{4})(\\d{2})?\\d*\\.").match(name);
+    if (m.hasMatch()) {
+        QDate date = QDate::fromString("20" + m.captured(1), "yyyyMMdd");
+        QTime time(m.captured(2).left(2).toInt(), m.captured(2).mid(2).toInt(), m.captured(3).toInt());
+        if (date.isValid() && time.isValid()) return QDateTime(date, time, Qt::UTC);
+    }
+    return fallback.toUTC();
+}
+
+int nutc_from_name(const QString &name, const QDateTime &fallback) {
+    QDateTime utc = utc_from_name(name, fallback);
+    if (!utc.isValid()) return 0;
+    return utc.time().hour() * 100 + utc.time().minute();
+}
+
 // Mode configuration structure
 struct ModeConfig {
     int mode_code;      // jt9 mode code
@@ -163,348 +271,9212 @@ const ModeConfig MODE_FT2  = {52, 3750, 105, 21, "FT2"};   // 3.75 seconds, hsym
 const ModeConfig MODE_FT4  = {5,  7500, 105, 21, "FT4"};   // 7.5 seconds, hsymStop=21
 const ModeConfig MODE_FT8  = {8,  15000, 50, 50, "FT8"};   // 15 seconds, hsymStop=50
 
-// Audio reader thread - continuously reads samples from stdin
-class AudioReaderThread : public QThread {
+qint64 monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Writes a diagnostic from a helper thread; qStdErr belongs to the event loop
+void log_from_thread(const QString &msg) {
+    QMetaObject::invokeMethod(QCoreApplication::instance(), [msg]() {
+        qStdErr << msg;
+        qStdErr.flush();
+    }, Qt::QueuedConnection);
+}
+
+// Priority lanes of the DSP pool: a worker takes ingest work from any queue
+// before it looks at normal work, and best-effort work (spectra) last
+enum DspLane { DSP_INGEST, DSP_NORMAL, DSP_BEST_EFFORT, DSP_LANES };
+static const char *const DSP_LANE_NAMES[DSP_LANES] = { "ingest", "normal", "best_effort" };
+
+// A unit of work for DspPool. The submitter owns it and keeps it alive
+// until run() has returned, so submitting does not allocate.
+class DspTask {
 public:
-    AudioReaderThread(short *buffer, int buffer_size, QMutex *mutex)
-        : circ_buffer(buffer), buffer_size(buffer_size), buffer_mutex(mutex),
-          write_pos(0), total_samples(0), should_stop(false) {}
-    
-    void run() override {
-        FILE *stdin_file = stdin;
-        #ifdef _WIN32
-        _setmode(_fileno(stdin), _O_BINARY);
-        #endif
-        
-        short sample_buf[4096];
-        
-        while (!should_stop) {
-            size_t samples_read = fread(sample_buf, sizeof(short), 4096, stdin_file);
-            
-            if (samples_read == 0) {
-                if (feof(stdin_file) || ferror(stdin_file)) {
-                    break;
+    virtual ~DspTask() {}
+    virtual void run() = 0;
+
+private:
+    friend class DspPool;
+    qint64 queued_ns;
+};
+
+// One process-wide work-stealing pool for in-process DSP stages, so streams
+// share a fixed set of threads instead of each starting its own. Every
+// worker has a fixed ring per lane. A task goes to the worker picked by its
+// affinity hint (one stream's work stays on one worker and its cache) and a
+// worker with nothing of its own steals, highest lane first. Workers can be
+// pinned to CPUs. Queue latency (submit to start) is kept per lane in
+// log-scale buckets.
+class DspPool {
+public:
+    DspPool(int threads, const QList<int> &cpus) : stopping(false), pending(0), outstanding(0), overflows(0) {
+        for (int l = 0; l < DSP_LANES; l++) stats[l].reset();
+        for (int i = 0; i < qMax(1, threads); i++) {
+            Worker *w = new Worker(this, i, cpus.isEmpty() ? -1 : cpus[i % cpus.size()]);
+            workers.push_back(w);
+        }
+        for (Worker *w : workers) w->start();
+    }
+
+    // Queued tasks still run, so owners waiting on them are released
+    ~DspPool() {
+        waitForDone();
+        {
+            QMutexLocker lock(&idle_mutex);
+            stopping = true;
+            for (Worker *w : workers) w->wake.wakeOne();
+        }
+        for (Worker *w : workers) {
+            w->wait();
+            delete w;
+        }
+    }
+
+    // Queue 'task' on 'lane'; tasks with the same 'hint' prefer the same worker.
+    // If every queue is full the task runs on the caller.
+    void submit(DspTask *task, DspLane lane, int hint) {
+        task->queued_ns = monotonic_ns();
+        int n = (int)workers.size();
+        int first = (hint & 0x7fffffff) % n;
+        for (int k = 0; k < n; k++) {
+            Worker *w = workers[(first + k) % n];
+            QMutexLocker lock(&w->mutex);
+            Ring &r = w->queues[lane];
+            if (r.count == RING_SIZE) continue;
+            outstanding.fetch_add(1);
+            r.tasks[(r.head + r.count++) % RING_SIZE] = task;
+            lock.unlock();
+            pending.fetch_add(1);
+            wakeFor(w);
+            return;
+        }
+        overflows++;
+        execute(task, lane, false);
+    }
+
+    // Block until every queued task has run; the worker finishing the last one wakes us
+    void waitForDone() {
+        QMutexLocker lock(&done_mutex);
+        while (outstanding.load() > 0) done.wait(&done_mutex);
+    }
+
+    int threadCount() const { return (int)workers.size(); }
+
+    // Per-lane counts and queue latency since the previous call, e.g.
+    // " ingest_tasks=120 ingest_steals=3 ingest_wait_p50_ms=0.02 ..."
+    QString takeStats() {
+        QString out = QString(" threads=%1 overflows=%2").arg(workers.size()).arg(overflows.load());
+        for (int l = 0; l < DSP_LANES; l++) {
+            LaneStats &s = stats[l];
+            qint64 tasks = s.tasks.exchange(0);
+            out += QString(" %1_tasks=%2 %1_steals=%3 %1_wait_p50_ms=%4 %1_wait_p99_ms=%5 %1_wait_max_ms=%6")
+                .arg(DSP_LANE_NAMES[l]).arg(tasks).arg(s.steals.exchange(0))
+                .arg(s.percentileUs(0.50, tasks) / 1000.0, 0, 'f', 3)
+                .arg(s.percentileUs(0.99, tasks) / 1000.0, 0, 'f', 3)
+                .arg(s.max_us.exchange(0) / 1000.0, 0, 'f', 3);
+            for (int b = 0; b < WAIT_BUCKETS; b++) s.buckets[b] = 0;
+        }
+        return out;
+    }
+
+private:
+    static const int RING_SIZE = 256;
+    static const int WAIT_BUCKETS = 96;    // 2^(b/4) us: up to about 16 s
+
+    struct Ring {
+        Ring() : head(0), count(0) {}
+        DspTask *tasks[RING_SIZE];
+        int head;
+        int count;
+    };
+
+    struct LaneStats {
+        std::atomic<qint64> tasks;
+        std::atomic<qint64> steals;
+        std::atomic<qint64> max_us;
+        std::atomic<qint64> buckets[WAIT_BUCKETS];
+
+        void reset() {
+            tasks = 0;
+            steals = 0;
+            max_us = 0;
+            for (int b = 0; b < WAIT_BUCKETS; b++) buckets[b] = 0;
+        }
+        void record(qint64 us) {
+            tasks++;
+            int b = us <= 1 ? 0 : qMin(WAIT_BUCKETS - 1, (int)(4.0 * log2((double)us)));
+            buckets[b]++;
+            qint64 m = max_us.load();
+            while (us > m && !max_us.compare_exchange_weak(m, us)) {}
+        }
+        // Upper edge of the bucket holding the p-th task
+        double percentileUs(double p, qint64 total) const {
+            qint64 seen = 0;
+            for (int b = 0; b < WAIT_BUCKETS; b++) {
+                seen += buckets[b];
+                if (total > 0 && seen >= p * total) return pow(2.0, (b + 1) / 4.0);
+            }
+            return 0.0;
+        }
+    };
+
+    class Worker : public QThread {
+    public:
+        Worker(DspPool *pool, int index, int cpu) : pool(pool), index(index), cpu(cpu), sleeping(false) {}
+
+        DspPool *pool;
+        int index;
+        int cpu;
+        QMutex mutex;           // guards queues
+        Ring queues[DSP_LANES];
+        QWaitCondition wake;    // with pool->idle_mutex
+        bool sleeping;
+
+    protected:
+        void run() override {
+            if (cpu >= 0) {
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                CPU_SET(cpu, &set);
+                if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+                    log_from_thread(QString("Warning: Cannot pin DSP worker %1 to CPU %2\n").arg(index).arg(cpu));
+                }
+            }
+            pool->workerLoop(this);
+        }
+    };
+
+    // Own queue first, then steal, lane by lane
+    DspTask *take(Worker *self, DspLane &lane, bool &stolen) {
+        int n = (int)workers.size();
+        for (int l = 0; l < DSP_LANES; l++) {
+            for (int k = 0; k < n; k++) {
+                Worker *w = workers[(self->index + k) % n];
+                QMutexLocker lock(&w->mutex);
+                Ring &r = w->queues[l];
+                if (r.count == 0) continue;
+                DspTask *task = r.tasks[r.head];
+                r.head = (r.head + 1) % RING_SIZE;
+                r.count--;
+                lane = (DspLane)l;
+                stolen = k != 0;
+                return task;
+            }
+        }
+        return nullptr;
+    }
+
+    void workerLoop(Worker *self) {
+        while (true) {
+            DspLane lane;
+            bool stolen;
+            DspTask *task = take(self, lane, stolen);
+            if (task) {
+                pending.fetch_sub(1);
+                execute(task, lane, stolen);
+                if (outstanding.fetch_sub(1) == 1) {
+                    QMutexLocker lock(&done_mutex);
+                    done.wakeAll();
                 }
-                QThread::msleep(10);
                 continue;
             }
-            
-            // Lock and copy samples to circular buffer
-            buffer_mutex->lock();
-            for (size_t i = 0; i < samples_read; i++) {
-                circ_buffer[write_pos] = sample_buf[i];
-                write_pos = (write_pos + 1) % buffer_size;
-                total_samples++;
+            QMutexLocker lock(&idle_mutex);
+            if (stopping) return;
+            if (pending.load() > 0) continue;
+            self->sleeping = true;
+            self->wake.wait(&idle_mutex, 100);
+            self->sleeping = false;
+        }
+    }
+
+    void execute(DspTask *task, DspLane lane, bool stolen) {
+        stats[lane].record((monotonic_ns() - task->queued_ns) / 1000);
+        if (stolen) stats[lane].steals++;
+        task->run();
+    }
+
+    // Wake the hinted worker if it sleeps, otherwise any sleeper, which will steal
+    void wakeFor(Worker *preferred) {
+        QMutexLocker lock(&idle_mutex);
+        if (preferred->sleeping) {
+            preferred->wake.wakeOne();
+            return;
+        }
+        for (Worker *w : workers) {
+            if (w->sleeping) {
+                w->wake.wakeOne();
+                return;
             }
-            buffer_mutex->unlock();
         }
     }
-    
-    void stop() { should_stop = true; }
-    qint64 getTotalSamples() { return total_samples.load(); }
-    int getWritePos() { return write_pos.load(); }
-    
-private:
-    short *circ_buffer;
-    int buffer_size;
-    QMutex *buffer_mutex;
-    std::atomic<int> write_pos;
-    std::atomic<qint64> total_samples;
-    std::atomic<bool> should_stop;
-};
 
-// Forward declaration
-class StreamDecoder;
+    std::vector<Worker*> workers;
+    QMutex idle_mutex;
+    bool stopping;
+    std::atomic<int> pending;           // queued, not yet taken
+    std::atomic<int> outstanding;       // queued or running on a worker
+    QMutex done_mutex;
+    QWaitCondition done;                // outstanding reached 0
+    std::atomic<qint64> overflows;
+    LaneStats stats[DSP_LANES];
+};
 
-// Asynchronous stream decoder - matches WSJT-X architecture
-class StreamDecoder : public QObject {
-    Q_OBJECT
-    
+// Self-deleting DspTask for one-off work where one allocation per task is fine
+class FunctionDspTask : public DspTask {
 public:
-    StreamDecoder(QSharedMemory *shm, dec_data_t *dec, QProcess *jt9_proc,
-                  const ModeConfig &mode_cfg, QObject *parent = nullptr)
-        : QObject(parent), sharedMemory(shm), dec_data(dec), jt9(jt9_proc),
-          mode(mode_cfg), decode_in_progress(false), total_decodes(0),
-          skipped_cycles(0), jt9_decode_count(0), watchdog_fires(0)
-    {
-        SAMPLES_PER_CYCLE = (RX_SAMPLE_RATE * mode.cycle_ms) / 1000;
-        BUFFER_SIZE = NTMAX * RX_SAMPLE_RATE;
-        
-        // Allocate circular buffer
-        circ_buffer = new short[BUFFER_SIZE];
-        
-        // Start audio reader thread
-        reader_thread = new AudioReaderThread(circ_buffer, BUFFER_SIZE, &buffer_mutex);
-        reader_thread->start();
-        
-        // Connect jt9 output to our handler (WSJT-X style)
-        connect(jt9, &QProcess::readyReadStandardOutput, this, &StreamDecoder::readFromStdout);
-        
-        // Connect jt9 error/finished signals for health monitoring
-        connect(jt9, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-                this, &StreamDecoder::jt9Finished);
-        connect(jt9, &QProcess::errorOccurred, this, &StreamDecoder::jt9Error);
-        
-        // Timer for cycle boundaries
-        cycle_timer = new QTimer(this);
-        connect(cycle_timer, &QTimer::timeout, this, &StreamDecoder::onCycleTimer);
+    explicit FunctionDspTask(std::function<void()> fn) : fn(fn) {}
+    void run() override {
+        fn();
+        delete this;
+    }
 
-        // Watchdog: resets stuck decode_in_progress if jt9 never sends <DecodeFinished>
-        decode_watchdog = new QTimer(this);
-        decode_watchdog->setSingleShot(true);
-        connect(decode_watchdog, &QTimer::timeout, this, &StreamDecoder::onDecodeWatchdog);
-        
-        qStdErr << "Stream mode: Reading 12kHz 16-bit mono PCM from stdin\n";
-        qStdErr << mode.name << " cycle time: " << mode.cycle_ms << " ms (" << SAMPLES_PER_CYCLE << " samples)\n";
-        qStdErr << "Triggering decodes at UTC-aligned " << (mode.cycle_ms / 1000.0) << " second boundaries\n";
-        qStdErr.flush();
+private:
+    std::function<void()> fn;
+};
+
+// Parses a CPU list such as "0-3,6" for --dsp-cpus
+bool parse_cpu_list(const QString &text, QList<int> &cpus) {
+    for (const QString &part : text.split(',', Qt::SkipEmptyParts)) {
+        bool ok1 = false, ok2 = false;
+        int lo = part.section('-', 0, 0).toInt(&ok1);
+        int hi = part.contains('-') ? part.section('-', 1).toInt(&ok2) : (ok2 = true, lo);
+        if (!ok1 || !ok2 || lo < 0 || hi < lo || hi >= CPU_SETSIZE) return false;
+        for (int c = lo; c <= hi; c++) cpus.append(c);
     }
-    
-    ~StreamDecoder() {
-        if (reader_thread) {
-            reader_thread->stop();
-            reader_thread->wait();
-            delete reader_thread;
-        }
-        delete[] circ_buffer;
+    return !cpus.isEmpty();
+}
+
+// Opens an output that is either a file path (appended to; FIFOs work) or
+// udp:<host>:<port>. Returns the descriptor, or -1.
+static int open_sink(const QString &dest, struct sockaddr_in &udp_addr, bool &udp) {
+    udp = false;
+    if (!dest.startsWith("udp:")) {
+        return ::open(QFile::encodeName(dest).constData(), O_WRONLY | O_CREAT | O_APPEND, 0644);
     }
-    
-    void start() {
-        qStdErr << "Waiting for first cycle boundary...\n";
-        qStdErr.flush();
-        
-        // Wait for enough samples to accumulate
-        while (reader_thread->getTotalSamples() < SAMPLES_PER_CYCLE) {
-            QThread::msleep(100);
-            QCoreApplication::processEvents();
+    QStringList parts = dest.mid(4).split(':');
+    if (parts.size() != 2) return -1;
+    struct addrinfo hints, *res = nullptr;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    if (getaddrinfo(parts[0].toLatin1().constData(), parts[1].toLatin1().constData(), &hints, &res) != 0 || !res) {
+        return -1;
+    }
+    memcpy(&udp_addr, res->ai_addr, sizeof(udp_addr));
+    freeaddrinfo(res);
+    udp = true;
+    return ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+}
+
+// Spectrum record header - one per published row, followed by nbins bytes
+// Each byte is a quantized power level: dB = db_min + code * db_step (dBFS)
+#pragma pack(push, 1)
+struct SpectrumRecordHeader {
+    char magic[4];      // "JT9S"
+    quint8 version;     // record format version (1)
+    quint8 type;        // 'W' = waterfall row, 'A' = averaged spectrum
+    quint16 nbins;      // number of bins that follow
+    qint64 utc_ms;      // UTC time of the newest sample in this record
+    float bin0_hz;      // centre frequency of the first bin
+    float bin_hz;       // bin spacing
+    float db_min;       // level of code 0
+    float db_step;      // dB per code step
+    quint32 frames;     // number of FFT frames averaged into this record
+};
+#pragma pack(pop)
+
+// Real-input FFT of a power-of-two size n through a half-size complex FFT:
+// even and odd samples are packed as real and imaginary parts, transformed
+// with radix-2 butterflies on split arrays, and unpacked per bin on demand.
+// Tables and work arrays are allocated once, so transforms do not allocate.
+class RealFft {
+public:
+    explicit RealFft(int n) : N(n), M(n / 2) {
+        bitrev.resize(M);
+        int bits = 0;
+        while ((1 << bits) < M) bits++;
+        for (int i = 0; i < M; i++) {
+            int r = 0;
+            for (int b = 0; b < bits; b++) {
+                if (i & (1 << b)) r |= 1 << (bits - 1 - b);
+            }
+            bitrev[i] = r;
         }
-        
-        // Calculate time to next cycle boundary
-        qint64 wait_ms = msToNextCycle();
-        if (wait_ms > 100) {
-            qStdErr << "Waiting " << wait_ms << " ms for cycle boundary...\n";
-            qStdErr.flush();
-            QThread::msleep(wait_ms);
+        tw_re.resize(M / 2);
+        tw_im.resize(M / 2);
+        for (int i = 0; i < M / 2; i++) {
+            tw_re[i] = (float)cos(-2.0 * M_PI * i / M);
+            tw_im[i] = (float)sin(-2.0 * M_PI * i / M);
         }
-        
-        qStdErr << "Starting decode loop...\n";
-        qStdErr.flush();
-        
-        // Start cycle timer - triggers at each cycle boundary
-        cycle_timer->start(mode.cycle_ms);
-        
-        // Trigger first decode immediately
-        onCycleTimer();
+        post_re.resize(M);
+        post_im.resize(M);
+        for (int k = 0; k < M; k++) {
+            post_re[k] = (float)cos(-2.0 * M_PI * k / N);
+            post_im[k] = (float)sin(-2.0 * M_PI * k / N);
+        }
+        z_re.resize(M);
+        z_im.resize(M);
     }
-    
-private slots:
-    // Called when jt9 has output ready (WSJT-X style: readFromStdout)
-    void readFromStdout() {
-        while (jt9->canReadLine()) {
-            QString line = QString::fromLocal8Bit(jt9->readLine()).trimmed();
-            
-            // Check for decode finished marker (matching WSJT-X line 6233)
-            if (line.indexOf("<DecodeFinished>") >= 0) {
-                // Extract decode count from <DecodeFinished> line
-                // Format: "<DecodeFinished>   nsynced  ndecoded  navg"
-                // We want the second number (ndecoded)
-                QStringList parts = line.mid(16).trimmed().split(QRegExp("\\s+"), Qt::SkipEmptyParts);
-                if (parts.size() >= 2) {
-                    jt9_decode_count = parts[1].toInt();
-                }
-                decodeDone();  // Call decodeDone like WSJT-X does (line 6244)
-                return;
-            } else if (line.length() > 6 && line[0].isDigit() && !line.startsWith('<')) {
-                // Actual decode line - output to stdout
-                qStdOut << line << "\n";
-                qStdOut.flush();
-            } else if (!line.isEmpty()) {
-                // Debug/diagnostic output
-                qStdErr << "jt9: " << line << "\n";
-                qStdErr.flush();
+
+    int size() const { return N; }
+
+    // Transform x[0..n) weighted by window[0..n)
+    void transform(const float *x, const float *w) {
+        // Window and pack even/odd samples into a half-size complex sequence
+        for (int n = 0; n < M; n++) {
+            int r = bitrev[n];
+            z_re[r] = x[2 * n] * w[2 * n];
+            z_im[r] = x[2 * n + 1] * w[2 * n + 1];
+        }
+
+        // Iterative radix-2 butterflies on split real/imaginary arrays
+        float *re = z_re.data();
+        float *im = z_im.data();
+        for (int len = 2; len <= M; len <<= 1) {
+            int half = len >> 1;
+            int step = M / len;
+            for (int base = 0; base < M; base += len) {
+                for (int j = 0; j < half; j++) {
+                    float wr = tw_re[j * step];
+                    float wi = tw_im[j * step];
+                    int a = base + j;
+                    int b = a + half;
+                    float tr = re[b] * wr - im[b] * wi;
+                    float ti = re[b] * wi + im[b] * wr;
+                    re[b] = re[a] - tr;
+                    im[b] = im[a] - ti;
+                    re[a] += tr;
+                    im[a] += ti;
+                }
             }
         }
     }
-    
-    // Called at each cycle boundary
-    void onCycleTimer() {
-        // Check if jt9 is still running
-        if (jt9->state() != QProcess::Running) {
-            qStdErr << "Error: jt9 process is not running!\n";
-            qStdErr.flush();
-            QCoreApplication::quit();
-            return;
+
+    // |X[k]|^2 of the last transform, 0 <= k < n/2
+    float power(int k) const {
+        const float *re = z_re.data();
+        const float *im = z_im.data();
+        int mk = (M - k) & (M - 1);
+        float er = 0.5f * (re[k] + re[mk]);
+        float ei = 0.5f * (im[k] - im[mk]);
+        float or_ = 0.5f * (im[k] + im[mk]);
+        float oi = -0.5f * (re[k] - re[mk]);
+        float xr = er + post_re[k] * or_ - post_im[k] * oi;
+        float xi = ei + post_re[k] * oi + post_im[k] * or_;
+        return xr * xr + xi * xi;
+    }
+
+private:
+    int N, M;
+    std::vector<int> bitrev;
+    std::vector<float> tw_re, tw_im;
+    std::vector<float> post_re, post_im;
+    std::vector<float> z_re, z_im;
+};
+
+// Ingest-side spectrum monitor - incremental STFT computed on the reader path
+//
+// Samples are appended block by block to a sliding window; every hop (50%
+// overlap) a Hann-windowed real FFT is taken and its power accumulated.
+// Waterfall rows are published at rows_per_sec, averaged spectra every
+// avg_sec, covering only the decoder's frequency range.
+class SpectrumMonitor {
+public:
+    SpectrumMonitor(int fft_size, double rows_per_sec, double avg_sec, int freq_low, int freq_high)
+        : N(fft_size), M(fft_size / 2), fill(0), out_fd(-1), udp(false),
+          row_frames(0), avg_frames(0), row_samples(0), avg_samples(0), rows_published(0), fft(fft_size),
+          pool(nullptr), pending_utc_ms(0), scheduled(false), dropped(0)
+    {
+        task.owner = this;
+        hop = N / 2;
+        row_period = qMax(1, (int)(RX_SAMPLE_RATE / rows_per_sec));
+        avg_period = qMax(1, (int)(RX_SAMPLE_RATE * avg_sec));
+
+        double bin_hz = (double)RX_SAMPLE_RATE / N;
+        first_bin = qBound(0, (int)floor(freq_low / bin_hz), M - 1);
+        last_bin = qBound(first_bin, (int)ceil(freq_high / bin_hz), M - 1);
+        nbins = last_bin - first_bin + 1;
+
+        window.resize(N);
+        double wsum = 0.0;
+        for (int i = 0; i < N; i++) {
+            window[i] = 0.5f - 0.5f * (float)cos(2.0 * M_PI * i / N);
+            wsum += window[i];
         }
-        
-        // Skip this cycle if previous decode still running (matching WSJT-X behavior)
-        if (decode_in_progress) {
-            skipped_cycles++;
-            qStdErr << "Warning: Previous decode still running, skipping this cycle "
-                    << "(total skipped: " << skipped_cycles << ")\n";
-            qStdErr.flush();
+        // Full-scale sine reads 0 dBFS: |X|^2 = (32768 * wsum / 2)^2
+        power_scale = 1.0f / (float)((32768.0 * wsum / 2.0) * (32768.0 * wsum / 2.0));
+
+        frame.resize(N);
+        row_acc.assign(nbins, 0.0f);
+        avg_acc.assign(nbins, 0.0f);
+        codes.resize(sizeof(SpectrumRecordHeader) + nbins);
+    }
+
+    ~SpectrumMonitor() {
+        if (pool) {
+            // A pool task may still be analysing
+            QMutexLocker lock(&pending_mutex);
+            while (scheduled) drained.wait(&pending_mutex);
+        }
+        if (out_fd >= 0) ::close(out_fd);
+    }
+
+    // Destination is either a file path or udp:<host>:<port>
+    bool open(const QString &dest) {
+        out_fd = open_sink(dest, udp_addr, udp);
+        return out_fd >= 0;
+    }
+
+    int binCount() const { return nbins; }
+    double binHz() const { return (double)RX_SAMPLE_RATE / N; }
+    qint64 rowsPublished() const { return rows_published; }
+    qint64 droppedSamples() const { return dropped; }
+
+    // Run the FFTs as best-effort tasks on 'dsp'; the reader thread then only copies samples
+    void setPool(DspPool *dsp) {
+        pool = dsp;
+        pending.reserve(MAX_PENDING);
+        work.reserve(MAX_PENDING);
+    }
+
+    // Called from the reader thread with each freshly read block
+    void addSamples(const short *samples, int count, qint64 utc_ms) {
+        if (!pool) {
+            analyze(samples, count, utc_ms);
             return;
         }
-        
-        // Check if we have enough samples
-        if (reader_thread->getTotalSamples() < SAMPLES_PER_CYCLE) {
-            qStdErr << "Warning: Not enough samples yet (" << reader_thread->getTotalSamples() << " < " << SAMPLES_PER_CYCLE << ")\n";
-            qStdErr.flush();
+        QMutexLocker lock(&pending_mutex);
+        if ((int)pending.size() + count > MAX_PENDING) {
+            // The pool is saturated with more important work; spectra give way
+            dropped += count;
             return;
         }
-        
-        // Mark decode as in progress and arm watchdog (2 full cycles as timeout)
-        decode_in_progress = true;
-        decode_start_ms = getUtcMs();
-        decode_watchdog->start(mode.cycle_ms * 2);
-
-        // Get current UTC time
-        time_t now = time(NULL);
-        struct tm *tm_info = gmtime(&now);
-        int nutc = tm_info->tm_hour * 100 + tm_info->tm_min;
-
-        // Calculate precise time for logging
-        qint64 utc_ms = getUtcMs();
-        qint64 ms_in_minute = utc_ms % 60000;
-        double seconds_in_minute = ms_in_minute / 1000.0;
+        pending.insert(pending.end(), samples, samples + count);
+        pending_utc_ms = utc_ms;
+        if (scheduled) return;
+        scheduled = true;
+        lock.unlock();
+        pool->submit(&task, DSP_BEST_EFFORT, 1);
+    }
 
-        total_decodes++;
-        qStdErr << "Triggering decode #" << total_decodes
-                << " at " << QString("%1").arg(nutc, 4, 10, QChar('0'))
-                << " +" << QString::number(seconds_in_minute, 'f', 3) << "s"
-                << " (" << SAMPLES_PER_CYCLE << " samples)\n";
-        qStdErr.flush();
+private:
+    static const int MAX_PENDING = 2 * RX_SAMPLE_RATE;
 
-        // Copy audio samples directly to shared memory (matching original working version)
-        // No shared memory lock needed for audio data - only buffer_mutex
-        buffer_mutex.lock();
-        int write_pos = reader_thread->getWritePos();
-        int read_start = (write_pos - SAMPLES_PER_CYCLE + BUFFER_SIZE) % BUFFER_SIZE;
+    struct AnalyzeTask : public DspTask {
+        void run() override { owner->drainPending(); }
+        SpectrumMonitor *owner;
+    };
 
-        if (read_start + SAMPLES_PER_CYCLE <= BUFFER_SIZE) {
-            // Contiguous block - copy directly to shared memory
-            memcpy(dec_data->d2, circ_buffer + read_start, SAMPLES_PER_CYCLE * sizeof(short));
-        } else {
-            // Wraps around - copy in two parts directly to shared memory
-            int first_part = BUFFER_SIZE - read_start;
-            memcpy(dec_data->d2, circ_buffer + read_start, first_part * sizeof(short));
-            memcpy(dec_data->d2 + first_part, circ_buffer, (SAMPLES_PER_CYCLE - first_part) * sizeof(short));
+    // Pool thread: analyse everything queued, one batch at a time
+    void drainPending() {
+        while (true) {
+            qint64 utc_ms;
+            {
+                QMutexLocker lock(&pending_mutex);
+                if (pending.empty()) {
+                    scheduled = false;
+                    drained.wakeAll();
+                    return;
+                }
+                pending.swap(work);
+                utc_ms = pending_utc_ms;
+            }
+            analyze(work.data(), (int)work.size(), utc_ms);
+            work.clear();
         }
-        buffer_mutex.unlock();
+    }
 
-        // Lock shared memory to set params and trigger decode atomically
-        // This matches the original working version's approach
-        sharedMemory->lock();
-        dec_data->params.nutc = nutc;
-        dec_data->params.kin = SAMPLES_PER_CYCLE;
-        dec_data->params.newdat = true;
-        dec_data->ipc[0] = mode.ihsym;
-        dec_data->ipc[1] = 1;   // start decode
-        dec_data->ipc[2] = -1;  // not done
+    void analyze(const short *samples, int count, qint64 utc_ms) {
+        while (count > 0) {
+            int take = qMin(count, N - fill);
+            for (int i = 0; i < take; i++) {
+                frame[fill + i] = samples[i];
+            }
+            fill += take;
+            samples += take;
+            count -= take;
+            row_samples += take;
+            avg_samples += take;
+
+            if (fill == N) {
+                computeFrame();
+                // Slide by one hop, keeping the overlapping half
+                memmove(frame.data(), frame.data() + hop, (N - hop) * sizeof(float));
+                fill = N - hop;
+            }
+            if (row_samples >= row_period && row_frames > 0) {
+                publish('W', row_acc, row_frames, utc_ms);
+                row_samples = 0;
+                row_frames = 0;
+            }
+            if (avg_samples >= avg_period && avg_frames > 0) {
+                publish('A', avg_acc, avg_frames, utc_ms);
+                avg_samples = 0;
+                avg_frames = 0;
+            }
+        }
+    }
+
+    void computeFrame() {
+        fft.transform(frame.data(), window.data());
+        for (int i = 0; i < nbins; i++) {
+            float p = fft.power(first_bin + i) * power_scale;
+            row_acc[i] += p;
+            avg_acc[i] += p;
+        }
+        row_frames++;
+        avg_frames++;
+    }
+
+    void publish(char type, std::vector<float> &acc, int frames, qint64 utc_ms) {
+        const float db_min = -150.0f;
+        const float db_step = 0.6f;
+        SpectrumRecordHeader hdr;
+        memcpy(hdr.magic, "JT9S", 4);
+        hdr.version = 1;
+        hdr.type = type;
+        hdr.nbins = nbins;
+        hdr.utc_ms = utc_ms;
+        hdr.bin0_hz = first_bin * (float)binHz();
+        hdr.bin_hz = (float)binHz();
+        hdr.db_min = db_min;
+        hdr.db_step = db_step;
+        hdr.frames = frames;
+        memcpy(codes.data(), &hdr, sizeof(hdr));
+
+        uchar *out = codes.data() + sizeof(hdr);
+        float inv = 1.0f / frames;
+        for (int i = 0; i < nbins; i++) {
+            float db = 10.0f * log10f(acc[i] * inv + 1e-30f);
+            int code = (int)((db - db_min) / db_step + 0.5f);
+            out[i] = (uchar)qBound(0, code, 255);
+            acc[i] = 0.0f;
+        }
+
+        if (udp) {
+            ::sendto(out_fd, codes.data(), codes.size(), 0, (struct sockaddr*)&udp_addr, sizeof(udp_addr));
+        } else if (::write(out_fd, codes.data(), codes.size()) < 0) {
+            return;
+        }
+        if (type == 'W') rows_published++;
+    }
+
+    int N, M, hop;
+    int fill;
+    int out_fd;
+    bool udp;
+    struct sockaddr_in udp_addr;
+    int first_bin, last_bin, nbins;
+    int row_period, avg_period;
+    int row_frames, avg_frames;
+    int row_samples, avg_samples;
+    qint64 rows_published;
+    float power_scale;
+    RealFft fft;
+    std::vector<float> window;
+    std::vector<float> frame;
+    std::vector<float> row_acc, avg_acc;
+    std::vector<uchar> codes;
+
+    DspPool *pool;
+    AnalyzeTask task;
+    QMutex pending_mutex;
+    QWaitCondition drained;
+    std::vector<short> pending;     // read, not yet analysed (guarded by pending_mutex)
+    std::vector<short> work;        // batch being analysed
+    qint64 pending_utc_ms;
+    bool scheduled;                 // task queued or running
+    std::atomic<qint64> dropped;
+};
+
+// Allocation counting (build with -DJT9_ALLOC_COUNT, "make alloc-count").
+// malloc and friends are interposed for the whole process, including Qt, but
+// only count on a thread inside an AllocScope, so only the code the scopes
+// mark is measured: the per-cycle path (ALLOC_CYCLE) and per-decode-line
+// handling (ALLOC_LINE). In a normal build AllocScope is empty.
+enum AllocBucket { ALLOC_CYCLE, ALLOC_LINE, ALLOC_BUCKETS };
+
+#ifdef JT9_ALLOC_COUNT
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void __libc_free(void *ptr);
+}
+
+static __thread int alloc_bucket = -1;
+static std::atomic<qint64> alloc_counts[ALLOC_BUCKETS];
+
+static inline void count_alloc() {
+    if (alloc_bucket >= 0) alloc_counts[alloc_bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+extern "C" void *malloc(size_t size) { count_alloc(); return __libc_malloc(size); }
+extern "C" void *calloc(size_t n, size_t size) { count_alloc(); return __libc_calloc(n, size); }
+extern "C" void *realloc(void *ptr, size_t size) { count_alloc(); return __libc_realloc(ptr, size); }
+extern "C" void *memalign(size_t alignment, size_t size) { count_alloc(); return __libc_memalign(alignment, size); }
+extern "C" void *aligned_alloc(size_t alignment, size_t size) { count_alloc(); return __libc_memalign(alignment, size); }
+extern "C" int posix_memalign(void **out, size_t alignment, size_t size) {
+    count_alloc();
+    *out = __libc_memalign(alignment, size);
+    return *out ? 0 : ENOMEM;
+}
+extern "C" void free(void *ptr) { __libc_free(ptr); }
+
+class AllocScope {
+public:
+    explicit AllocScope(AllocBucket bucket) : saved(alloc_bucket) { alloc_bucket = bucket; }
+    ~AllocScope() { alloc_bucket = saved; }
+    static qint64 count(AllocBucket bucket) { return alloc_counts[bucket].load(std::memory_order_relaxed); }
+    static const bool enabled = true;
+
+private:
+    int saved;
+};
+#else
+class AllocScope {
+public:
+    explicit AllocScope(AllocBucket) {}
+    static qint64 count(AllocBucket) { return 0; }
+    static const bool enabled = false;
+};
+#endif
+
+// Number formatting for LineBuffer
+struct Fixed {
+    Fixed(double value, int precision) : value(value), precision(precision) {}
+    double value;
+    int precision;
+};
+
+struct ZeroPadded {
+    ZeroPadded(qint64 value, int width) : value(value), width(width) {}
+    qint64 value;
+    int width;
+};
+
+// One output line built in a fixed array and written with a single stdio
+// call, for the per-cycle path where QTextStream and QString::number would
+// allocate. Anything past the end is cut off. Callers flush the matching
+// QTextStream first so lines stay in order.
+class LineBuffer {
+public:
+    LineBuffer() : len(0) { buf[0] = '\0'; }
+
+    LineBuffer &operator<<(const char *s) {
+        while (*s && len < CAPACITY - 1) buf[len++] = *s++;
+        buf[len] = '\0';
+        return *this;
+    }
+    LineBuffer &operator<<(const QString &s) {
+        for (QChar c : s) {
+            if (len >= CAPACITY - 1) break;
+            buf[len++] = c.toLatin1();
+        }
+        buf[len] = '\0';
+        return *this;
+    }
+    LineBuffer &operator<<(int v) { return format("%d", v); }
+    LineBuffer &operator<<(qint64 v) { return format("%lld", (long long)v); }
+    LineBuffer &operator<<(const Fixed &f) { return format("%.*f", f.precision, f.value); }
+    LineBuffer &operator<<(const ZeroPadded &z) { return format("%0*lld", z.width, (long long)z.value); }
+
+    void writeTo(FILE *stream) {
+        fwrite(buf, 1, len, stream);
+        fflush(stream);
+        len = 0;
+    }
+
+private:
+    static const int CAPACITY = 2048;
+
+    template<typename... Args> LineBuffer &format(const char *fmt, Args... args) {
+        int n = snprintf(buf + len, CAPACITY - len, fmt, args...);
+        if (n > 0) len = qMin(CAPACITY - 1, len + n);
+        return *this;
+    }
+
+    char buf[CAPACITY];
+    int len;
+};
+
+// Restart and audio gap totals of a supervised capture process
+struct CaptureHealth {
+    int restarts;
+    qint64 gap_ms;          // audio lost to restarts, total
+    qint64 last_gap_ms;
+};
+
+// Producer of 12 kHz 16-bit mono samples for stream mode. readSamples() blocks
+// until samples are available and returns -1 at end of stream; close() may be
+// called from another thread to unblock it.
+class SampleSource {
+public:
+    virtual ~SampleSource() {}
+    virtual bool open() = 0;
+    virtual int readSamples(short *buf, int max_samples) = 0;
+    virtual void close() {}
+    // Undo close() after a handover that failed
+    virtual void resume() {}
+    // Input descriptor a new process can continue reading (-1: it reopens the source)
+    virtual int handoverFd() const { return -1; }
+    virtual int pendingByte() const { return -1; }
+    // Fixed delay between capture and delivery; cycle boundaries are shifted by it
+    virtual int latencyMs() const { return 0; }
+    // Whether audio between these UTC times was lost (e.g. to a capture restart)
+    virtual bool lostAudio(qint64, qint64) const { return false; }
+    // Restart and gap totals, for sources that supervise a capture process
+    virtual bool captureHealth(CaptureHealth &) const { return false; }
+    virtual QString describe() const = 0;
+};
+
+// Raw PCM on stdin (rtl_fm, arecord, sox, ...). Reads with read() rather
+// than stdio so no samples sit in a user-space buffer: on handover the
+// descriptor and any half-read sample are all the next process needs.
+class StdinSource : public SampleSource {
+public:
+    explicit StdinSource(int fd = STDIN_FILENO, int pending_byte = -1)
+        : fd(fd), pending(pending_byte), closed(false) {}
+
+    bool open() override {
+        #ifdef _WIN32
+        _setmode(fd, _O_BINARY);
+        #endif
+        return true;
+    }
         
-        sharedMemory->unlock();
+    int readSamples(short *buf, int max_samples) override {
+        char *bytes = reinterpret_cast<char*>(buf);
+        while (!closed) {
+            // Poll so close() is noticed between reads without losing data
+            struct pollfd pfd = { fd, POLLIN, 0 };
+            int ready = ::poll(&pfd, 1, 100);
+            if (ready < 0 && errno != EINTR) break;
+            if (ready <= 0) continue;
+
+            int have = 0;
+            if (pending >= 0) {
+                bytes[0] = (char)pending;
+                pending = -1;
+                have = 1;
+            }
+            ssize_t n = ::read(fd, bytes + have, max_samples * sizeof(short) - have);
+            if (n < 0 && (errno == EINTR || errno == EAGAIN)) {
+                if (have) pending = (uchar)bytes[0];
+                continue;
+            }
+            if (n <= 0) break;
+
+            int total = have + (int)n;
+            if (total & 1) {
+                pending = (uchar)bytes[total - 1];
+                total--;
+            }
+            if (total > 0) return total / (int)sizeof(short);
+        }
+        return -1;
+    }
         
-        // RETURN IMMEDIATELY - don't wait! (matching WSJT-X line 5651)
-        // jt9 will signal us via readyReadStandardOutput when done
+    void close() override { closed = true; }
+    void resume() override { closed = false; }
+    int handoverFd() const override { return fd; }
+    int pendingByte() const override { return pending; }
+    QString describe() const override {
+        return fd == STDIN_FILENO ? QString("12kHz 16-bit mono PCM from stdin")
+                                  : QString("12kHz 16-bit mono PCM from handed-over input");
+    }
+
+private:
+    int fd;
+    int pending;   // first byte of a sample split across reads, or -1
+    std::atomic<bool> closed;
+};
+
+// Timestamped 8-bit IQ between the network thread and playout.
+//
+// Stream sample k is taken to have been captured at origin + k/rate, where
+// origin is the lowest (arrival - k/rate) over the last two 10 s windows: the
+// least-delayed chunk sets the base latency and everything later is jitter.
+// Playout releases sample k at its capture time plus the buffer depth, so
+// bursts are smoothed out and a late chunk still lands in its slot. Samples
+// that miss their slot are zero-filled (underrun) and dropped when they arrive
+// (late). Playout drifting more than the slack from the stream timeline is
+// resynchronised.
+class IqJitterBuffer {
+public:
+    IqJitterBuffer(int rate, int depth_ms)
+        : rate(rate), depth_us(depth_ms * 1000LL), slack_pairs(rate / 50),
+          storage((size_t)rate * 2 * (2 * depth_ms + 1000) / 1000),
+          underrun_pairs(0), late_pairs(0), overflow_pairs(0), outage_pairs(0), resyncs(0)
+    {
+        reset();
+    }
+
+    // Forget the current stream (after a reconnect the sample count restarts)
+    void reset() {
+        QMutexLocker lock(&mutex);
+        origin_valid = false;
+        received = played = base = 0;
+        head = 0;
+        odd_byte = -1;
+        window_start_us = 0;
+        prev_min_us = cur_min_us = 0;
+    }
+
+    // Network thread: append a chunk as received at arrival_us (monotonic)
+    void push(const uchar *data, int bytes, qint64 arrival_us) {
+        QMutexLocker lock(&mutex);
+        if (odd_byte >= 0 && bytes > 0) {
+            uchar pair[2] = { (uchar)odd_byte, data[0] };
+            odd_byte = -1;
+            append(pair, 1);
+            data++;
+            bytes--;
+        }
+        append(data, bytes / 2);
+        if (bytes & 1) {
+            odd_byte = data[bytes - 1];
+        }
+
+        qint64 offset_us = arrival_us - received * 1000000LL / rate;
+        if (!origin_valid || arrival_us - window_start_us > 10000000LL) {
+            prev_min_us = origin_valid ? cur_min_us : offset_us;
+            cur_min_us = offset_us;
+            window_start_us = arrival_us;
+            origin_valid = true;
+        } else {
+            cur_min_us = qMin(cur_min_us, offset_us);
+        }
+    }
+
+    // Playout: fill out with the next pairs due at now_us (monotonic)
+    void pull(uchar *out, int pairs, qint64 now_us) {
+        QMutexLocker lock(&mutex);
+        if (!origin_valid) {
+            memset(out, 128, (size_t)pairs * 2);
+            outage_pairs += pairs;
+            return;
+        }
+
+        qint64 origin_us = qMin(prev_min_us, cur_min_us);
+        qint64 want_start = (now_us - depth_us - origin_us) * rate / 1000000LL - pairs;
+        int done = 0;
+        if (played > want_start + slack_pairs) {
+            // Ahead of the stream timeline: pad with silence rather than repeat samples
+            done = (int)qMin<qint64>(pairs, played - want_start);
+            memset(out, 128, (size_t)done * 2);
+            if (played > 0) resyncs++;
+        } else if (played < want_start - slack_pairs) {
+            late_pairs += want_start - played;
+            played = want_start;
+            resyncs++;
+        }
+
+        for (; done < pairs; done++, played++) {
+            if (played >= base && played < received) {
+                size_t pos = ((head + (played - base)) % capacity()) * 2;
+                out[done * 2] = storage[pos];
+                out[done * 2 + 1] = storage[pos + 1];
+            } else {
+                out[done * 2] = out[done * 2 + 1] = 128;
+                if (played >= received) underrun_pairs++;
+            }
+        }
+
+        // Release everything already played
+        qint64 release = qMin(played, received) - base;
+        if (release > 0) {
+            head = (head + release) % capacity();
+            base += release;
+        }
+    }
+
+    qint64 underrunPairs() { QMutexLocker lock(&mutex); return underrun_pairs; }
+    qint64 latePairs() { QMutexLocker lock(&mutex); return late_pairs; }
+    qint64 overflowPairs() { QMutexLocker lock(&mutex); return overflow_pairs; }
+    qint64 outagePairs() { QMutexLocker lock(&mutex); return outage_pairs; }
+    qint64 resyncCount() { QMutexLocker lock(&mutex); return resyncs; }
+    int depthMs() const { return (int)(depth_us / 1000); }
+
+private:
+    qint64 capacity() const { return (qint64)storage.size() / 2; }
+
+    void append(const uchar *data, int pairs) {
+        // Pairs whose playout slot has passed are dropped on arrival
+        if (received < played) {
+            int skip = (int)qMin<qint64>(pairs, played - received);
+            late_pairs += skip;
+            received += skip;
+            base = received;
+            data += skip * 2;
+            pairs -= skip;
+        }
+        for (int i = 0; i < pairs; i++) {
+            if (received - base == capacity()) {
+                head = (head + 1) % capacity();
+                base++;
+                overflow_pairs++;
+            }
+            size_t pos = ((head + (received - base)) % capacity()) * 2;
+            storage[pos] = data[i * 2];
+            storage[pos + 1] = data[i * 2 + 1];
+            received++;
+        }
+    }
+
+    QMutex mutex;
+    int rate;
+    qint64 depth_us;
+    qint64 slack_pairs;
+    std::vector<uchar> storage;   // ring of IQ pairs [base, received)
+    qint64 head;                  // storage index of pair 'base'
+    qint64 received, played, base;
+    int odd_byte;
+    bool origin_valid;
+    qint64 window_start_us, prev_min_us, cur_min_us;
+    qint64 underrun_pairs, late_pairs, overflow_pairs, outage_pairs, resyncs;
+};
+
+// Upper-sideband demodulator: 8-bit IQ at 'rate' to 12 kHz audio.
+//
+// The LO sits offset_hz below the dial frequency. The 0-6 kHz audio passband
+// is mixed down to -3..+3 kHz, low-passed and decimated to 24 kHz, then
+// low-passed at 3 kHz and decimated to 12 kHz complex. Multiplying by j^n
+// shifts the passband back up to 0-6 kHz and the real part is the audio.
+// The second filter's skirt (about 440 Hz) sets the opposite-sideband
+// rejection, so audio is clean from roughly 220 Hz to 5.8 kHz.
+class UsbDemodulator {
+public:
+    UsbDemodulator(int rate, int offset_hz)
+        : decim1(rate / 24000), n_out(0), phase_re(1.0), phase_im(0.0), level(0.0), pos1(0), pos2(0), count1(0), count2(0)
+    {
+        for (int i = 0; i < 256; i++) {
+            to_float[i] = (i - 127.5f) / 128.0f;
+        }
+        double w = -2.0 * M_PI * (offset_hz + 3000.0) / rate;
+        step_re = cos(w);
+        step_im = sin(w);
+
+        // Stage 1 only has to keep 21-27 kHz out of the 24 kHz output
+        int taps1 = qMax(31, (int)(5.5 * rate / 18000.0)) | 1;
+        design(taps1, 12000.0 / rate, fir1);
+        design(301, 3000.0 / 24000.0, fir2);
+        hist1_re.assign(fir1.size() * 2, 0.0f);
+        hist1_im.assign(fir1.size() * 2, 0.0f);
+        hist2_re.assign(fir2.size() * 2, 0.0f);
+        hist2_im.assign(fir2.size() * 2, 0.0f);
+    }
+
+    // Converts pairs IQ pairs; returns the number of audio samples written
+    int process(const uchar *iq, int pairs, short *audio) {
+        int n = 0;
+        for (int i = 0; i < pairs; i++) {
+            float x_re = to_float[iq[i * 2]];
+            float x_im = to_float[iq[i * 2 + 1]];
+            float m_re = (float)(x_re * phase_re - x_im * phase_im);
+            float m_im = (float)(x_re * phase_im + x_im * phase_re);
+            double p_re = phase_re * step_re - phase_im * step_im;
+            phase_im = phase_re * step_im + phase_im * step_re;
+            phase_re = p_re;
+
+            push(hist1_re, hist1_im, pos1, m_re, m_im);
+            if (++count1 < decim1) continue;
+            count1 = 0;
+
+            float a_re, a_im;
+            filter(fir1, hist1_re, hist1_im, pos1, a_re, a_im);
+            push(hist2_re, hist2_im, pos2, a_re, a_im);
+            if (++count2 < 2) continue;
+            count2 = 0;
+
+            float b_re, b_im;
+            filter(fir2, hist2_re, hist2_im, pos2, b_re, b_im);
+            float y;
+            switch (n_out++ & 3) {
+            case 0: y = b_re; break;
+            case 1: y = -b_im; break;
+            case 2: y = -b_re; break;
+            default: y = b_im; break;
+            }
+            audio[n++] = agc(y);
+        }
+
+        // Keep the rotating phasor on the unit circle
+        double mag = sqrt(phase_re * phase_re + phase_im * phase_im);
+        phase_re /= mag;
+        phase_im /= mag;
+        return n;
+    }
+
+private:
+    // Blackman-windowed sinc low-pass, cutoff as a fraction of the sample rate
+    static void design(int taps, double cutoff, std::vector<float> &h) {
+        h.resize(taps);
+        double sum = 0.0;
+        for (int i = 0; i < taps; i++) {
+            double m = i - (taps - 1) / 2.0;
+            double sinc = m == 0.0 ? 2.0 * cutoff : sin(2.0 * M_PI * cutoff * m) / (M_PI * m);
+            double win = 0.42 - 0.5 * cos(2.0 * M_PI * i / (taps - 1)) + 0.08 * cos(4.0 * M_PI * i / (taps - 1));
+            h[i] = (float)(sinc * win);
+            sum += h[i];
+        }
+        for (int i = 0; i < taps; i++) {
+            h[i] = (float)(h[i] / sum);
+        }
+    }
+
+    // History is stored twice so the newest 'taps' samples are always contiguous
+    static void push(std::vector<float> &re, std::vector<float> &im, int &pos, float x_re, float x_im) {
+        int taps = (int)re.size() / 2;
+        pos = pos == 0 ? taps - 1 : pos - 1;
+        re[pos] = re[pos + taps] = x_re;
+        im[pos] = im[pos + taps] = x_im;
+    }
+
+    static void filter(const std::vector<float> &h, const std::vector<float> &re, const std::vector<float> &im,
+                       int pos, float &y_re, float &y_im) {
+        float acc_re = 0.0f, acc_im = 0.0f;
+        const float *r = &re[pos];
+        const float *q = &im[pos];
+        for (size_t k = 0; k < h.size(); k++) {
+            acc_re += h[k] * r[k];
+            acc_im += h[k] * q[k];
+        }
+        y_re = acc_re;
+        y_im = acc_im;
+    }
+
+    // Slow AGC (about 5 s) holding the audio near 1000 RMS; fast enough to follow
+    // band conditions, too slow to pump on individual signals
+    short agc(float y) {
+        level += (y * y - level) * (1.0 / 60000.0);
+        double gain = level > 1e-12 ? 1000.0 / sqrt(level) : 1000.0;
+        double v = y * qMin(gain, 1e6);
+        return (short)qBound(-32767.0, v, 32767.0);
+    }
+
+    int decim1;
+    qint64 n_out;
+    float to_float[256];
+    double step_re, step_im;
+    double phase_re, phase_im;
+    double level;
+    std::vector<float> fir1, fir2;
+    std::vector<float> hist1_re, hist1_im, hist2_re, hist2_im;
+    int pos1, pos2;
+    int count1, count2;
+};
+
+// Connects to host:port with a timeout; returns a blocking socket or -1
+static int tcp_connect(const QString &host, const QString &port, int timeout_ms, QString &error) {
+    struct addrinfo hints, *res = nullptr;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host.toLatin1().constData(), port.toLatin1().constData(), &hints, &res) != 0 || !res) {
+        error = QString("cannot resolve %1").arg(host);
+        return -1;
+    }
+
+    int fd = ::socket(res->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    bool ok = fd >= 0;
+    if (ok && ::connect(fd, res->ai_addr, res->ai_addrlen) != 0) {
+        ok = false;
+        if (errno == EINPROGRESS) {
+            struct pollfd pfd = { fd, POLLOUT, 0 };
+            int so_error = 0;
+            socklen_t len = sizeof(so_error);
+            ok = ::poll(&pfd, 1, timeout_ms) == 1 &&
+                 getsockopt(fd, SOL_SOCKET, SO_ERROR, &so_error, &len) == 0 && so_error == 0;
+        }
+    }
+    freeaddrinfo(res);
+    if (!ok) {
+        error = QString("cannot connect to %1:%2").arg(host, port);
+        if (fd >= 0) ::close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+    return fd;
+}
+
+struct RtlTcpConfig {
+    QString host;
+    QString port;
+    qint64 dial_hz;
+    int rate;
+    int gain_tenths;     // < 0: tuner AGC
+    int ppm;
+    int jitter_ms;
+};
+
+// Network side of the rtl_tcp source: connects, configures the tuner with
+// rtl_tcp commands and feeds timestamped IQ into the jitter buffer.
+// Reconnects with exponential backoff when the server goes away or stalls.
+class RtlTcpReceiver : public QThread {
+public:
+    static const int IF_OFFSET_HZ = 25000;   // keeps the passband clear of the DC spike
+
+    RtlTcpReceiver(const RtlTcpConfig &cfg, IqJitterBuffer *jitter)
+        : cfg(cfg), jitter(jitter), should_stop(false), connected(false), connections(0) {}
+
+    void run() override {
+        int backoff_ms = 1000;
+        std::vector<uchar> buf(65536);
+
+        while (!should_stop) {
+            QString error;
+            int fd = connectToServer(error);
+            if (fd < 0) {
+                log_from_thread(QString("rtl_tcp: %1, retrying in %2 s\n").arg(error).arg(backoff_ms / 1000));
+                for (int waited = 0; waited < backoff_ms && !should_stop; waited += 100) {
+                    QThread::msleep(100);
+                }
+                backoff_ms = qMin(backoff_ms * 2, 30000);
+                continue;
+            }
+            
+            jitter->reset();
+            connected = true;
+            connections++;
+            backoff_ms = 1000;
+
+            int idle_ms = 0;
+            while (!should_stop) {
+                ssize_t n = ::recv(fd, buf.data(), buf.size(), 0);
+                if (n > 0) {
+                    jitter->push(buf.data(), (int)n, monotonic_ns() / 1000);
+                    idle_ms = 0;
+                } else if (n == 0) {
+                    error = "server closed the connection";
+                    break;
+                } else if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                    idle_ms += RECV_TIMEOUT_MS;
+                    if (idle_ms >= STALL_TIMEOUT_MS) {
+                        error = QString("no data for %1 s").arg(STALL_TIMEOUT_MS / 1000);
+                        break;
+                    }
+                } else {
+                    error = QString::fromLocal8Bit(strerror(errno));
+                    break;
+                }
+            }
+            ::close(fd);
+            connected = false;
+            jitter->reset();
+            if (!should_stop) {
+                log_from_thread(QString("rtl_tcp: connection lost (%1), reconnecting\n").arg(error));
+            }
+        }
+    }
+
+    void stop() { should_stop = true; }
+    void restart() {
+        should_stop = false;
+        start();
+    }
+    bool isConnected() const { return connected; }
+    int connectionCount() const { return connections; }
+
+private:
+    static const int CONNECT_TIMEOUT_MS = 5000;
+    static const int RECV_TIMEOUT_MS = 1000;
+    static const int STALL_TIMEOUT_MS = 5000;
+
+    int connectToServer(QString &error) {
+        int fd = tcp_connect(cfg.host, cfg.port, CONNECT_TIMEOUT_MS, error);
+        if (fd < 0) return -1;
+
+        // Receive timeout so stop() is noticed
+        struct timeval tv = { RECV_TIMEOUT_MS / 1000, (RECV_TIMEOUT_MS % 1000) * 1000 };
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+        // Dongle info: "RTL0", tuner type, gain count (big-endian)
+        uchar header[12];
+        int got = 0;
+        while (got < 12) {
+            ssize_t n = ::recv(fd, header + got, 12 - got, 0);
+            if (n <= 0) break;
+            got += (int)n;
+        }
+        if (got < 12 || memcmp(header, "RTL0", 4) != 0) {
+            error = QString("%1:%2 is not an rtl_tcp server").arg(cfg.host, cfg.port);
+            ::close(fd);
+            return -1;
+        }
+
+        qint64 lo_hz = cfg.dial_hz - IF_OFFSET_HZ;
+        bool ok_cmd = sendCommand(fd, 0x02, (quint32)cfg.rate) &&
+                      sendCommand(fd, 0x01, (quint32)lo_hz) &&
+                      sendCommand(fd, 0x05, (quint32)cfg.ppm) &&
+                      sendCommand(fd, 0x03, cfg.gain_tenths < 0 ? 0 : 1) &&
+                      (cfg.gain_tenths < 0 || sendCommand(fd, 0x04, (quint32)cfg.gain_tenths));
+        if (!ok_cmd) {
+            error = "cannot send tuner commands";
+            ::close(fd);
+            return -1;
+        }
+
+        log_from_thread(QString("rtl_tcp: connected to %1:%2 (tuner type %3, %4 gains), LO %5 Hz, %6 S/s, gain %7\n")
+                        .arg(cfg.host, cfg.port)
+                        .arg(read_be32(header + 4)).arg(read_be32(header + 8))
+                        .arg(lo_hz).arg(cfg.rate)
+                        .arg(cfg.gain_tenths < 0 ? QString("auto") : QString::number(cfg.gain_tenths / 10.0) + " dB"));
+        return fd;
+    }
+
+    // rtl_tcp command: one byte opcode followed by a big-endian 32-bit parameter
+    static bool sendCommand(int fd, uchar cmd, quint32 param) {
+        uchar msg[5] = { cmd, (uchar)(param >> 24), (uchar)(param >> 16), (uchar)(param >> 8), (uchar)param };
+        return ::send(fd, msg, sizeof(msg), MSG_NOSIGNAL) == (ssize_t)sizeof(msg);
+    }
+
+    static quint32 read_be32(const uchar *p) {
+        return ((quint32)p[0] << 24) | ((quint32)p[1] << 16) | ((quint32)p[2] << 8) | p[3];
+    }
+
+    RtlTcpConfig cfg;
+    IqJitterBuffer *jitter;
+    std::atomic<bool> should_stop;
+    std::atomic<bool> connected;
+    std::atomic<int> connections;
+};
+
+// Built-in replacement for "rtl_tcp client | rtl_fm | jt9_decode -s": IQ from
+// an rtl_tcp server goes through the jitter buffer and USB demodulator
+// straight into the stream ring. Playout is paced by the local clock, so the
+// ring keeps advancing (with silence) while the server is unreachable.
+class RtlTcpSource : public SampleSource {
+public:
+    explicit RtlTcpSource(const RtlTcpConfig &cfg)
+        : cfg(cfg), jitter(cfg.rate, cfg.jitter_ms), demod(cfg.rate, RtlTcpReceiver::IF_OFFSET_HZ),
+          receiver(cfg, &jitter), iq_per_sample(cfg.rate / RX_SAMPLE_RATE),
+          start_us(0), produced(0), closed(false) {}
+
+    ~RtlTcpSource() {
+        close();
+        receiver.wait();
+        qint64 per_ms = cfg.rate / 1000;
+        qStdErr << "rtl_tcp: " << receiver.connectionCount() << " connection(s), "
+                << "underrun " << jitter.underrunPairs() / per_ms << " ms, "
+                << "late " << jitter.latePairs() / per_ms << " ms, "
+                << "overflow " << jitter.overflowPairs() / per_ms << " ms, "
+                << "outage " << jitter.outagePairs() / per_ms << " ms, "
+                << jitter.resyncCount() << " resync(s)\n";
+        qStdErr.flush();
+    }
+
+    bool open() override {
+        receiver.start();
+        return true;
+    }
+
+    int readSamples(short *buf, int max_samples) override {
+        while (!closed) {
+            qint64 now_us = monotonic_ns() / 1000;
+            if (start_us == 0) start_us = now_us;
+            qint64 due = (now_us - start_us) * RX_SAMPLE_RATE / 1000000LL - produced;
+            if (due < PLAYOUT_BLOCK) {
+                QThread::msleep(PLAYOUT_BLOCK * 1000 / RX_SAMPLE_RATE);
+                continue;
+            }
+            int n = (int)qMin<qint64>(due, qMin(max_samples, 1200));
+            int pairs = n * iq_per_sample;
+            iq.resize((size_t)pairs * 2);
+            jitter.pull(iq.data(), pairs, now_us);
+            int out = demod.process(iq.data(), pairs, buf);
+            produced += n;
+            return out;
+        }
+        return -1;
+    }
+
+    void close() override {
+        closed = true;
+        receiver.stop();
+    }
+
+    void resume() override {
+        receiver.wait();
+        closed = false;
+        receiver.restart();
+    }
+
+    int latencyMs() const override { return jitter.depthMs(); }
+
+    QString describe() const override {
+        return QString("rtl_tcp %1:%2, USB at %3 Hz dial, %4 S/s IQ, %5 ms jitter buffer")
+            .arg(cfg.host, cfg.port).arg(cfg.dial_hz).arg(cfg.rate).arg(cfg.jitter_ms);
+    }
+
+private:
+    static const int PLAYOUT_BLOCK = 240;   // 20 ms of audio
+
+    RtlTcpConfig cfg;
+    IqJitterBuffer jitter;
+    UsbDemodulator demod;
+    RtlTcpReceiver receiver;
+    int iq_per_sample;
+    std::vector<uchar> iq;
+    qint64 start_us;
+    qint64 produced;
+    std::atomic<bool> closed;
+};
+
+// Built-in replacement for "capture | jt9_decode -s": runs the capture command
+// (rtl_fm, arecord, sox, ...) under /bin/sh and reads its stdout through a pipe
+// it owns. When the command exits or stops producing output it is restarted
+// with exponential backoff. Until audio flows again the ring is fed silence at
+// the sample rate, so it stays aligned with the clock, and the outage is kept
+// as a UTC gap: cycles overlapping it are skipped rather than decoded.
+class CaptureSource : public SampleSource {
+public:
+    explicit CaptureSource(const QString &command)
+        : command(command), shell_cmd(command.toLocal8Bit()), fd(-1), pid(-1), pending(-1),
+          spawn_ns(0), respawn_ns(0), last_data_ns(0), backoff_ms(MIN_BACKOFF_MS), spawned(false),
+          gap_open(false), gap_start_ns(0), gap_samples(0), closed(false),
+          restarts(0), gap_total_ms(0), last_gap_ms(0) {}
+
+    ~CaptureSource() {
+        if (pid > 0) reap(true);
+        if (fd >= 0) ::close(fd);
+        qStdErr << "capture: " << restarts.load() << " restart(s), " << gap_total_ms.load()
+                << " ms of audio lost\n";
+        qStdErr.flush();
+    }
+
+    bool open() override { return true; }
+
+    int readSamples(short *buf, int max_samples) override {
+        char *bytes = reinterpret_cast<char*>(buf);
+        while (!closed) {
+            qint64 now_ns = monotonic_ns();
+            if (pid < 0 && now_ns >= respawn_ns) spawn(now_ns);
+            if (fd < 0) {
+                int n = silence(buf, max_samples, now_ns);
+                if (n > 0) return n;
+                QThread::msleep(20);
+                continue;
+            }
+
+            struct pollfd pfd = { fd, POLLIN, 0 };
+            int ready = ::poll(&pfd, 1, 20);
+            if (ready < 0 && errno != EINTR) {
+                lost(QString("poll failed (%1)").arg(QString::fromLocal8Bit(strerror(errno))), false);
+                continue;
+            }
+            if (ready <= 0) {
+                if (now_ns - last_data_ns > STALL_TIMEOUT_MS * 1000000LL) {
+                    lost(QString("no output for %1 s").arg(STALL_TIMEOUT_MS / 1000), true);
+                    continue;
+                }
+                int n = silence(buf, max_samples, now_ns);
+                if (n > 0) return n;
+                continue;
+            }
+
+            int have = 0;
+            if (pending >= 0) {
+                bytes[0] = (char)pending;
+                pending = -1;
+                have = 1;
+            }
+            ssize_t n = ::read(fd, bytes + have, max_samples * sizeof(short) - have);
+            if (n < 0 && (errno == EINTR || errno == EAGAIN)) {
+                if (have) pending = (uchar)bytes[0];
+                continue;
+            }
+            if (n <= 0) {
+                lost(n == 0 ? QString("exited") : QString::fromLocal8Bit(strerror(errno)), false);
+                continue;
+            }
+
+            int total = have + (int)n;
+            if (total & 1) {
+                pending = (uchar)bytes[total - 1];
+                total--;
+            }
+            if (total > 0) {
+                last_data_ns = monotonic_ns();
+                if (gap_open) closeGap();
+                return total / (int)sizeof(short);
+            }
+        }
+        // Stopped (exit or handover): the command goes with the reader
+        if (pid > 0) reap(true);
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+        return -1;
+    }
+
+    void close() override { closed = true; }
+
+    void resume() override {
+        respawn_ns = 0;
+        closed = false;
+    }
+
+    bool lostAudio(qint64 from_ms, qint64 to_ms) const override {
+        QMutexLocker lock(&gaps_mutex);
+        for (int i = 0; i < gaps.size(); i++) {
+            qint64 end_ms = gaps[i].second > 0 ? gaps[i].second : to_ms;
+            if (gaps[i].first < to_ms && end_ms >= from_ms) return true;
+        }
+        return false;
+    }
+
+    bool captureHealth(CaptureHealth &h) const override {
+        h.restarts = restarts.load();
+        h.gap_ms = gap_total_ms.load();
+        h.last_gap_ms = last_gap_ms.load();
+        return true;
+    }
+
+    QString describe() const override {
+        return QString("12kHz 16-bit mono PCM from capture command: %1").arg(command);
+    }
+
+private:
+    static const int MIN_BACKOFF_MS = 1000;
+    static const int MAX_BACKOFF_MS = 30000;
+    static const int STALL_TIMEOUT_MS = 10000;
+    static const int HEALTHY_RUN_MS = 60000;  // a command that ran this long restarts from the minimum backoff
+    static const int MAX_GAPS = 16;
+
+    static qint64 utcNowMs() {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000LL;
+    }
+
+    void spawn(qint64 now_ns) {
+        int fds[2];
+        if (pipe2(fds, O_CLOEXEC) != 0) {
+            scheduleRestart(QString("cannot create pipe (%1)").arg(QString::fromLocal8Bit(strerror(errno))), now_ns);
+            return;
+        }
+        pid_t child = fork();
+        if (child < 0) {
+            ::close(fds[0]);
+            ::close(fds[1]);
+            scheduleRestart(QString("cannot fork (%1)").arg(QString::fromLocal8Bit(strerror(errno))), now_ns);
+            return;
+        }
+        if (child == 0) {
+            // Only async-signal-safe calls between fork and exec
+            sigset_t none;
+            sigemptyset(&none);
+            sigprocmask(SIG_SETMASK, &none, nullptr);
+            signal(SIGPIPE, SIG_DFL);
+            setpgid(0, 0);
+            prctl(PR_SET_PDEATHSIG, SIGTERM);
+            int null_fd = ::open("/dev/null", O_RDONLY);
+            if (null_fd >= 0) dup2(null_fd, STDIN_FILENO);
+            dup2(fds[1], STDOUT_FILENO);
+            execl("/bin/sh", "sh", "-c", shell_cmd.constData(), (char*)nullptr);
+            _exit(127);
+        }
+        ::close(fds[1]);
+        fd = fds[0];
+        pid = child;
+        pending = -1;
+        spawn_ns = now_ns;
+        last_data_ns = now_ns;
+        if (spawned) {
+            restarts++;
+            log_from_thread(QString("capture: restarted (restart %1)\n").arg(restarts.load()));
+        } else {
+            log_from_thread(QString("capture: started '%1' (pid %2)\n").arg(command).arg(child));
+        }
+        spawned = true;
+    }
+
+    // The command's output ended (or stalled): reap it and open a gap
+    void lost(const QString &why, bool stalled) {
+        ::close(fd);
+        fd = -1;
+        QString status = reap(stalled);
+        qint64 now_ns = monotonic_ns();
+        if (now_ns - spawn_ns >= HEALTHY_RUN_MS * 1000000LL) backoff_ms = MIN_BACKOFF_MS;
+        scheduleRestart(status.isEmpty() ? why : QString("%1, %2").arg(why, status), now_ns);
+    }
+
+    // Audio is lost from now until the restarted command delivers again
+    void scheduleRestart(const QString &why, qint64 now_ns) {
+        if (!gap_open && spawned) openGap(now_ns);
+        log_from_thread(QString("capture: %1, restarting in %2 s\n").arg(why).arg(backoff_ms / 1000));
+        respawn_ns = now_ns + backoff_ms * 1000000LL;
+        backoff_ms = qMin(backoff_ms * 2, (int)MAX_BACKOFF_MS);
+    }
+
+    // Waits for the command to exit: a grace period (skipped when it must be
+    // stopped), then SIGTERM, then SIGKILL to its process group. Returns how it ended.
+    QString reap(bool terminate) {
+        int status = 0;
+        pid_t done = 0;
+        for (int step = terminate ? 1 : 0; step < 3 && done == 0; step++) {
+            if (step > 0) ::kill(-pid, step == 1 ? SIGTERM : SIGKILL);
+            for (int waited = 0; waited < 1000; waited += 20) {
+                done = waitpid(pid, &status, WNOHANG);
+                if (done != 0) break;
+                QThread::msleep(20);
+            }
+        }
+        if (done == 0) done = waitpid(pid, &status, 0);
+        pid = -1;
+        if (done < 0) return QString();
+        if (WIFEXITED(status)) return QString("exit status %1").arg(WEXITSTATUS(status));
+        if (WIFSIGNALED(status)) return QString("killed by signal %1").arg(WTERMSIG(status));
+        return QString();
+    }
+
+    // Silence standing in for lost audio, paced by the clock
+    int silence(short *buf, int max_samples, qint64 now_ns) {
+        if (!gap_open) return 0;
+        qint64 due = (now_ns - gap_start_ns) * RX_SAMPLE_RATE / 1000000000LL - gap_samples;
+        if (due < RX_SAMPLE_RATE / 50) return 0;
+        int n = (int)qMin<qint64>(due, max_samples);
+        memset(buf, 0, n * sizeof(short));
+        gap_samples += n;
+        return n;
+    }
+
+    void openGap(qint64 now_ns) {
+        gap_open = true;
+        gap_start_ns = now_ns;
+        gap_samples = 0;
+        QMutexLocker lock(&gaps_mutex);
+        if (gaps.size() >= MAX_GAPS) gaps.removeFirst();
+        gaps.append(qMakePair(utcNowMs(), (qint64)0));
+    }
+
+    void closeGap() {
+        gap_open = false;
+        qint64 end_ms = utcNowMs();
+        qint64 len_ms;
+        {
+            QMutexLocker lock(&gaps_mutex);
+            gaps.last().second = end_ms;
+            len_ms = end_ms - gaps.last().first;
+        }
+        last_gap_ms = len_ms;
+        gap_total_ms += len_ms;
+        log_from_thread(QString("capture: audio back after a %1 ms gap\n").arg(len_ms));
+    }
+
+    QString command;
+    QByteArray shell_cmd;
+    int fd;                    // read end of the command's stdout pipe, or -1
+    pid_t pid;
+    int pending;               // first byte of a sample split across reads, or -1
+    qint64 spawn_ns;
+    qint64 respawn_ns;
+    qint64 last_data_ns;
+    int backoff_ms;
+    bool spawned;
+    bool gap_open;
+    qint64 gap_start_ns;
+    qint64 gap_samples;        // silence fed to the ring during the open gap
+    std::atomic<bool> closed;
+
+    mutable QMutex gaps_mutex;
+    QVector<QPair<qint64, qint64>> gaps;   // UTC ms start, end (0 while open)
+    std::atomic<int> restarts;
+    std::atomic<qint64> gap_total_ms;
+    std::atomic<qint64> last_gap_ms;
+};
+
+// A WAV file that a recorder is still writing, tailed into the stream ring.
+// The header is parsed once the recorder has written it; from then on the
+// data chunk is read up to the current end of the file whenever inotify
+// reports a write, starting early enough in the audio already there that the
+// cycle in progress is decoded whole. Recorders usually write placeholder chunk
+// sizes and fix them up when they finish, so a declared data size only bounds
+// the read (keeping trailing chunks out of the audio). The file is finalized
+// when the writer has closed it and all declared data was read, when it is
+// renamed or deleted, or when it stops growing for the idle timeout.
+class WavFollowSource : public SampleSource {
+public:
+    WavFollowSource(const QString &path, int cycle_ms, int idle_s)
+        : path(path), cycle_ms(cycle_ms), idle_s(idle_s), fd(-1), notify_fd(-1), header_ok(false), channels(1),
+          data_start(0), start_pos(0), read_pos(0), last_growth_ns(0), writer_closed(false), writer_gone(false),
+          closed(false) {}
+
+    ~WavFollowSource() {
+        if (notify_fd >= 0) ::close(notify_fd);
+        if (fd >= 0) ::close(fd);
+    }
+
+    bool open() override {
+        fd = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            qStdErr << "Error: Cannot open " << path << ": " << strerror(errno) << "\n";
+            qStdErr.flush();
+            return false;
+        }
+        notify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (notify_fd < 0 || inotify_add_watch(notify_fd, QFile::encodeName(path).constData(),
+                                               IN_MODIFY | IN_CLOSE_WRITE | IN_MOVE_SELF | IN_DELETE_SELF) < 0) {
+            qStdErr << "Warning: inotify unavailable for " << path << " (" << strerror(errno)
+                    << "), checking for new data every 100 ms\n";
+            qStdErr.flush();
+        }
+        last_growth_ns = monotonic_ns();
+        return true;
+    }
+
+    int readSamples(short *buf, int max_samples) override {
+        while (!closed) {
+            if (!header_ok) {
+                QString error;
+                int state = parseHeader(error);
+                if (state < 0) {
+                    log_from_thread(QString("Error: %1: %2\n").arg(path, error));
+                    return -1;
+                }
+            }
+            if (header_ok) {
+                int n = readData(buf, max_samples);
+                if (n < 0) return -1;
+                if (n > 0) return n;
+            }
+
+            // Nothing new: finished, or wait for the writer
+            bool finalized = writer_gone || (header_ok && writer_closed && declaredEnd() >= 0 &&
+                                             read_pos + channels * (qint64)sizeof(short) > declaredEnd());
+            if (finalized || (idle_s > 0 && monotonic_ns() - last_growth_ns > idle_s * 1000000000LL)) {
+                log_from_thread(QString("%1: %2, %3 s of audio followed\n")
+                                .arg(path)
+                                .arg(finalized ? QString("recording finished") : QString("no new data for %1 s").arg(idle_s))
+                                .arg(followedSeconds(), 0, 'f', 1));
+                return -1;
+            }
+            waitForWrite();
+        }
+        return -1;
+    }
+
+    void close() override { closed = true; }
+    void resume() override { closed = false; }
+
+    QString describe() const override {
+        return QString("12kHz 16-bit PCM followed from %1 as it is written").arg(path);
+    }
+
+private:
+    static const int MAX_HEADER = 65536;
+
+    // 1: header parsed, 0: not all written yet, -1: unusable
+    int parseHeader(QString &error) {
+        std::vector<uchar> head(MAX_HEADER);
+        ssize_t got = ::pread(fd, head.data(), head.size(), 0);
+        if (got < 12) return 0;
+        if (memcmp(head.data(), "RIFF", 4) != 0 || memcmp(head.data() + 8, "WAVE", 4) != 0) {
+            error = "not a WAV file";
+            return -1;
+        }
+        bool have_fmt = false;
+        for (qint64 pos = 12; pos + 8 <= got; ) {
+            const uchar *chunk = head.data() + pos;
+            quint32 size = chunk[4] | (chunk[5] << 8) | (chunk[6] << 16) | ((quint32)chunk[7] << 24);
+            if (memcmp(chunk, "data", 4) == 0) {
+                if (!have_fmt) {
+                    error = "data chunk before fmt chunk";
+                    return -1;
+                }
+                data_start = pos + 8;
+                header_ok = true;
+                startAtCycle();
+                return 1;
+            }
+            if (memcmp(chunk, "fmt ", 4) == 0) {
+                if (pos + 8 + 16 > got) return 0;
+                quint16 format = chunk[8] | (chunk[9] << 8);
+                channels = chunk[10] | (chunk[11] << 8);
+                quint32 rate = chunk[12] | (chunk[13] << 8) | (chunk[14] << 16) | ((quint32)chunk[15] << 24);
+                quint16 bits = chunk[22] | (chunk[23] << 8);
+                if ((format != 1 && format != 0xFFFE) || bits != 16 || rate != RX_SAMPLE_RATE ||
+                    channels < 1 || channels > 2) {
+                    error = QString("need 12000 Hz 16-bit PCM, mono or stereo (file: %1 Hz, %2-bit, %3 channel(s))")
+                                .arg(rate).arg(bits).arg(channels);
+                    return -1;
+                }
+                have_fmt = true;
+            }
+            pos += 8 + size + (size & 1);
+        }
+        if (got == (ssize_t)head.size()) {
+            error = QString("no data chunk in the first %1 bytes").arg(MAX_HEADER);
+            return -1;
+        }
+        return 0;
+    }
+
+    // Start from the audio already written, taking its end as now, so the cycle in
+    // progress is decoded whole: one cycle before its boundary, which fills the ring
+    // the decoder waits for before the first boundary
+    void startAtCycle() {
+        struct stat st;
+        qint64 end = fstat(fd, &st) == 0 ? (qint64)st.st_size : data_start;
+        qint64 declared = declaredEnd();
+        if (declared >= 0 && declared < end) end = declared;
+        qint64 frame = channels * (qint64)sizeof(short);
+        qint64 frames = qMax<qint64>(0, (end - data_start) / frame);
+        qint64 into_cycle = QDateTime::currentMSecsSinceEpoch() % cycle_ms;
+        frames = qMax<qint64>(0, frames - (into_cycle + cycle_ms) * RX_SAMPLE_RATE / 1000);
+        read_pos = data_start + frames * frame;
+        log_from_thread(QString("%1: following from %2 s into the recording (%3)\n")
+                        .arg(path).arg(followedSecondsAt(read_pos), 0, 'f', 1)
+                        .arg(channels == 2 ? QString("left channel") : QString("mono")));
+        start_pos = read_pos;
+    }
+
+    // End of the data chunk by its declared size, or -1 while it is a placeholder
+    qint64 declaredEnd() const {
+        uchar size_le[4];
+        if (::pread(fd, size_le, 4, data_start - 4) != 4) return -1;
+        quint32 size = size_le[0] | (size_le[1] << 8) | (size_le[2] << 16) | ((quint32)size_le[3] << 24);
+        if (size == 0 || size >= 0x7FFFF000u) return -1;
+        return data_start + size;
+    }
+
+    // Whole frames between the read position and the end of the data
+    int readData(short *buf, int max_samples) {
+        struct stat st;
+        if (fstat(fd, &st) != 0) return -1;
+        qint64 end = st.st_size;
+        qint64 declared = declaredEnd();
+        if (declared >= 0 && declared < end) end = declared;
+        qint64 frame = channels * (qint64)sizeof(short);
+        qint64 frames = qMin<qint64>((end - read_pos) / frame, max_samples);
+        if (frames <= 0) return 0;
+
+        ssize_t got;
+        if (channels == 1) {
+            got = ::pread(fd, buf, frames * frame, read_pos);
+        } else {
+            stereo.resize((size_t)frames * 2);
+            got = ::pread(fd, stereo.data(), frames * frame, read_pos);
+        }
+        if (got < 0) return errno == EINTR ? 0 : -1;
+        int n = (int)(got / frame);
+        if (channels == 2) {
+            for (int i = 0; i < n; i++) buf[i] = stereo[2 * i];
+        }
+        read_pos += n * frame;
+        if (n > 0) last_growth_ns = monotonic_ns();
+        return n;
+    }
+
+    // Block until the file changes (or 100 ms pass, so close() is noticed)
+    void waitForWrite() {
+        if (notify_fd < 0) {
+            QThread::msleep(100);
+            return;
+        }
+        struct pollfd pfd = { notify_fd, POLLIN, 0 };
+        if (::poll(&pfd, 1, 100) <= 0) return;
+        char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+        ssize_t len;
+        while ((len = ::read(notify_fd, events, sizeof(events))) > 0) {
+            for (char *p = events; p < events + len; ) {
+                const struct inotify_event *ev = reinterpret_cast<const struct inotify_event*>(p);
+                if (ev->mask & IN_CLOSE_WRITE) writer_closed = true;
+                if (ev->mask & (IN_MOVE_SELF | IN_DELETE_SELF)) writer_gone = true;
+                p += sizeof(struct inotify_event) + ev->len;
+            }
+        }
+    }
+
+    double followedSecondsAt(qint64 pos) const {
+        return (double)(pos - data_start) / (channels * sizeof(short)) / RX_SAMPLE_RATE;
+    }
+    double followedSeconds() const {
+        return (double)(read_pos - start_pos) / (channels * sizeof(short)) / RX_SAMPLE_RATE;
+    }
+
+    QString path;
+    int cycle_ms;
+    int idle_s;                // 0: wait for the writer indefinitely
+    int fd;
+    int notify_fd;
+    bool header_ok;
+    int channels;
+    qint64 data_start;         // file offset of the first sample
+    qint64 start_pos;          // where following began
+    qint64 read_pos;
+    qint64 last_growth_ns;
+    bool writer_closed;        // a writer closed the file (it may reopen it)
+    bool writer_gone;          // renamed or deleted
+    std::vector<short> stereo;
+    std::atomic<bool> closed;
+};
+
+// Stream ring buffer backed by a memfd, so a running instance can hand the
+// ring (and the audio already in it) to a new process
+struct SharedRing {
+    int fd = -1;
+    short *samples = nullptr;
+    int size = 0;
+
+    bool create(int n) {
+        fd = memfd_create("jt9_decode_ring", MFD_CLOEXEC);
+        if (fd >= 0 && ftruncate(fd, (off_t)n * sizeof(short)) != 0) {
+            ::close(fd);
+            fd = -1;
+        }
+        if (fd >= 0) return attach(fd, n);
+
+        // No memfd: plain anonymous memory, the ring just cannot be handed over
+        size = n;
+        void *p = mmap(nullptr, (size_t)n * sizeof(short), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        samples = p == MAP_FAILED ? nullptr : static_cast<short*>(p);
+        return samples != nullptr;
+    }
+
+    bool attach(int ring_fd, int n) {
+        fd = ring_fd;
+        size = n;
+        void *p = mmap(nullptr, (size_t)n * sizeof(short), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) {
+            release();
+            return false;
+        }
+        samples = static_cast<short*>(p);
+        return true;
+    }
+
+    void release() {
+        if (samples) munmap(samples, (size_t)size * sizeof(short));
+        if (fd >= 0) ::close(fd);
+        samples = nullptr;
+        fd = -1;
+    }
+};
+
+// Live stream state sent to a new process on --take-over, together with the
+// ring memfd, stdout and (for stdin sources) the input descriptor as SCM_RIGHTS
+struct HandoverState {
+    char magic[4];              // "JT9H"
+    quint32 version;
+    qint32 ring_size;           // samples
+    qint32 write_pos;
+    qint64 total_samples;
+    qint64 newest_utc_ms;       // capture time of the sample before write_pos
+    qint64 last_boundary_ms;    // boundary of the last cycle the old process triggered
+    qint32 next_cycle_num;
+    qint32 pending_byte;        // half-read input sample, or -1
+    qint32 nfds;                // ring, stdout[, input]
+} __attribute__((packed));
+
+static const quint32 HANDOVER_VERSION = 1;
+
+bool send_with_fds(int sock, const void *data, size_t len, const int *fds, int nfds) {
+    struct iovec iov = { const_cast<void*>(data), len };
+    char control[CMSG_SPACE(sizeof(int) * 4)];
+    memset(control, 0, sizeof(control));
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = CMSG_SPACE(sizeof(int) * nfds);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * nfds);
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * nfds);
+    return ::sendmsg(sock, &msg, MSG_NOSIGNAL) == (ssize_t)len;
+}
+
+bool recv_with_fds(int sock, void *data, size_t len, int *fds, int max_fds, int &nfds) {
+    struct iovec iov = { data, len };
+    char control[CMSG_SPACE(sizeof(int) * 4)];
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    nfds = 0;
+    if (::recvmsg(sock, &msg, MSG_WAITALL | MSG_CMSG_CLOEXEC) != (ssize_t)len) return false;
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            int n = (int)((cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+            memcpy(fds, CMSG_DATA(cmsg), sizeof(int) * qMin(n, max_fds));
+            nfds = qMin(n, max_fds);
+        }
+    }
+    return true;
+}
+
+int unix_socket_address(const QString &path, struct sockaddr_un &addr) {
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    QByteArray p = QFile::encodeName(path);
+    if (p.size() >= (int)sizeof(addr.sun_path)) return -1;
+    memcpy(addr.sun_path, p.constData(), p.size());
+    return ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+}
+
+// New-process side of a handover: ask the instance listening on path for its
+// live state. fds receives the ring memfd, stdout and optionally the input.
+bool take_over(const QString &path, HandoverState &state, int *fds, int &nfds) {
+    struct sockaddr_un addr;
+    int sock = unix_socket_address(path, addr);
+    if (sock < 0) return false;
+    struct timeval tv = { 10, 0 };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    static const char request[] = "HANDOVER 1\n";
+    bool ok = ::connect(sock, (struct sockaddr*)&addr, sizeof(addr)) == 0 &&
+              ::send(sock, request, sizeof(request) - 1, MSG_NOSIGNAL) == (ssize_t)(sizeof(request) - 1) &&
+              recv_with_fds(sock, &state, sizeof(state), fds, 3, nfds) &&
+              memcmp(state.magic, "JT9H", 4) == 0 && state.version == HANDOVER_VERSION &&
+              nfds == state.nfds && nfds >= 2;
+    ::close(sock);
+    if (!ok) {
+        for (int i = 0; i < nfds; i++) ::close(fds[i]);
+        nfds = 0;
+    }
+    return ok;
+}
+
+// Audio reader thread - continuously reads samples from the stream source.
+//
+// Blocks are capped at the configured block latency, so a source that
+// delivers in large bursts still reaches the ring a block at a time. Each
+// block is stamped on arrival. Reader lag is how late a block's newest sample
+// arrives against the sample clock, whose origin is the lowest
+// (arrival - samples/rate) over the last two 10 s windows: the earliest block
+// sets the base and anything later is buffering or scheduling delay upstream.
+class AudioReaderThread : public QThread {
+public:
+    static const int MAX_BLOCK = 4096;
+
+    AudioReaderThread(SampleSource *source, short *buffer, int buffer_size, QMutex *mutex,
+                      SpectrumMonitor *spectrum = nullptr)
+        : source(source), circ_buffer(buffer), buffer_size(buffer_size), buffer_mutex(mutex), spectrum(spectrum),
+          block_samples(RX_SAMPLE_RATE / 50), write_pos(0), total_samples(0), should_stop(false),
+          last_arrival_ns(0), max_lag_us(0) {}
+    
+    // Largest block handed to the ring, in ms of audio (before start())
+    void setBlockMs(int ms) { block_samples = qBound(1, ms * RX_SAMPLE_RATE / 1000, (int)MAX_BLOCK); }
+    int blockMs() const { return block_samples * 1000 / RX_SAMPLE_RATE; }
+
+    void run() override {
+        short sample_buf[MAX_BLOCK];
+        bool origin_valid = false;
+        qint64 window_start_us = 0, cur_min_us = 0, prev_min_us = 0;
+        
+        while (!should_stop) {
+            int samples_read = source->readSamples(sample_buf, block_samples);
+            if (samples_read < 0) {
+                break;
+            }
+            qint64 arrival_ns = monotonic_ns();
+            struct timespec arrival_ts;
+            clock_gettime(CLOCK_REALTIME, &arrival_ts);
+            
+            // Lock and copy samples to circular buffer
+            buffer_mutex->lock();
+            for (int i = 0; i < samples_read; i++) {
+                circ_buffer[write_pos] = sample_buf[i];
+                write_pos = (write_pos + 1) % buffer_size;
+                total_samples++;
+            }
+            qint64 total = total_samples.load();
+            buffer_mutex->unlock();
+            last_arrival_ns = arrival_ns;
+
+            // Sample clock origin, from the two most recent windows
+            qint64 arrival_us = arrival_ns / 1000;
+            qint64 offset_us = arrival_us - total * 1000000LL / RX_SAMPLE_RATE;
+            if (!origin_valid || arrival_us - window_start_us > 10000000LL) {
+                prev_min_us = origin_valid ? cur_min_us : offset_us;
+                cur_min_us = offset_us;
+                window_start_us = arrival_us;
+                origin_valid = true;
+            }
+            cur_min_us = qMin(cur_min_us, offset_us);
+            qint64 lag_us = offset_us - qMin(prev_min_us, cur_min_us);
+            qint64 m = max_lag_us.load();
+            while (lag_us > m && !max_lag_us.compare_exchange_weak(m, lag_us)) {}
+
+            // Spectrum runs outside the ring lock so cycle extraction never waits on it
+            if (spectrum) {
+                qint64 utc_ms = arrival_ts.tv_sec * 1000LL + arrival_ts.tv_nsec / 1000000LL - source->latencyMs();
+                spectrum->addSamples(sample_buf, samples_read, utc_ms);
+            }
+        }
+    }
+    
+    void stop() {
+        should_stop = true;
+        source->close();
+    }
+    qint64 getTotalSamples() { return total_samples.load(); }
+    int getWritePos() { return write_pos.load(); }
+    // Monotonic time the newest block reached the ring (0 before the first)
+    qint64 lastArrivalNs() const { return last_arrival_ns.load(); }
+    // Worst reader lag since the previous call
+    qint64 takeMaxLagUs() { return max_lag_us.exchange(0); }
+    
+    // Continue a ring written by another process (before start())
+    void resumeAt(int pos, qint64 total) {
+        write_pos = pos;
+        total_samples = total;
+    }
+    
+private:
+    SampleSource *source;
+    short *circ_buffer;
+    int buffer_size;
+    QMutex *buffer_mutex;
+    SpectrumMonitor *spectrum;
+    int block_samples;
+    std::atomic<int> write_pos;
+    std::atomic<qint64> total_samples;
+    std::atomic<bool> should_stop;
+    std::atomic<qint64> last_arrival_ns;
+    std::atomic<qint64> max_lag_us;
+};
+
+// Fields of one jt9 decode line: "HHMMSS SNR DT FREQ ~ MESSAGE [flags]"
+struct DecodeRecord {
+    int utc;            // HHMMSS
+    int snr;            // dB
+    double dt;          // seconds
+    int freq;           // audio offset in Hz
+    QString message;    // message text without trailing jt9 flags
+    QString flags;      // trailing jt9 annotation such as "a2" or "?"
+};
+
+bool parse_decode_line(const QString &line, DecodeRecord &rec) {
+    QStringList parts = line.split(' ', Qt::SkipEmptyParts);
+    if (parts.size() < 6) return false;
+
+    bool ok_utc, ok_snr, ok_dt, ok_freq;
+    rec.utc = parts[0].toInt(&ok_utc);
+    rec.snr = parts[1].toInt(&ok_snr);
+    rec.dt = parts[2].toDouble(&ok_dt);
+    rec.freq = parts[3].toInt(&ok_freq);
+    if (!ok_utc || !ok_snr || !ok_dt || !ok_freq) return false;
+
+    // parts[4] is the mode marker (~ FT8, + FT4/FT2); jt9 appends a 2-char annotation
+    rec.flags.clear();
+    int last = parts.size() - 1;
+    const QString &tail = parts[last];
+    if (last > 5 && (tail == "?" || (tail.length() == 2 && tail[0] == 'a' && tail[1].isDigit()))) {
+        rec.flags = tail;
+        last--;
+    }
+    rec.message = parts.mid(5, last - 4).join(' ');
+    return !rec.message.isEmpty();
+}
+
+// Decode yield of one cycle, or of several merged: jt9's synced and decoded
+// counts plus the SNR spread, band occupancy and pass flags of the decodes
+// themselves. Fixed arrays only, so it lives in per-cycle state without
+// allocating.
+struct DecodeYield {
+    static const int SNR_LOW = -30;
+    static const int SNR_HIGH = 30;
+    static const int SNR_BANDS = 6;        // <=-21, -20..-16, -15..-11, -10..-6, -5..-1, >=0
+    static const int OCC_BIN_HZ = 200;
+    static const int OCC_BINS = 32;        // 0-6400 Hz
+
+    int cycles;
+    qint64 nsynced;
+    qint64 ndecoded;         // as counted by jt9 (main pass)
+    qint64 decodes;          // decode lines seen, hint passes included
+    qint64 ap_decodes;       // flagged a1-a7: needed a-priori information
+    qint64 lowconf_decodes;  // flagged '?'
+    qint64 snr_counts[SNR_HIGH - SNR_LOW + 1];
+    qint64 occupancy[OCC_BINS];
+
+    DecodeYield() { reset(); }
+
+    void reset() {
+        cycles = 0;
+        nsynced = ndecoded = decodes = ap_decodes = lowconf_decodes = 0;
+        for (qint64 &c : snr_counts) c = 0;
+        for (qint64 &c : occupancy) c = 0;
+    }
+
+    void add(const DecodeRecord &rec) {
+        decodes++;
+        snr_counts[qBound(SNR_LOW, rec.snr, SNR_HIGH) - SNR_LOW]++;
+        if (rec.freq >= 0) occupancy[qMin(OCC_BINS - 1, rec.freq / OCC_BIN_HZ)]++;
+        if (rec.flags.startsWith('a')) ap_decodes++;
+        else if (rec.flags.startsWith('?')) lowconf_decodes++;
+    }
+
+    void finish(int synced, int decoded) {
+        cycles++;
+        nsynced += synced;
+        ndecoded += decoded;
+    }
+
+    void merge(const DecodeYield &other) {
+        cycles += other.cycles;
+        nsynced += other.nsynced;
+        ndecoded += other.ndecoded;
+        decodes += other.decodes;
+        ap_decodes += other.ap_decodes;
+        lowconf_decodes += other.lowconf_decodes;
+        for (int i = 0; i <= SNR_HIGH - SNR_LOW; i++) snr_counts[i] += other.snr_counts[i];
+        for (int i = 0; i < OCC_BINS; i++) occupancy[i] += other.occupancy[i];
+    }
+
+    // Decoded share of synced candidates; low values with many candidates mean a starved pass
+    double yield() const { return nsynced > 0 ? (double)ndecoded / nsynced : 0.0; }
+
+    int snrPercentile(double p) const {
+        qint64 seen = 0;
+        for (int i = 0; i <= SNR_HIGH - SNR_LOW; i++) {
+            seen += snr_counts[i];
+            if (seen > 0 && seen >= p * decodes) return SNR_LOW + i;
+        }
+        return 0;
+    }
+
+    // " nsynced=.. yield=.. snr_min=.. ... occ=.." for the bins inside [nfa, nfb)
+    void write(LineBuffer &out, int nfa, int nfb) const {
+        out << " nsynced=" << nsynced
+            << " yield=" << Fixed(yield(), 2)
+            << " ap_decodes=" << ap_decodes
+            << " lowconf_decodes=" << lowconf_decodes;
+        if (decodes > 0) {
+            out << " snr_min=" << snrPercentile(0.0)
+                << " snr_med=" << snrPercentile(0.5)
+                << " snr_max=" << snrPercentile(1.0);
+        }
+        static const int BAND_TOP[SNR_BANDS] = { -21, -16, -11, -6, -1, SNR_HIGH };
+        out << " snr_hist=";
+        int i = 0;
+        for (int b = 0; b < SNR_BANDS; b++) {
+            qint64 n = 0;
+            for (; i <= BAND_TOP[b] - SNR_LOW; i++) n += snr_counts[i];
+            out << (b ? "," : "") << n;
+        }
+        int first = qBound(0, nfa / OCC_BIN_HZ, OCC_BINS - 1);
+        int last = qBound(first, (nfb - 1) / OCC_BIN_HZ, OCC_BINS - 1);
+        int occupied = 0;
+        for (int b = first; b <= last; b++) occupied += occupancy[b] > 0 ? 1 : 0;
+        out << " occ_bins=" << occupied << "/" << (last - first + 1) << " occ=";
+        for (int b = first; b <= last; b++) out << (b > first ? "," : "") << occupancy[b];
+    }
+};
+
+// What one line of jt9 output is
+enum Jt9LineKind { JT9_BLANK, JT9_DECODE, JT9_FINISHED, JT9_DIAGNOSTIC };
+
+// Classifies one raw jt9 output line in place, without allocating. 'start'
+// and 'len' are trimmed; for JT9_FINISHED the counts are filled in.
+static Jt9LineKind parse_jt9_line(char *&start, int &len, int &nsynced, int &ndecoded) {
+    char *end = start + len;
+    while (start < end && isspace((unsigned char)*start)) start++;
+    while (end > start && isspace((unsigned char)end[-1])) end--;
+    len = int(end - start);
+
+    // Check for decode finished marker (matching WSJT-X line 6233)
+    static const char MARKER[] = "<DecodeFinished>";
+    if (len >= (int)sizeof(MARKER) - 1 && memcmp(start, MARKER, sizeof(MARKER) - 1) == 0) {
+        // Format: "<DecodeFinished>   nsynced  ndecoded  navg"
+        char save = *end;
+        *end = '\0';
+        char *p = start + sizeof(MARKER) - 1;
+        nsynced = (int)strtol(p, &p, 10);
+        ndecoded = (int)strtol(p, &p, 10);
+        *end = save;
+        return JT9_FINISHED;
+    }
+    if (len > 6 && isdigit((unsigned char)start[0])) return JT9_DECODE;
+    return len > 0 ? JT9_DIAGNOSTIC : JT9_BLANK;
+}
+
+// QProcess that hands the child's stdout and stderr to a pipe of ours
+class Jt9Process : public QProcess {
+public:
+    Jt9Process() : output_fd(-1) {}
+    void redirectOutput(int fd) { output_fd = fd; }
+
+protected:
+    void setupChildProcess() override {
+        if (output_fd >= 0) {
+            dup2(output_fd, STDOUT_FILENO);
+            dup2(output_fd, STDERR_FILENO);
+        }
+    }
+
+private:
+    int output_fd;
+};
+
+// One thread reads the output pipes of all jt9 workers through epoll, splits
+// and classifies lines, and passes them to the event loop through a
+// single-producer single-consumer ring with an eventfd wakeup. A burst of
+// lines from one worker is then parsed off the event loop, and cycle timers
+// never wait behind it. If the ring is full the reader waits, which backs up
+// into jt9's pipe rather than losing a line.
+class Jt9OutputCollector : public QThread {
+public:
+    struct Line {
+        int channel;
+        Jt9LineKind kind;
+        int nsynced;
+        int ndecoded;
+        int len;
+        char text[240];     // longer lines are cut
+    };
+    typedef std::function<void(const Line&)> Handler;
+
+    explicit Jt9OutputCollector(QObject *parent = nullptr)
+        : QThread(parent), ring(CAPACITY), head(0), tail(0), stopping(false), stalls(0)
+    {
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        notifier = new QSocketNotifier(event_fd, QSocketNotifier::Read, this);
+        connect(notifier, &QSocketNotifier::activated, this, [this]() { drain(); });
+    }
+
+    ~Jt9OutputCollector() {
+        stop();
+        for (Channel *ch : channels) {
+            ::close(ch->fd);
+            delete ch;
+        }
+        ::close(epoll_fd);
+        ::close(event_fd);
+    }
+
+    // Event loop: start reading 'fd' (non-blocking, owned from now on); lines go to 'handler'
+    void add(int fd, const Handler &handler) {
+        Channel *ch = new Channel;
+        ch->id = (int)channels.size();
+        ch->fd = fd;
+        ch->len = 0;
+        channels.push_back(ch);
+        handlers.push_back(handler);
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.ptr = ch;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+        if (!isRunning()) start();
+    }
+
+    void stop() {
+        stopping = true;
+        wait();
+    }
+
+    // Times the reader found the ring full
+    qint64 stallCount() const { return stalls; }
+
+protected:
+    void run() override {
+        struct epoll_event events[16];
+        while (!stopping) {
+            int n = epoll_wait(epoll_fd, events, 16, 100);
+            bool pushed = false;
+            for (int i = 0; i < n; i++) {
+                pushed |= readChannel(static_cast<Channel*>(events[i].data.ptr));
+            }
+            if (pushed) wake();
+        }
+    }
+
+private:
+    static const int CAPACITY = 1024;
+
+    struct Channel {
+        int id;
+        int fd;
+        int len;
+        char buf[4096];     // partial line carried between reads
+    };
+
+    // Reader thread: read what the pipe has, push each complete line
+    bool readChannel(Channel *ch) {
+        bool pushed = false;
+        while (true) {
+            ssize_t got = ::read(ch->fd, ch->buf + ch->len, sizeof(ch->buf) - ch->len);
+            if (got < 0 && errno == EINTR) continue;
+            if (got <= 0) {
+                if (got == 0) {
+                    // jt9 exited: the last unterminated line still counts
+                    if (ch->len > 0) pushed |= push(ch, ch->buf, ch->len);
+                    ch->len = 0;
+                    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, ch->fd, nullptr);
+                }
+                return pushed;
+            }
+            ch->len += (int)got;
+            int start = 0;
+            for (int i = 0; i < ch->len; i++) {
+                if (ch->buf[i] != '\n') continue;
+                pushed |= push(ch, ch->buf + start, i - start);
+                start = i + 1;
+            }
+            if (start == 0 && ch->len == (int)sizeof(ch->buf)) {
+                // No newline in a full buffer: pass it on as one line
+                pushed |= push(ch, ch->buf, ch->len);
+                start = ch->len;
+            }
+            memmove(ch->buf, ch->buf + start, ch->len - start);
+            ch->len -= start;
+        }
+    }
+
+    bool push(Channel *ch, char *text, int len) {
+        Line line;
+        line.channel = ch->id;
+        line.nsynced = line.ndecoded = 0;
+        line.kind = parse_jt9_line(text, len, line.nsynced, line.ndecoded);
+        if (line.kind == JT9_BLANK) return false;
+        line.len = qMin(len, (int)sizeof(line.text));
+        memcpy(line.text, text, line.len);
+
+        unsigned h = head.load(std::memory_order_relaxed);
+        while (h - tail.load(std::memory_order_acquire) == (unsigned)CAPACITY) {
+            stalls++;
+            wake();
+            QThread::usleep(500);
+            if (stopping) return false;
+        }
+        ring[h % CAPACITY] = line;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    void wake() {
+        quint64 one = 1;
+        if (::write(event_fd, &one, sizeof(one)) < 0) {
+            // Counter saturated: the event loop already has a wakeup pending
+        }
+    }
+
+    // Event loop: hand lines to their workers in arrival order
+    void drain() {
+        quint64 n;
+        if (::read(event_fd, &n, sizeof(n)) < 0 && errno != EAGAIN) return;
+        unsigned t = tail.load(std::memory_order_relaxed);
+        while (t != head.load(std::memory_order_acquire)) {
+            const Line &line = ring[t % CAPACITY];
+            handlers[line.channel](line);
+            tail.store(++t, std::memory_order_release);
+        }
+    }
+
+    std::vector<Line> ring;
+    std::atomic<unsigned> head;         // next slot the reader fills
+    std::atomic<unsigned> tail;         // next slot the event loop takes
+    std::vector<Channel*> channels;     // event loop adds, reader uses through epoll
+    std::vector<Handler> handlers;      // event loop only
+    int epoll_fd;
+    int event_fd;
+    QSocketNotifier *notifier;
+    std::atomic<bool> stopping;
+    std::atomic<qint64> stalls;
+};
+
+// Runtime registry of what each instance owns: its jt9 shared memory
+// segments, /dev/shm temp dirs and jt9 processes. Keys are unique per run, so
+// after a crash or kill -9 no later run would find them again. Each instance
+// records what it creates in its own file under a well-known directory, and
+// sweep() (at startup, and from "jt9_decode gc") reclaims the entries of
+// owners that are no longer running. The owner's /proc start time is kept with
+// its PID, so a reused PID does not keep a dead owner's entry alive, and an
+// entry is claimed by renaming it before it is reclaimed, so concurrent sweeps
+// never reclaim the same one twice.
+class InstanceRegistry {
+public:
+    struct SweepStats {
+        int entries = 0;        // dead owners' entries reclaimed
+        int jt9_killed = 0;     // orphaned jt9 processes still attached
+        int segments = 0;
+        int dirs = 0;
+        qint64 bytes = 0;
+    };
+
+    static QString directory() {
+        return QDir("/dev/shm").exists() ? QString("/dev/shm/jt9_decode_registry")
+                                         : QDir::tempPath() + "/jt9_decode_registry";
+    }
+
+    // Start this instance's entry, before any segment or dir is created
+    static void open(const QString &instance_id) {
+        QString dir = directory();
+        if (!QDir().mkpath(dir)) {
+            qStdErr << "Warning: Cannot create registry " << dir << ", leftovers of a crash will not be reclaimed\n";
+            qStdErr.flush();
+            return;
+        }
+        // Shared by every user on the host, like /tmp
+        chmod(QFile::encodeName(dir).constData(), 01777);
+        entryPath() = dir + "/" + instance_id;
+        record(QString("owner %1 %2").arg(getpid()).arg(startTicks(getpid())));
+    }
+
+    static void recordSegment(const QString &key) { record("shm " + key); }
+    static void recordDir(const QString &path) { record("dir " + path); }
+    static void recordJt9(qint64 pid) { record(QString("jt9 %1 %2").arg(pid).arg(startTicks(pid))); }
+
+    // Everything was released on a normal exit
+    static void close() {
+        if (entryPath().isEmpty()) return;
+        QFile::remove(entryPath());
+        entryPath().clear();
+    }
+
+    static SweepStats sweep(bool verbose) {
+        SweepStats stats;
+        QDir dir(directory());
+        QString self = QFileInfo(entryPath()).fileName();
+        QSet<QString> live_dirs;
+
+        for (const QString &name : dir.entryList(QDir::Files, QDir::Name)) {
+            if (name == self) continue;
+            QString path = dir.filePath(name);
+            QStringList lines = readEntry(path);
+            qint64 owner = 0, owner_ticks = -1;
+            if (!lines.isEmpty()) parseOwner(lines[0], owner, owner_ticks);
+
+            // An entry another sweep claimed, unless that sweep died too
+            int claim = name.indexOf(".sweep.");
+            if (claim >= 0 && isAlive(name.mid(claim + 7).toLongLong(), -1)) continue;
+            if (owner > 0 && isAlive(owner, owner_ticks)) {
+                for (const QString &line : lines) {
+                    if (line.startsWith("dir ")) live_dirs.insert(line.mid(4));
+                }
+                continue;
+            }
+
+            QString base = claim >= 0 ? name.left(claim) : name;
+            QString claimed = dir.filePath(QString("%1.sweep.%2").arg(base).arg(getpid()));
+            if (::rename(QFile::encodeName(path).constData(), QFile::encodeName(claimed).constData()) != 0) continue;
+
+            SweepStats one;
+            for (const QString &line : lines) {
+                if (line.startsWith("jt9 ")) {
+                    qint64 pid = 0, ticks = -1;
+                    parseOwner(line, pid, ticks);
+                    if (killOrphan(pid, ticks)) one.jt9_killed++;
+                }
+            }
+            for (const QString &line : lines) {
+                if (line.startsWith("shm ")) {
+                    qint64 bytes = removeSegment(line.mid(4));
+                    if (bytes > 0) {
+                        one.segments++;
+                        one.bytes += bytes;
+                    }
+                } else if (line.startsWith("dir ")) {
+                    qint64 bytes = 0;
+                    if (removeDir(line.mid(4), bytes)) {
+                        one.dirs++;
+                        one.bytes += bytes;
+                    }
+                }
+            }
+            QFile::remove(claimed);
+            if (verbose) {
+                qStdErr << "Reclaimed " << base << " (pid " << owner << "): " << one.segments << " segment(s), "
+                        << one.dirs << " dir(s), " << one.jt9_killed << " jt9 process(es), "
+                        << one.bytes << " bytes\n";
+                qStdErr.flush();
+            }
+            stats.entries++;
+            stats.jt9_killed += one.jt9_killed;
+            stats.segments += one.segments;
+            stats.dirs += one.dirs;
+            stats.bytes += one.bytes;
+        }
+
+        // Temp dirs of runs from before the registry, or whose entry was lost
+        QRegularExpression temp_re("^jt9_decode_(\\d+)_\\d+(_.*)?$");
+        QDir shm("/dev/shm");
+        for (const QString &name : shm.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name)) {
+            QRegularExpressionMatch m = temp_re.match(name);
+            QString path = shm.filePath(name);
+            if (!m.hasMatch() || live_dirs.contains(path) || isAlive(m.captured(1).toLongLong(), -1)) continue;
+            qint64 bytes = 0;
+            if (removeDir(path, bytes)) {
+                if (verbose) {
+                    qStdErr << "Reclaimed unregistered temp dir " << path << ": " << bytes << " bytes\n";
+                    qStdErr.flush();
+                }
+                stats.dirs++;
+                stats.bytes += bytes;
+            }
+        }
+        return stats;
+    }
+
+private:
+    static QString &entryPath() {
+        static QString path;
+        return path;
+    }
+
+    static void record(const QString &line) {
+        if (entryPath().isEmpty()) return;
+        QByteArray bytes = line.toLocal8Bit();
+        bytes += '\n';
+        int fd = ::open(QFile::encodeName(entryPath()).constData(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd < 0) return;
+        ssize_t n = ::write(fd, bytes.constData(), bytes.size());
+        (void)n;
+        ::close(fd);
+    }
+
+    static QStringList readEntry(const QString &path) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) return QStringList();
+        return QString::fromLocal8Bit(file.readAll()).split('\n', Qt::SkipEmptyParts);
+    }
+
+    // "<kind> <pid> <start ticks>"
+    static void parseOwner(const QString &line, qint64 &pid, qint64 &ticks) {
+        QStringList parts = line.split(' ');
+        pid = parts.size() > 1 ? parts[1].toLongLong() : 0;
+        ticks = parts.size() > 2 ? parts[2].toLongLong() : -1;
+    }
+
+    // Process start time in clock ticks since boot (/proc/<pid>/stat field 22), or -1
+    static qint64 startTicks(qint64 pid) {
+        QFile stat(QString("/proc/%1/stat").arg(pid));
+        if (!stat.open(QIODevice::ReadOnly)) return -1;
+        QByteArray content = stat.readAll();
+        int paren = content.lastIndexOf(')');
+        if (paren < 0) return -1;
+        QList<QByteArray> fields = content.mid(paren + 2).split(' ');
+        return fields.size() > 19 ? fields[19].toLongLong() : -1;
+    }
+
+    // Running, and the same process that registered (when its start time is known)
+    static bool isAlive(qint64 pid, qint64 ticks) {
+        if (pid <= 0) return false;
+        if (::kill((pid_t)pid, 0) != 0 && errno == ESRCH) return false;
+        qint64 now = startTicks(pid);
+        return ticks < 0 || now < 0 || now == ticks;
+    }
+
+    // A jt9 whose owner died keeps polling its segment forever
+    static bool killOrphan(qint64 pid, qint64 ticks) {
+        if (ticks < 0 || !isAlive(pid, ticks)) return false;
+        if (::kill((pid_t)pid, SIGKILL) != 0) return false;
+        for (int waited = 0; waited < 1000 && ::kill((pid_t)pid, 0) == 0; waited += 20) {
+            QThread::msleep(20);
+        }
+        return true;
+    }
+
+    // Attach and detach: Qt removes a segment (and its key file) once the
+    // last attachment goes. Creating the lock semaphore takes it over, so it
+    // is removed with the object.
+    static qint64 removeSegment(const QString &key) {
+        qint64 bytes = 0;
+        {
+            QSharedMemory memory(key);
+            if (memory.attach()) {
+                bytes = memory.size();
+                memory.detach();
+            }
+        }
+        QSystemSemaphore lock(key, 1, QSystemSemaphore::Create);
+        return bytes;
+    }
+
+    static bool removeDir(const QString &path, qint64 &bytes) {
+        if (!path.startsWith("/dev/shm/jt9_decode_")) return false;
+        QDir dir(path);
+        if (!dir.exists()) return false;
+        bytes = dirBytes(path);
+        return dir.removeRecursively();
+    }
+
+    static qint64 dirBytes(const QString &path) {
+        qint64 total = 0;
+        for (const QFileInfo &info : QDir(path).entryInfoList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot)) {
+            total += info.isDir() ? dirBytes(info.filePath()) : info.size();
+        }
+        return total;
+    }
+};
+
+// jt9 worker - one jt9 process with its own shared memory segment and temp dir
+class Jt9Worker : public QObject {
+    Q_OBJECT
+
+public:
+    Jt9Worker(const QString &key, const QString &temp_dir, const QString &label = "jt9",
+              QObject *parent = nullptr)
+        : QObject(parent), dec_data(nullptr), collector(nullptr), output_fd(-1), shm_key(key),
+          temp_dir_path(temp_dir), label(label) {}
+
+    ~Jt9Worker() {
+        if (output_fd >= 0) ::close(output_fd);
+    }
+
+    // Create the shared memory segment (replacing any stale one) and zero it
+    bool create() {
+        sharedMemory.setKey(shm_key);
+
+        // Try to attach first (in case it exists from previous run)
+        if (sharedMemory.attach()) {
+            qStdErr << "Detaching from existing shared memory\n";
+            sharedMemory.detach();
+        }
+
+        if (!sharedMemory.create(sizeof(dec_data_t))) {
+            qStdErr << "Failed to create shared memory: " << sharedMemory.errorString() << "\n";
+            qStdErr.flush();
+            return false;
+        }
+        InstanceRegistry::recordSegment(shm_key);
+
+        sharedMemory.lock();
+        dec_data = static_cast<dec_data_t*>(sharedMemory.data());
+        memset(dec_data, 0, sizeof(dec_data_t));
+        sharedMemory.unlock();
+        return true;
+    }
+
+    // Start jt9 attached to this worker's segment. With a collector, jt9's
+    // output goes to a pipe read by the collector's thread instead of QProcess.
+    bool start(const QString &jt9_path, Jt9OutputCollector *output_collector = nullptr) {
+        QDir temp_dir;
+        if (!temp_dir.mkpath(temp_dir_path)) {
+            qStdErr << "Warning: Could not create temp directory in /dev/shm, falling back to /tmp\n";
+            temp_dir_path = "/tmp";
+        } else {
+            qStdErr << "Created temp directory: " << temp_dir_path << "\n";
+            InstanceRegistry::recordDir(temp_dir_path);
+        }
+
+        QStringList args;
+        args << "-s" << shm_key
+             << "-w" << "1"
+             << "-m" << "1"
+             << "-e" << "."
+             << "-a" << "."
+             << "-t" << temp_dir_path;
+
+        // Capture jt9 output
+        int pipe_fds[2] = { -1, -1 };
+        if (output_collector && pipe2(pipe_fds, O_CLOEXEC) == 0) {
+            collector = output_collector;
+            jt9.redirectOutput(pipe_fds[1]);
+        }
+        jt9.setProcessChannelMode(QProcess::MergedChannels);
+        jt9.start(jt9_path, args);
+        if (pipe_fds[1] >= 0) {
+            ::close(pipe_fds[1]);
+            output_fd = pipe_fds[0];
+            fcntl(output_fd, F_SETFL, fcntl(output_fd, F_GETFL) | O_NONBLOCK);
+        }
+
+        if (!jt9.waitForStarted()) {
+            qStdErr << "Failed to start jt9: " << jt9.errorString() << "\n";
+            qStdErr.flush();
+            return false;
+        }
+        InstanceRegistry::recordJt9(jt9.processId());
+        return true;
+    }
+
+    // Tell jt9 to exit and wait for it
+    void stop(int timeout_ms = 2000) {
+        if (jt9.state() == QProcess::NotRunning) return;
+        sharedMemory.lock();
+        dec_data->ipc[1] = 999;
+        sharedMemory.unlock();
+
+        if (!jt9.waitForFinished(timeout_ms)) {
+            jt9.kill();
+            jt9.waitForFinished();
+        }
+    }
+
+    // Cleanup temp directory if we created one in /dev/shm
+    void removeTempDir() {
+        if (temp_dir_path.startsWith("/dev/shm/jt9_decode_")) {
+            QDir temp_dir(temp_dir_path);
+            if (temp_dir.exists()) {
+                if (temp_dir.removeRecursively()) {
+                    qStdErr << "Cleaned up temp directory: " << temp_dir_path << "\n";
+                } else {
+                    qStdErr << "Warning: Could not remove temp directory: " << temp_dir_path << "\n";
+                }
+            }
+        }
+    }
+
+    // Parse jt9 output as it arrives and emit decodeLine()/decodeFinished()
+    void watchOutput() {
+        if (collector && output_fd >= 0) {
+            collector->add(output_fd, [this](const Jt9OutputCollector::Line &line) { deliver(line); });
+            output_fd = -1;
+        } else {
+            connect(&jt9, &QProcess::readyReadStandardOutput, this, &Jt9Worker::readFromStdout);
+        }
+    }
+
+    // Start a decode of kin samples already in d2 (params must be set by the caller)
+    void trigger(int ihsym) {
+        sharedMemory.lock();
+        dec_data->ipc[0] = ihsym;
+        dec_data->ipc[1] = 1;   // start decode
+        dec_data->ipc[2] = -1;  // not done
+        sharedMemory.unlock();
+    }
+
+    // Tell jt9 we know it has finished (WSJT-X: to_jt9(m_ihsym, -1, 1))
+    void acknowledge() {
+        sharedMemory.lock();
+        dec_data->ipc[2] = 1;
+        sharedMemory.unlock();
+    }
+
+    // Cumulative CPU time (user + system) consumed by the jt9 process
+    double cpuSeconds() const {
+        qint64 pid = jt9.processId();
+        if (pid <= 0) return 0.0;
+        QFile stat(QString("/proc/%1/stat").arg(pid));
+        if (!stat.open(QIODevice::ReadOnly)) return 0.0;
+        QByteArray content = stat.readAll();
+        int paren = content.lastIndexOf(')');
+        if (paren < 0) return 0.0;
+        // Fields after the command name start at field 3; utime/stime are 14/15
+        QList<QByteArray> fields = content.mid(paren + 2).split(' ');
+        if (fields.size() < 13) return 0.0;
+        qint64 ticks = fields[11].toLongLong() + fields[12].toLongLong();
+        return (double)ticks / sysconf(_SC_CLK_TCK);
+    }
+
+    QSharedMemory *memory() { return &sharedMemory; }
+    dec_data_t *data() { return dec_data; }
+    QProcess *process() { return &jt9; }
+    const QString &key() const { return shm_key; }
+    const QString &tempDir() const { return temp_dir_path; }
+
+signals:
+    void decodeLine(const QString &line);
+    void decodeFinished(int nsynced, int ndecoded);
+
+private slots:
+    // Called when jt9 has output ready (WSJT-X style: readFromStdout)
+    void readFromStdout() {
+        // Lines are read into a fixed buffer; only decode and diagnostic
+        // lines become QStrings, so the per-cycle marker costs no allocation
+        char buf[512];
+        while (jt9.canReadLine()) {
+            qint64 n = jt9.readLine(buf, sizeof(buf));
+            if (n <= 0) break;
+            char *start = buf;
+            int len = (int)n;
+            int nsynced = 0, ndecoded = 0;
+            Jt9LineKind kind = parse_jt9_line(start, len, nsynced, ndecoded);
+            if (kind == JT9_FINISHED) {
+                emit decodeFinished(nsynced, ndecoded);
+                return;
+            }
+            deliverText(kind, start, len);
+        }
+    }
+
+private:
+    // A line parsed by the collector thread
+    void deliver(const Jt9OutputCollector::Line &line) {
+        if (line.kind == JT9_FINISHED) {
+            emit decodeFinished(line.nsynced, line.ndecoded);
+        } else {
+            deliverText(line.kind, line.text, line.len);
+        }
+    }
+
+    void deliverText(Jt9LineKind kind, const char *text, int len) {
+        if (kind == JT9_DECODE) {
+            emit decodeLine(QString::fromLocal8Bit(text, len));
+        } else if (kind == JT9_DIAGNOSTIC) {
+            // Debug/diagnostic output
+            qStdErr << label << ": " << QString::fromLocal8Bit(text, len) << "\n";
+            qStdErr.flush();
+        }
+    }
+
+    QSharedMemory sharedMemory;
+    dec_data_t *dec_data;
+    Jt9Process jt9;
+    Jt9OutputCollector *collector;      // reads output_fd once watchOutput() is called
+    int output_fd;
+    QString shm_key;
+    QString temp_dir_path;
+    QString label;
+};
+
+// One extra AP decode pass: jt9 is told we are 'mycall' in a QSO with
+// 'hiscall', so its a-priori passes look for hiscall's reply to mycall
+struct HintCandidate {
+    QString mycall;     // station whose incoming replies we want
+    QString hiscall;    // its QSO partner (empty for a CQ caller)
+    QString hisgrid;    // partner's grid if heard
+    int nqso_progress;  // WSJT-X QSO state of 'mycall' (0=CALLING .. 5=SIGNOFF)
+    int freq;           // audio offset where the reply is expected
+    double score;
+};
+
+// A-priori hint engine - remembers recently heard stations and active QSO
+// pairs from previous cycles and ranks targets for extra AP decode passes
+class HintEngine {
+public:
+    HintEngine(int top_k, int max_age_cycles)
+        : top_k(top_k), max_age(max_age_cycles), extra_decodes(0), passes(0), cpu_s(0.0) {}
+
+    // Feed one decode (main or hint pass) seen in the given cycle
+    void observe(int cycle, const DecodeRecord &rec) {
+        QStringList tok = rec.message.split(' ', Qt::SkipEmptyParts);
+        if (tok.size() < 2) return;
+
+        if (tok[0] == "CQ") {
+            // "CQ [DX|NA|...] CALL [GRID]"
+            int ci = (tok.size() >= 3 && !isGrid(tok[2]) && tok[1].length() <= 4 && !tok[1].contains('/')) ? 2 : 1;
+            if (ci >= tok.size()) return;
+            Station &st = heard(tok[ci], cycle, rec);
+            if (ci + 1 < tok.size() && isGrid(tok[ci + 1])) st.grid = tok[ci + 1];
+            st.calling_cq = true;
+            return;
+        }
+
+        // "TO FROM <grid|report|R+report|RRR|RR73|73>" - FROM is transmitting to TO
+        if (tok.size() < 3) return;
+        const QString &to = tok[0];
+        const QString &from = tok[1];
+        const QString &info = tok[2];
+        Station &st = heard(from, cycle, rec);
+        st.calling_cq = false;
+
+        int progress;
+        if (isGrid(info)) {
+            st.grid = info;
+            progress = 1;        // REPLYING
+        } else if (info == "RRR" || info == "RR73") {
+            progress = 4;        // ROGERS
+        } else if (info == "73") {
+            progress = 5;        // SIGNOFF
+        } else if (info.startsWith("R") && info.length() > 1 && (info[1] == '-' || info[1] == '+')) {
+            progress = 3;        // ROGER_REPORT
+        } else if (info.startsWith("-") || info.startsWith("+")) {
+            progress = 2;        // REPORT
+        } else {
+            return;
+        }
+
+        // Key by the station whose reply we would look for next: that is 'to'
+        // replying to 'from', i.e. AP pass with mycall=from, hiscall=to
+        QString key = from + " " + to;
+        Qso &q = qsos[key];
+        q.mycall = from;
+        q.hiscall = to;
+        q.progress = progress;
+        q.last_cycle = cycle;
+        q.from_freq = rec.freq;
+
+        // The reverse direction has been answered; it is no longer a target
+        qsos.remove(to + " " + from);
+    }
+
+    // Rank targets for the cycle about to be decoded
+    QList<HintCandidate> candidates(int cycle) {
+        expire(cycle);
+
+        QList<HintCandidate> all;
+        for (QHash<QString, Qso>::const_iterator it = qsos.constBegin(); it != qsos.constEnd(); ++it) {
+            const Qso &q = it.value();
+            if (q.progress >= 5) continue;
+            if (!isPlainCall(q.mycall) || !isPlainCall(q.hiscall)) continue;
+            HintCandidate c;
+            c.mycall = q.mycall;
+            c.hiscall = q.hiscall;
+            c.nqso_progress = q.progress;
+            QHash<QString, Station>::const_iterator partner = stations.constFind(q.hiscall);
+            c.hisgrid = partner != stations.constEnd() ? partner.value().grid : QString();
+            c.freq = partner != stations.constEnd() ? partner.value().freq : q.from_freq;
+            c.score = 2.0 * recency(cycle, q.last_cycle);
+            all.append(c);
+        }
+        for (QHash<QString, Station>::const_iterator it = stations.constBegin(); it != stations.constEnd(); ++it) {
+            const Station &st = it.value();
+            if (!st.calling_cq || !isPlainCall(it.key())) continue;
+            HintCandidate c;
+            c.mycall = it.key();
+            c.nqso_progress = 0;  // CALLING: look for replies to this CQ
+            c.freq = st.freq;
+            c.score = recency(cycle, st.last_cycle);
+            all.append(c);
+        }
+
+        std::sort(all.begin(), all.end(), [](const HintCandidate &a, const HintCandidate &b) {
+            return a.score > b.score;
+        });
+        while (all.size() > top_k) all.removeLast();
+        return all;
+    }
+
+    // Accounting for extra passes
+    void recordPass(double pass_cpu_s) { passes++; cpu_s += pass_cpu_s; }
+    void recordExtraDecode() { extra_decodes++; }
+    qint64 totalPasses() const { return passes; }
+    qint64 totalExtraDecodes() const { return extra_decodes; }
+    double totalCpuSeconds() const { return cpu_s; }
+
+private:
+    struct Station {
+        QString grid;
+        int freq;
+        int snr;
+        int last_cycle;
+        bool calling_cq;
+    };
+    struct Qso {
+        QString mycall;
+        QString hiscall;
+        int progress;
+        int last_cycle;
+        int from_freq;
+    };
+
+    Station &heard(const QString &call, int cycle, const DecodeRecord &rec) {
+        Station &st = stations[call];
+        st.freq = rec.freq;
+        st.snr = rec.snr;
+        st.last_cycle = cycle;
+        return st;
+    }
+
+    // Replies arrive in the opposite sequence, so the previous cycle counts most
+    double recency(int cycle, int last) const {
+        int age = cycle - last;
+        if (age <= 1) return 1.0;
+        if (age == 2) return 0.5;
+        return 0.25;
+    }
+
+    void expire(int cycle) {
+        for (QHash<QString, Station>::iterator it = stations.begin(); it != stations.end();) {
+            if (cycle - it.value().last_cycle > max_age) it = stations.erase(it);
+            else ++it;
+        }
+        for (QHash<QString, Qso>::iterator it = qsos.begin(); it != qsos.end();) {
+            if (cycle - it.value().last_cycle > max_age) it = qsos.erase(it);
+            else ++it;
+        }
+    }
+
+    static bool isGrid(const QString &s) {
+        return s.length() == 4 && s[0].isLetter() && s[1].isLetter() && s[2].isDigit() && s[3].isDigit()
+               && s != "RR73";
+    }
+
+    // AP needs standard callsigns; skip hashed (<...>) and compound (/) calls
+    static bool isPlainCall(const QString &s) {
+        if (s.length() < 3 || s.length() > 6) return false;
+        bool has_digit = false;
+        for (int i = 0; i < s.length(); i++) {
+            if (!s[i].isLetterOrNumber()) return false;
+            if (s[i].isDigit()) has_digit = true;
+        }
+        return has_digit;
+    }
+
+    int top_k;
+    int max_age;
+    QHash<QString, Station> stations;
+    QHash<QString, Qso> qsos;
+    qint64 extra_decodes;
+    qint64 passes;
+    double cpu_s;
+};
+
+// Cycle pipeline stages, in the order a cycle passes through them
+enum CycleStage {
+    STAGE_EXTRACT,      // copy the cycle window out of the ring
+    STAGE_CONDITION,    // DC removal and level measurement
+    STAGE_DISPATCH,     // wait for a free worker, load shared memory, trigger
+    STAGE_COLLECT,      // jt9 decoding; lines collected as they arrive
+    STAGE_POSTPROCESS,  // parse and deduplicate decode lines
+    STAGE_PUBLISH,      // write decodes and stats in cycle order
+    STAGE_COUNT
+};
+
+static const char *const STAGE_NAMES[STAGE_COUNT] = {
+    "extract", "condition", "dispatch", "collect", "postprocess", "publish"
+};
+
+// Which stream cycles to decode: an even/odd sequence filter plus TX slots
+// from a control file. The file is polled; each line is one of
+//   ptt on | ptt off | 1 | 0         live PTT state
+//   tx even | tx odd | tx none       sequence this station transmits on
+// A cycle is a TX cycle if it falls on the TX sequence or PTT was on for at
+// least half of the polls taken during it. Sequences follow WSJT-X: even
+// cycles start at an even multiple of the period from the top of the minute.
+class TxSchedule {
+public:
+    enum Sequence { SEQ_BOTH, SEQ_EVEN, SEQ_ODD };
+
+    TxSchedule(int cycle_ms, Sequence decode_seq, const QString &control_path, bool monitor_tx)
+        : cycle_ms(cycle_ms), decode_seq(decode_seq), control_path(control_path), monitor_tx(monitor_tx),
+          tx_seq(SEQ_BOTH), tx_seq_set(false), ptt(false), tx_skipped(0), seq_skipped(0) {}
+
+    static bool isEven(qint64 cycle_start_ms, int cycle_ms) { return (cycle_start_ms / cycle_ms) % 2 == 0; }
+
+    // Called a few times per second with the wall clock (PTT is keyed in real time)
+    void poll(qint64 utc_ms) {
+        if (!control_path.isEmpty()) {
+            readControlFile();
+        }
+        qint64 cycle = utc_ms / cycle_ms;
+        PttCount &c = ptt_counts[cycle];
+        c.polls++;
+        if (ptt) c.on++;
+        while (ptt_counts.size() > 8) {
+            ptt_counts.erase(ptt_counts.begin());
+        }
+    }
+
+    bool wantSequence(bool even) const {
+        return decode_seq == SEQ_BOTH || (decode_seq == SEQ_EVEN) == even;
+    }
+
+    bool isTxCycle(qint64 cycle_start_ms) const {
+        bool even = isEven(cycle_start_ms, cycle_ms);
+        if (tx_seq_set && tx_seq != SEQ_BOTH && (tx_seq == SEQ_EVEN) == even) {
+            return true;
+        }
+        QMap<qint64, PttCount>::const_iterator it = ptt_counts.constFind(cycle_start_ms / cycle_ms);
+        return it != ptt_counts.constEnd() && it.value().on * 2 >= it.value().polls;
+    }
+
+    bool monitorTx() const { return monitor_tx; }
+    void countTxSkip() { tx_skipped++; }
+    void countSeqSkip() { seq_skipped++; }
+    int txSkipped() const { return tx_skipped; }
+    int seqSkipped() const { return seq_skipped; }
+
+private:
+    struct PttCount {
+        int polls = 0;
+        int on = 0;
+    };
+
+    void readControlFile() {
+        QFile f(control_path);
+        if (!f.open(QIODevice::ReadOnly)) {
+            // No file: not transmitting
+            ptt = false;
+            tx_seq_set = false;
+            return;
+        }
+        bool new_ptt = false;
+        bool seq_set = false;
+        Sequence seq = SEQ_BOTH;
+        for (const QByteArray &raw : f.readAll().split('\n')) {
+            QString line = QString::fromLatin1(raw).trimmed().toLower();
+            if (line == "1" || line == "ptt on" || line == "ptt 1") {
+                new_ptt = true;
+            } else if (line == "tx even") {
+                seq = SEQ_EVEN;
+                seq_set = true;
+            } else if (line == "tx odd") {
+                seq = SEQ_ODD;
+                seq_set = true;
+            }
+        }
+        ptt = new_ptt;
+        tx_seq = seq;
+        tx_seq_set = seq_set;
+    }
+
+    int cycle_ms;
+    Sequence decode_seq;
+    QString control_path;
+    bool monitor_tx;
+    Sequence tx_seq;
+    bool tx_seq_set;
+    bool ptt;
+    QMap<qint64, PttCount> ptt_counts;   // per wall-clock cycle index
+    int tx_skipped;
+    int seq_skipped;
+};
+
+// Archive files waiting to be decoded in idle live-stream capacity. The spool
+// directory is scanned for *.wav and *.raw (captured 12 kHz 16-bit mono
+// cycles) in name order; results go to done/<name>.txt and the input is moved
+// to done/, or to failed/ if it cannot be read or decoded. Files stay in place
+// until finished, so an interrupted run picks them up again.
+class BatchSpool {
+public:
+    explicit BatchSpool(const QString &dir)
+        : dir(dir), files_done(0), files_failed(0), decodes(0), audio_s(0.0), decode_s(0.0),
+          deferrals(0), started_ms(QDateTime::currentMSecsSinceEpoch()) {}
+
+    bool open() {
+        QDir d(dir);
+        return d.exists() && d.mkpath("done") && d.mkpath("failed");
+    }
+
+    // Next file not yet taken (rescans the directory when the list runs dry)
+    QString take() {
+        if (pending.isEmpty()) {
+            QStringList names = QDir(dir).entryList(QStringList() << "*.wav" << "*.raw", QDir::Files, QDir::Name);
+            for (const QString &name : names) {
+                if (!taken.contains(name)) pending.append(name);
+            }
+        }
+        if (pending.isEmpty()) return QString();
+        QString name = pending.takeFirst();
+        taken.insert(name);
+        return QDir(dir).filePath(name);
+    }
+
+    // Loads a taken file; returns false (and moves it to failed/) if unreadable
+    bool load(const QString &path, int max_samples, std::vector<short> &samples, int &nutc) {
+        samples.resize(max_samples);
+        int n = -1;
+        if (path.endsWith(".raw")) {
+            QFile f(path);
+            if (f.open(QIODevice::ReadOnly)) {
+                n = (int)(f.read(reinterpret_cast<char*>(samples.data()), (qint64)max_samples * sizeof(short)) / sizeof(short));
+            }
+        } else {
+            n = read_wav_file(path, samples.data(), max_samples);
+        }
+        if (n <= 0) {
+            fail(path);
+            return false;
+        }
+        samples.resize(n);
+        audio_s += (double)n / RX_SAMPLE_RATE;
+
+        nutc = nutc_from_name(QFileInfo(path).fileName(), QFileInfo(path).lastModified());
+        return true;
+    }
+
+    void finish(const QString &path, const QStringList &lines, double seconds) {
+        QFileInfo fi(path);
+        QFile out(QDir(dir).filePath("done/" + fi.completeBaseName() + ".txt"));
+        if (out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            QTextStream ts(&out);
+            for (const QString &line : lines) ts << line << "\n";
+        }
+        moveTo(path, "done");
+        files_done++;
+        decodes += lines.size();
+        decode_s += seconds;
+    }
+
+    void fail(const QString &path) {
+        moveTo(path, "failed");
+        files_failed++;
+    }
+
+    int queued() const { return pending.size(); }
+    int done() const { return files_done; }
+    int failed() const { return files_failed; }
+    qint64 decodeCount() const { return decodes; }
+    double audioSeconds() const { return audio_s; }
+    double decodeSeconds() const { return decode_s; }
+    void countDeferral() { deferrals++; }
+    int deferralCount() const { return deferrals; }
+    // Archive audio decoded per wall-clock second since the spool was opened
+    double throughput() const {
+        qint64 elapsed = QDateTime::currentMSecsSinceEpoch() - started_ms;
+        return elapsed > 0 ? audio_s * 1000.0 / elapsed : 0.0;
+    }
+
+private:
+    void moveTo(const QString &path, const QString &sub) {
+        QFileInfo fi(path);
+        QString target = QDir(dir).filePath(sub + "/" + fi.fileName());
+        QFile::remove(target);
+        QFile::rename(path, target);
+        taken.remove(fi.fileName());
+    }
+
+    QString dir;
+    QStringList pending;
+    QSet<QString> taken;
+    int files_done;
+    int files_failed;
+    qint64 decodes;
+    double audio_s;
+    double decode_s;
+    int deferrals;
+    qint64 started_ms;
+};
+
+// Client for Hamlib's rigctld daemon (plain-text protocol, default port
+// 4532). Each retune is one short exchange on a fresh connection, so a
+// restarted rigctld is picked up without reconnect logic: "F <hz>" must be
+// answered with "RPRT 0", then "f" reads back the dial the rig settled on.
+// Blocking; called from the stage pool, never the event loop.
+class RigctldClient {
+public:
+    static const int TIMEOUT_MS = 1000;
+
+    RigctldClient(const QString &host, const QString &port) : host(host), port(port) {}
+
+    bool setFrequency(qint64 hz, qint64 &actual_hz, QString &error) {
+        int fd = tcp_connect(host, port, TIMEOUT_MS, error);
+        if (fd < 0) return false;
+        struct timeval tv = { TIMEOUT_MS / 1000, (TIMEOUT_MS % 1000) * 1000 };
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+        QByteArray reply;
+        bool ok = command(fd, QByteArray("F ") + QByteArray::number(hz) + "\n", reply);
+        if (!ok) {
+            error = "no reply to set frequency";
+        } else if (reply != "RPRT 0") {
+            error = QString("set frequency refused (%1)").arg(QString::fromLatin1(reply));
+            ok = false;
+        }
+        if (ok) {
+            // Hamlib 4 prints the frequency with decimals; an unreadable reply keeps the request
+            bool parsed = false;
+            double readback = command(fd, "f\n", reply) ? reply.toDouble(&parsed) : 0.0;
+            actual_hz = parsed && readback > 0.0 ? (qint64)llround(readback) : hz;
+        }
+        ::close(fd);
+        return ok;
+    }
+
+    QString describe() const { return QString("rigctld %1:%2").arg(host, port); }
+
+private:
+    static bool command(int fd, const QByteArray &cmd, QByteArray &line) {
+        if (::send(fd, cmd.constData(), cmd.size(), MSG_NOSIGNAL) != cmd.size()) return false;
+        line.clear();
+        char c;
+        while (line.size() < 256 && ::recv(fd, &c, 1, 0) == 1) {
+            if (c == '\n') {
+                line = line.trimmed();
+                return true;
+            }
+            line.append(c);
+        }
+        return false;
+    }
+
+    QString host;
+    QString port;
+};
+
+// Band rotation for one receiver: each cycle goes to one band, picked by
+// smooth weighted round-robin. A band's weight is 1 + sqrt of its recent
+// decodes per visit (a running average weighting each new visit 0.3), so
+// busy bands get more cycles while quiet ones are still revisited and can
+// earn their share back when they open up.
+class BandHopper {
+public:
+    explicit BandHopper(const QList<qint64> &dials) {
+        for (qint64 hz : dials) {
+            Band b;
+            b.dial_hz = hz;
+            bands.append(b);
+        }
+    }
+
+    int bandCount() const { return bands.size(); }
+
+    qint64 next() {
+        double total = 0.0;
+        int best = 0;
+        for (int i = 0; i < bands.size(); i++) {
+            double w = weight(bands[i]);
+            bands[i].current += w;
+            total += w;
+            if (bands[i].current > bands[best].current) best = i;
+        }
+        bands[best].current -= total;
+        return bands[best].dial_hz;
+    }
+
+    // Decodes from one cycle on the band nearest dial_hz (the rig may round the dial)
+    void observe(qint64 dial_hz, int decodes) {
+        int best = -1;
+        for (int i = 0; i < bands.size(); i++) {
+            if (best < 0 || qAbs(bands[i].dial_hz - dial_hz) < qAbs(bands[best].dial_hz - dial_hz)) best = i;
+        }
+        if (best < 0 || qAbs(bands[best].dial_hz - dial_hz) > 10000) return;
+        Band &b = bands[best];
+        b.activity = b.visits == 0 ? decodes : 0.7 * b.activity + 0.3 * decodes;
+        b.visits++;
+    }
+
+    QString summary() const {
+        QStringList parts;
+        for (const Band &b : bands) {
+            parts << QString("%1 Hz: %2 cycles, %3 decodes/cycle")
+                     .arg(b.dial_hz).arg(b.visits).arg(QString::number(b.activity, 'f', 1));
+        }
+        return parts.join("; ");
+    }
+
+private:
+    struct Band {
+        qint64 dial_hz = 0;
+        double activity = 0.0;      // recent decodes per cycle
+        double current = 0.0;       // round-robin credit
+        int visits = 0;
+    };
+
+    static double weight(const Band &b) { return 1.0 + std::sqrt(b.activity); }
+
+    QList<Band> bands;
+};
+
+// Cheap pre-decode features of a cycle for the decode cost model
+struct CycleFeatures {
+    double band_db;     // mean power in the decoder's passband, dBFS
+    int candidates;     // occupied 50 Hz slots, a stand-in for jt9's sync candidates
+};
+
+// Measures CycleFeatures on the ingest lane. Sixteen 2048-point frames spread
+// over the cycle are averaged per 50 Hz slot of the passband; a slot counts
+// as occupied when it stands 4 dB above the lower-quartile slot (the noise
+// floor). Well under a millisecond per cycle, against jt9's hundreds. Buffers
+// are sized once by setPassband(), and cycles conditioned concurrently take
+// turns under the mutex.
+class FeatureProbe {
+public:
+    static const int FFT_SIZE = 2048;
+    static const int FRAMES = 16;
+    static const int SLOT_HZ = 50;
+
+    FeatureProbe() : fft(FFT_SIZE), first_bin(1), bins_per_slot(1), nslots(0), power_scale(1.0f) {
+        window.resize(FFT_SIZE);
+        double wsum = 0.0;
+        for (int i = 0; i < FFT_SIZE; i++) {
+            window[i] = 0.5f - 0.5f * (float)cos(2.0 * M_PI * i / FFT_SIZE);
+            wsum += window[i];
+        }
+        power_scale = 1.0f / (float)((32768.0 * wsum / 2.0) * (32768.0 * wsum / 2.0));
+        frame.resize(FFT_SIZE);
+    }
+
+    void setPassband(int freq_low, int freq_high) {
+        double bin_hz = (double)RX_SAMPLE_RATE / FFT_SIZE;
+        first_bin = qBound(1, (int)floor(freq_low / bin_hz), FFT_SIZE / 2 - 1);
+        int last_bin = qBound(first_bin, (int)ceil(freq_high / bin_hz), FFT_SIZE / 2 - 1);
+        bins_per_slot = qMax(1, (int)lround(SLOT_HZ / bin_hz));
+        nslots = qMax(1, (last_bin - first_bin + 1) / bins_per_slot);
+        slot_power.assign(nslots, 0.0);
+        sorted.assign(nslots, 0.0);
+    }
+
+    CycleFeatures measure(const short *x, int count) {
+        CycleFeatures f = { -150.0, 0 };
+        if (count < FFT_SIZE || nslots == 0) return f;
+        QMutexLocker lock(&mutex);
+        std::fill(slot_power.begin(), slot_power.end(), 0.0);
+        int stride = (count - FFT_SIZE) / (FRAMES - 1);
+        for (int n = 0; n < FRAMES; n++) {
+            const short *src = x + n * stride;
+            for (int i = 0; i < FFT_SIZE; i++) frame[i] = src[i];
+            fft.transform(frame.data(), window.data());
+            for (int s = 0; s < nslots; s++) {
+                int k0 = first_bin + s * bins_per_slot;
+                for (int k = k0; k < k0 + bins_per_slot; k++) slot_power[s] += fft.power(k);
+            }
+        }
+
+        double total = 0.0;
+        for (int s = 0; s < nslots; s++) total += slot_power[s];
+        f.band_db = 10.0 * log10(total * power_scale / ((double)FRAMES * nslots * bins_per_slot) + 1e-15);
+
+        std::copy(slot_power.begin(), slot_power.end(), sorted.begin());
+        std::nth_element(sorted.begin(), sorted.begin() + nslots / 4, sorted.end());
+        double threshold = sorted[nslots / 4] * 2.5119;   // +4 dB
+        for (int s = 0; s < nslots; s++) {
+            if (slot_power[s] > threshold) f.candidates++;
+        }
+        return f;
+    }
+
+private:
+    RealFft fft;
+    int first_bin;
+    int bins_per_slot;
+    int nslots;
+    float power_scale;
+    std::vector<float> window;
+    std::vector<float> frame;
+    std::vector<double> slot_power;
+    std::vector<double> sorted;
+    QMutex mutex;
+};
+
+// Online model of jt9 pass duration, so a pass's cost is known before it is
+// dispatched rather than after it overruns. Mode, frequency span, depth and
+// AP settings are fixed for a kind of pass within a run, so each kind (main,
+// TX monitor, AP hint) has its own weights over the per-cycle inputs: band
+// power, occupied slots, the previous cycle's sync count and the kind's
+// recent average. The weights are fitted by recursive least squares with
+// exponential forgetting (about 30 passes), so the model follows band
+// conditions and host load. Until a kind has seen a few passes its recent
+// average, or a quarter of the cycle, stands in. Prediction error is kept
+// per window for <CostStats>.
+class DecodeCostModel {
+public:
+    enum Kind { KIND_MAIN, KIND_MONITOR, KIND_HINT, KINDS };
+
+    explicit DecodeCostModel(double fallback_ms) : fallback_ms(fallback_ms) {
+        for (int k = 0; k < KINDS; k++) {
+            Fit &fit = fits[k];
+            fit.passes = 0;
+            fit.recent_ms = 0.0;
+            for (int i = 0; i < NF; i++) {
+                fit.w[i] = 0.0;
+                for (int j = 0; j < NF; j++) fit.P[i][j] = i == j ? P0 : 0.0;
+            }
+        }
+        resetErrors();
+    }
+
+    double predict(Kind kind, const CycleFeatures &f, int prev_nsynced) const {
+        const Fit &fit = fits[kind];
+        if (fit.passes == 0) return fallback_ms;
+        if (fit.passes < WARMUP) return fit.recent_ms;
+        double x[NF];
+        inputs(fit, f, prev_nsynced, x);
+        double s = 0.0;
+        for (int i = 0; i < NF; i++) s += fit.w[i] * x[i];
+        // A poorly conditioned fit is not allowed to stray far from recent history
+        return qBound(fit.recent_ms * 0.25, s * 1000.0, fit.recent_ms * 4.0);
+    }
+
+    // Average of recent passes of a kind (fallback before the first)
+    double recentMs(Kind kind) const {
+        return fits[kind].passes > 0 ? fits[kind].recent_ms : fallback_ms;
+    }
+
+    // A pass finished in observed_ms; predicted_ms is what predict() said before it ran
+    void observe(Kind kind, const CycleFeatures &f, int prev_nsynced, double predicted_ms, double observed_ms) {
+        Fit &fit = fits[kind];
+        if (fit.passes == 0) fit.recent_ms = observed_ms;
+
+        // Recursive least squares: k = P x / (lambda + x'P x), w += k e, P = (P - k x'P) / lambda
+        double x[NF], Px[NF], k[NF];
+        inputs(fit, f, prev_nsynced, x);
+        double denom = LAMBDA, e = observed_ms / 1000.0;
+        for (int i = 0; i < NF; i++) {
+            Px[i] = 0.0;
+            for (int j = 0; j < NF; j++) Px[i] += fit.P[i][j] * x[j];
+            denom += x[i] * Px[i];
+            e -= fit.w[i] * x[i];
+        }
+        double trace = 0.0;
+        for (int i = 0; i < NF; i++) {
+            k[i] = Px[i] / denom;
+            fit.w[i] += k[i] * e;
+        }
+        for (int i = 0; i < NF; i++) {
+            for (int j = 0; j < NF; j++) fit.P[i][j] = (fit.P[i][j] - k[i] * Px[j]) / LAMBDA;
+            trace += fit.P[i][i];
+        }
+        // Inputs that stop varying let P grow without bound under forgetting
+        if (trace > MAX_TRACE) {
+            for (int i = 0; i < NF; i++) {
+                for (int j = 0; j < NF; j++) fit.P[i][j] *= MAX_TRACE / trace;
+            }
+        }
+        fit.recent_ms = 0.7 * fit.recent_ms + 0.3 * observed_ms;
+        fit.passes++;
+
+        double err = observed_ms - predicted_ms;
+        err_passes++;
+        err_abs_ms += fabs(err);
+        err_sum_ms += err;
+        err_pct += observed_ms > 0.0 ? 100.0 * fabs(err) / observed_ms : 0.0;
+        if (fabs(err) <= 0.2 * observed_ms) err_within++;
+    }
+
+    // A main pass was predicted to end after its deadline
+    void countPredictedLate() { predicted_late++; }
+
+    void writeStats(LineBuffer &out) const {
+        double n = qMax(1, err_passes);
+        out << " passes=" << err_passes
+            << " mae_ms=" << Fixed(err_abs_ms / n, 1)
+            << " bias_ms=" << Fixed(err_sum_ms / n, 1)
+            << " mape=" << Fixed(err_pct / n, 1)
+            << " within_20pct=" << err_within
+            << " predicted_late=" << predicted_late
+            << " main_ms=" << Fixed(recentMs(KIND_MAIN), 1);
+    }
+
+    int windowPasses() const { return err_passes; }
+
+    void resetErrors() {
+        err_passes = 0;
+        err_within = 0;
+        predicted_late = 0;
+        err_abs_ms = err_sum_ms = err_pct = 0.0;
+    }
+
+private:
+    static const int NF = 5;
+    static const int WARMUP = 6;
+    static constexpr double LAMBDA = 0.97;
+    static constexpr double P0 = 100.0;
+    static constexpr double MAX_TRACE = 1e4;
+
+    struct Fit {
+        double w[NF];
+        double P[NF][NF];
+        int passes;
+        double recent_ms;
+    };
+
+    // Inputs scaled to order one; the weights are in seconds
+    static void inputs(const Fit &fit, const CycleFeatures &f, int prev_nsynced, double *x) {
+        x[0] = 1.0;
+        x[1] = (f.band_db + 60.0) / 20.0;
+        x[2] = f.candidates / 20.0;
+        x[3] = prev_nsynced / 20.0;
+        x[4] = fit.recent_ms / 1000.0;
+    }
+
+    double fallback_ms;
+    Fit fits[KINDS];
+    int err_passes;
+    int err_within;
+    int predicted_late;
+    double err_abs_ms;
+    double err_sum_ms;
+    double err_pct;
+};
+
+// One jt9 decode moving through the pipeline: the main decode of a cycle,
+// one of its AP hint passes, or a low-priority batch file
+struct CycleJob {
+    int cycle_num;
+    int nutc;
+    qint64 deadline_ms;         // UTC time after which a queued job is stale
+    bool hint;
+    HintCandidate candidate;
+    bool even_seq;              // cycle starts on an even sequence
+    bool monitor;               // TX cycle: cheap monitor pass only
+    bool batch;                 // archive file from the batch spool
+    bool deferred;              // batch file already held back for a live deadline
+    QString batch_path;
+    QStringList batch_lines;
+    qint64 dial_hz;             // band-hopping: absolute dial frequency of the cycle
+    int mute_head;              // samples muted while the rig settles after a retune
+    int mute_tail;              // samples muted before the next cycle's retune
+    QString remote_node;        // cluster mode: decode node the main job was sent to
+    int admit_delay_ms;         // stagger mode: held back for other instances on the host
+    int admit_rank;             // stagger mode: place in this boundary's herd (1-based)
+    int admit_peers;            // stagger mode: instances in the herd
+    int reader_lag_ms;          // worst reader lag during the cycle
+    int reader_head_ms;         // age of the newest ring block when the cycle was cut
+    std::shared_ptr<std::vector<short> > samples;  // shared by a cycle's main and hint jobs
+
+    // Conditioning results
+    double dc_offset;
+    double rms;
+    int clipped;
+    CycleFeatures features;     // cost model inputs, shared with the cycle's hint jobs
+    int prev_nsynced;           // sync count of the previous main pass
+    double predicted_ms;        // cost model's pass duration, before dispatch (0: none)
+
+    // Collect results
+    Jt9Worker *worker;
+    double cpu_start;
+    int nsynced;
+    int ndecoded;
+
+    // Per-stage time spent, and when the current stage began
+    qint64 stage_ns[STAGE_COUNT];
+    qint64 stage_start_ns;
+
+    void beginStage() { stage_start_ns = monotonic_ns(); }
+    void endStage(CycleStage stage) { stage_ns[stage] += monotonic_ns() - stage_start_ns; }
+};
+
+typedef std::shared_ptr<CycleJob> CycleJobPtr;
+
+// Bounded FIFO between pipeline stages; push() refuses work when full. The
+// storage is reserved up front, so steady-state pushes do not allocate.
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(int capacity) : cap(capacity) { items.reserve(capacity); }
+    bool push(const T &item) {
+        if (items.size() >= cap) return false;
+        items.append(item);
+        return true;
+    }
+    T pop() { return items.takeFirst(); }
+    T &front() { return items.first(); }
+    bool isEmpty() const { return items.isEmpty(); }
+    int size() const { return items.size(); }
+    int capacity() const { return cap; }
+    QVector<T> &raw() { return items; }
+
+private:
+    int cap;
+    QVector<T> items;
+};
+
+// Small map in one reserved vector, in insertion order, for the few in-flight
+// cycles and busy workers: QMap and QHash allocate a node per insert. Keys are
+// cycle numbers or workers, inserted in increasing order where firstKey() matters.
+template <typename K, typename V>
+class FlatMap {
+    struct Item {
+        K k;
+        V v;
+    };
+
+public:
+    explicit FlatMap(int reserve) { items.reserve(reserve); }
+
+    class iterator {
+    public:
+        explicit iterator(Item *p) : p(p) {}
+        const K &key() const { return p->k; }
+        V &value() const { return p->v; }
+        iterator &operator++() { ++p; return *this; }
+        bool operator!=(const iterator &o) const { return p != o.p; }
+
+    private:
+        Item *p;
+    };
+    typedef iterator const_iterator;
+
+    bool contains(const K &k) const { return find(k) >= 0; }
+    bool isEmpty() const { return items.empty(); }
+    int size() const { return (int)items.size(); }
+    const K &firstKey() const { return items.front().k; }
+    V &first() { return items.front().v; }
+
+    V value(const K &k, const V &fallback = V()) const {
+        int i = find(k);
+        return i >= 0 ? items[i].v : fallback;
+    }
+
+    V &operator[](const K &k) {
+        int i = find(k);
+        if (i >= 0) return items[i].v;
+        items.push_back(Item{k, V()});
+        return items.back().v;
+    }
+
+    void insert(const K &k, const V &v) { (*this)[k] = v; }
+
+    void remove(const K &k) {
+        int i = find(k);
+        if (i >= 0) items.erase(items.begin() + i);
+    }
+
+    V take(const K &k) {
+        int i = find(k);
+        if (i < 0) return V();
+        V v = std::move(items[i].v);
+        items.erase(items.begin() + i);
+        return v;
+    }
+
+    iterator begin() { return iterator(items.data()); }
+    iterator end() { return iterator(items.data() + items.size()); }
+    const_iterator constBegin() const { return iterator(const_cast<Item*>(items.data())); }
+    const_iterator constEnd() const { return iterator(const_cast<Item*>(items.data() + items.size())); }
+
+private:
+    int find(const K &k) const {
+        for (size_t i = 0; i < items.size(); i++) {
+            if (items[i].k == k) return (int)i;
+        }
+        return -1;
+    }
+
+    std::vector<Item> items;
+};
+
+// Runs the extract and condition stages of cycle jobs as ingest-lane tasks
+// on the DSP pool. Task objects are preallocated and finished jobs come back
+// through a fixed ring with an eventfd waking the event loop, where
+// QThreadPool::start() and a queued invokeMethod() would each allocate per
+// cycle. submit() refuses work when 'capacity' jobs are in flight.
+class CycleStager : public QObject {
+public:
+    typedef std::function<void(const CycleJobPtr&, int write_pos)> StageFn;   // on a pool thread
+    typedef std::function<void(const CycleJobPtr&)> DoneFn;                   // on the event loop
+
+    CycleStager(int capacity, DspPool *pool, int hint, StageFn stage, DoneFn done, QObject *parent = nullptr)
+        : QObject(parent), pool(pool), hint(hint), stage(stage), done(done), tasks(capacity),
+          finished(capacity), in_flight(0), on_pool(0)
+    {
+        for (StageTask &t : tasks) t.owner = this;
+        event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        notifier = new QSocketNotifier(event_fd, QSocketNotifier::Read, this);
+        connect(notifier, &QSocketNotifier::activated, this, [this]() { deliver(); });
+    }
+
+    ~CycleStager() {
+        stop();
+        ::close(event_fd);
+    }
+
+    bool submit(const CycleJobPtr &job, int write_pos) {
+        StageTask *task = nullptr;
+        {
+            QMutexLocker lock(&mutex);
+            if (in_flight >= (int)tasks.size()) return false;
+            for (StageTask &t : tasks) {
+                if (!t.job) {
+                    task = &t;
+                    break;
+                }
+            }
+            if (!task) return false;
+            task->job = job;
+            task->write_pos = write_pos;
+            in_flight++;
+            on_pool++;
+        }
+        pool->submit(task, DSP_INGEST, hint);
+        return true;
+    }
+
+    // Wait for tasks already on the pool; their results are not delivered
+    void stop() {
+        QMutexLocker lock(&mutex);
+        while (on_pool > 0) idle.wait(&mutex);
+    }
+
+private:
+    struct StageTask : public DspTask {
+        StageTask() : owner(nullptr), write_pos(0) {}
+        void run() override { owner->runStage(this); }
+        CycleStager *owner;
+        CycleJobPtr job;
+        int write_pos;
+    };
+
+    template <typename T>
+    class Ring {
+    public:
+        explicit Ring(int n) : cells(n), head(0), count(0) {}
+        bool empty() const { return count == 0; }
+        void push(const T &v) { cells[(head + count++) % cells.size()] = v; }
+        T pop() {
+            T v = cells[head];
+            cells[head] = T();
+            head = (head + 1) % cells.size();
+            count--;
+            return v;
+        }
+
+    private:
+        std::vector<T> cells;
+        size_t head;
+        size_t count;
+    };
+
+    // Pool thread
+    void runStage(StageTask *task) {
+        {
+            AllocScope scope(ALLOC_CYCLE);
+            stage(task->job, task->write_pos);
+        }
+        QMutexLocker lock(&mutex);
+        finished.push(task->job);
+        task->job.reset();
+        on_pool--;
+        idle.wakeAll();
+        quint64 one = 1;
+        if (::write(event_fd, &one, sizeof(one)) < 0) {
+            // Counter saturated: the event loop already has a wakeup pending
+        }
+    }
+
+    // Event loop: hand conditioned jobs on in order of completion
+    void deliver() {
+        quint64 n;
+        if (::read(event_fd, &n, sizeof(n)) < 0 && errno != EAGAIN) return;
+        while (true) {
+            CycleJobPtr job;
+            {
+                QMutexLocker lock(&mutex);
+                if (finished.empty()) return;
+                job = finished.pop();
+                in_flight--;
+            }
+            done(job);
+        }
+    }
+
+    DspPool *pool;
+    int hint;
+    StageFn stage;
+    DoneFn done;
+    QMutex mutex;
+    QWaitCondition idle;
+    std::vector<StageTask> tasks;
+    Ring<CycleJobPtr> finished;
+    int in_flight;      // submitted and not yet delivered
+    int on_pool;        // submitted and not yet run
+    int event_fd;
+    QSocketNotifier *notifier;
+};
+
+// Runs a function on a QThreadPool thread
+class FunctionTask : public QRunnable {
+public:
+    explicit FunctionTask(const std::function<void()> &fn) : fn(fn) {}
+    void run() override { fn(); }
+
+private:
+    std::function<void()> fn;
+};
+
+// Copies the 'count' samples ending at write_pos out of a ring buffer
+void extract_cycle(const short *ring, int ring_size, QMutex *mutex, int write_pos, short *dst, int count) {
+    int read_start = (write_pos - count + ring_size) % ring_size;
+
+    mutex->lock();
+    if (read_start + count <= ring_size) {
+        // Contiguous block
+        memcpy(dst, ring + read_start, count * sizeof(short));
+    } else {
+        // Wraps around - copy in two parts
+        int first_part = ring_size - read_start;
+        memcpy(dst, ring + read_start, first_part * sizeof(short));
+        memcpy(dst + first_part, ring, (count - first_part) * sizeof(short));
+    }
+    mutex->unlock();
+}
+
+// Measures DC offset, RMS level and clipping; with remove_dc also subtracts
+// the offset (common on SDR audio) in place
+void condition_cycle(short *x, int count, bool remove_dc, double &dc_offset, double &rms, int &clipped) {
+    qint64 sum = 0;
+    for (int i = 0; i < count; i++) sum += x[i];
+    int dc = (int)(sum / count);
+
+    double energy = 0.0;
+    clipped = 0;
+    for (int i = 0; i < count; i++) {
+        int v = x[i];
+        if (remove_dc) {
+            v -= dc;
+            if (v > 32767) v = 32767;
+            if (v < -32768) v = -32768;
+            x[i] = (short)v;
+        }
+        if (v >= 32767 || v <= -32768) clipped++;
+        double ac = remove_dc ? v : v - dc;
+        energy += ac * ac;
+    }
+    dc_offset = dc;
+    rms = sqrt(energy / count);
+}
+
+// Multi-pattern automaton over bytes (Aho-Corasick). Edges are kept sorted in
+// one flat array, so tens of thousands of patterns cost a few MB and a step is
+// a short binary search. prefixes() follows goto edges only (patterns that
+// start the text); search() also follows failure links (patterns anywhere).
+class PatternAutomaton {
+public:
+    PatternAutomaton() { clear(); }
+
+    void clear() {
+        nodes.assign(1, Node());
+        edges.clear();
+        ids.clear();
+        build_edges.assign(1, std::vector<std::pair<uchar, int> >());
+        build_ids.assign(1, std::vector<int>());
+    }
+
+    void add(const QByteArray &pattern, int id) {
+        int node = 0;
+        for (char ch : pattern) {
+            uchar c = (uchar)ch;
+            int next = -1;
+            for (const std::pair<uchar, int> &e : build_edges[node]) {
+                if (e.first == c) next = e.second;
+            }
+            if (next < 0) {
+                next = (int)build_edges.size();
+                build_edges[node].push_back(std::make_pair(c, next));
+                build_edges.push_back(std::vector<std::pair<uchar, int> >());
+                build_ids.push_back(std::vector<int>());
+            }
+            node = next;
+        }
+        build_ids[node].push_back(id);
+    }
+
+    // Flatten the trie and compute failure and output links (breadth first)
+    void build() {
+        int n = (int)build_edges.size();
+        nodes.assign(n, Node());
+        edges.clear();
+        ids.clear();
+        for (int i = 0; i < n; i++) {
+            std::sort(build_edges[i].begin(), build_edges[i].end());
+            nodes[i].edge_begin = (int)edges.size();
+            nodes[i].edge_count = (int)build_edges[i].size();
+            edges.insert(edges.end(), build_edges[i].begin(), build_edges[i].end());
+            nodes[i].id_begin = (int)ids.size();
+            nodes[i].id_count = (int)build_ids[i].size();
+            ids.insert(ids.end(), build_ids[i].begin(), build_ids[i].end());
+        }
+        build_edges.clear();
+        build_ids.clear();
+
+        std::vector<int> order;
+        order.reserve(n);
+        order.push_back(0);
+        for (size_t k = 0; k < order.size(); k++) {
+            int u = order[k];
+            for (int e = nodes[u].edge_begin; e < nodes[u].edge_begin + nodes[u].edge_count; e++) {
+                uchar c = edges[e].first;
+                int v = edges[e].second;
+                int f = 0;
+                if (u != 0) {
+                    f = nodes[u].fail;
+                    while (f != 0 && child(f, c) < 0) f = nodes[f].fail;
+                    int fc = child(f, c);
+                    f = fc >= 0 ? fc : 0;
+                }
+                nodes[v].fail = f;
+                nodes[v].out = nodes[f].id_count > 0 ? f : nodes[f].out;
+                order.push_back(v);
+            }
+        }
+    }
+
+    int nodeCount() const { return (int)nodes.size(); }
+    size_t memoryBytes() const {
+        return nodes.size() * sizeof(Node) + edges.size() * sizeof(edges[0]) + ids.size() * sizeof(int);
+    }
+
+    template<typename Fn> void prefixes(const QByteArray &text, Fn hit) const {
+        int node = 0;
+        for (char ch : text) {
+            node = child(node, (uchar)ch);
+            if (node < 0) return;
+            emit_ids(node, hit);
+        }
+    }
+
+    template<typename Fn> void search(const QByteArray &text, Fn hit) const {
+        int node = 0;
+        for (char ch : text) {
+            uchar c = (uchar)ch;
+            int next;
+            while ((next = child(node, c)) < 0 && node != 0) node = nodes[node].fail;
+            node = next < 0 ? 0 : next;
+            for (int m = node; m > 0; m = nodes[m].out) emit_ids(m, hit);
+        }
+    }
+
+private:
+    struct Node {
+        int edge_begin = 0;
+        int edge_count = 0;
+        int id_begin = 0;
+        int id_count = 0;
+        int fail = 0;
+        int out = 0;        // nearest node on the failure chain with ids (0 = none)
+    };
+
+    int child(int node, uchar c) const {
+        const std::pair<uchar, int> *lo = edges.data() + nodes[node].edge_begin;
+        const std::pair<uchar, int> *hi = lo + nodes[node].edge_count;
+        while (lo < hi) {
+            const std::pair<uchar, int> *mid = lo + (hi - lo) / 2;
+            if (mid->first < c) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo < edges.data() + nodes[node].edge_begin + nodes[node].edge_count && lo->first == c ? lo->second : -1;
+    }
+
+    template<typename Fn> void emit_ids(int node, Fn hit) const {
+        for (int k = 0; k < nodes[node].id_count; k++) hit(ids[nodes[node].id_begin + k]);
+    }
+
+    std::vector<Node> nodes;
+    std::vector<std::pair<uchar, int> > edges;
+    std::vector<int> ids;
+    std::vector<std::vector<std::pair<uchar, int> > > build_edges;
+    std::vector<std::vector<int> > build_ids;
+};
+
+// Alert rules matched against every published decode. One rule per line:
+//   call K1ABC          exact callsign (also matches K1ABC/P, VK2/K1ABC)
+//   prefix VK9          callsigns starting with VK9
+//   grid FN4            grid locators starting with FN4
+//   text CQ DX          substring of the message
+//   regex ^CQ \w+ JA    QRegularExpression on the message
+//   entity Japan JA,JE  DXCC entity by its prefixes, or by name alone from a cty.dat
+//   cty /path/cty.dat   AD1C country file used by later entity lines
+// Blank lines and lines starting with '#' are ignored; patterns are upper case.
+class Watchlist {
+public:
+    struct Rule {
+        QString kind;
+        QString pattern;
+    };
+
+    bool load(const QString &path, QString &error) {
+        QFile f(path);
+        if (!f.open(QIODevice::ReadOnly)) {
+            error = "cannot open " + path;
+            return false;
+        }
+        QHash<QString, QStringList> cty;
+        int line_no = 0;
+        for (const QByteArray &raw : f.readAll().split('\n')) {
+            line_no++;
+            QString line = QString::fromUtf8(raw).trimmed();
+            if (line.isEmpty() || line.startsWith('#')) continue;
+            int space = line.indexOf(' ');
+            QString kind = line.left(space).toLower();
+            QString arg = space > 0 ? line.mid(space + 1).trimmed() : QString();
+            if (arg.isEmpty()) {
+                error = QString("line %1: missing pattern").arg(line_no);
+                return false;
+            }
+            if (kind == "cty") {
+                if (!loadCty(arg, cty)) {
+                    error = QString("line %1: cannot read %2").arg(line_no).arg(arg);
+                    return false;
+                }
+            } else if (kind == "entity") {
+                QStringList words = arg.split(' ', Qt::SkipEmptyParts);
+                QStringList prefixes = words.size() > 1 ? words.last().split(',', Qt::SkipEmptyParts) : QStringList();
+                QString name = words.size() > 1 ? words.mid(0, words.size() - 1).join(' ') : arg;
+                if (prefixes.isEmpty()) prefixes = cty.value(name.toUpper());
+                if (prefixes.isEmpty()) {
+                    error = QString("line %1: no prefixes for entity %2 (list them or load a cty.dat first)").arg(line_no).arg(name);
+                    return false;
+                }
+                addEntity(name, prefixes);
+            } else if (!add(kind, arg)) {
+                error = QString("line %1: bad rule '%2'").arg(line_no).arg(line);
+                return false;
+            }
+        }
+        build();
+        return true;
+    }
+
+    // Add one rule; call build() before matching
+    bool add(const QString &kind, const QString &pattern) {
+        QString p = kind == "regex" ? pattern : pattern.toUpper();
+        int id = rules.size();
+        if (kind == "call") {
+            calls.insert(p, id);
+        } else if (kind == "prefix") {
+            prefix_trie.add(p.toLatin1(), id);
+        } else if (kind == "grid") {
+            grid_trie.add(p.toLatin1(), id);
+        } else if (kind == "text") {
+            text_ac.add(p.toLatin1(), id);
+        } else if (kind == "regex") {
+            QRegularExpression re(p);
+            if (!re.isValid()) return false;
+            re.optimize();
+            regexes.append(qMakePair(re, id));
+        } else {
+            return false;
+        }
+        rules.append(Rule{kind, p});
+        return true;
+    }
+
+    void addEntity(const QString &name, const QStringList &prefixes) {
+        int id = rules.size();
+        rules.append(Rule{"entity", name});
+        for (const QString &prefix : prefixes) {
+            // cty.dat marks exact callsigns with '='
+            if (prefix.startsWith('=')) calls.insert(prefix.mid(1).toUpper(), id);
+            else prefix_trie.add(prefix.toUpper().toLatin1(), id);
+        }
+    }
+
+    void build() {
+        prefix_trie.build();
+        grid_trie.build();
+        text_ac.build();
+    }
+
+    // Ids of the rules matching a decoded message, each once
+    void match(const QString &message, std::vector<int> &hits) const {
+        hits.clear();
+        auto hit = [&hits](int id) { hits.push_back(id); };
+        for (const QString &word : message.split(' ', Qt::SkipEmptyParts)) {
+            QString token = word;
+            if (token.startsWith('<') && token.endsWith('>')) token = token.mid(1, token.length() - 2);
+            if (isGrid(token)) {
+                grid_trie.prefixes(token.toLatin1(), hit);
+                continue;
+            }
+            if (!looksLikeCall(token)) continue;
+            QByteArray bytes = token.toLatin1();
+            prefix_trie.prefixes(bytes, hit);
+            QHash<QString, int>::const_iterator it = calls.constFind(token);
+            if (it != calls.constEnd()) hits.push_back(it.value());
+            if (token.contains('/')) {
+                for (const QString &part : token.split('/', Qt::SkipEmptyParts)) {
+                    it = calls.constFind(part);
+                    if (it != calls.constEnd()) hits.push_back(it.value());
+                }
+            }
+        }
+        text_ac.search(message.toLatin1(), hit);
+        for (const QPair<QRegularExpression, int> &r : regexes) {
+            if (r.first.match(message).hasMatch()) hits.push_back(r.second);
+        }
+        std::sort(hits.begin(), hits.end());
+        hits.erase(std::unique(hits.begin(), hits.end()), hits.end());
+    }
+
+    const Rule &rule(int id) const { return rules[id]; }
+    int size() const { return rules.size(); }
+
+    size_t memoryBytes() const {
+        return prefix_trie.memoryBytes() + grid_trie.memoryBytes() + text_ac.memoryBytes() +
+               calls.size() * 48 + rules.size() * sizeof(Rule);
+    }
+
+    QString describe() const {
+        QMap<QString, int> counts;
+        for (const Rule &r : rules) counts[r.kind]++;
+        QStringList parts;
+        for (QMap<QString, int>::const_iterator it = counts.constBegin(); it != counts.constEnd(); ++it) {
+            parts << QString("%1 %2").arg(it.value()).arg(it.key());
+        }
+        return QString("%1 rules (%2)").arg(rules.size()).arg(parts.join(", "));
+    }
+
+    static bool isGrid(const QString &s) {
+        return s.length() == 4 && s != "RR73" && s[0] >= 'A' && s[0] <= 'R' && s[1] >= 'A' && s[1] <= 'R' &&
+               s[2].isDigit() && s[3].isDigit();
+    }
+
+    // A letter and a digit, nothing but letters, digits and '/'
+    static bool looksLikeCall(const QString &s) {
+        if (s.length() < 3 || s.length() > 13) return false;
+        bool letter = false, digit = false;
+        for (QChar c : s) {
+            if (c >= 'A' && c <= 'Z') letter = true;
+            else if (c.isDigit()) digit = true;
+            else if (c != '/') return false;
+        }
+        return letter && digit;
+    }
+
+private:
+    // AD1C cty.dat: "Name: CQ: ITU: Cont: Lat: Lon: TZ: Prefix:" then aliases up to ';'
+    static bool loadCty(const QString &path, QHash<QString, QStringList> &cty) {
+        QFile f(path);
+        if (!f.open(QIODevice::ReadOnly)) return false;
+        for (const QString &record : QString::fromLatin1(f.readAll()).split(';', Qt::SkipEmptyParts)) {
+            QStringList fields = record.split(':');
+            if (fields.size() < 9) continue;
+            QString name = fields[0].trimmed().toUpper();
+            QStringList prefixes;
+            prefixes << fields[7].trimmed().remove('*');
+            for (QString alias : fields[8].split(',', Qt::SkipEmptyParts)) {
+                alias = alias.trimmed();
+                // Strip zone and other overrides: (cq) [itu] <lat/lon> {cont} ~tz~
+                int cut = alias.indexOf(QRegularExpression("[\\(\\[<\\{~]"));
+                if (cut >= 0) alias = alias.left(cut);
+                if (!alias.isEmpty()) prefixes << alias;
+            }
+            cty[name] += prefixes;
+        }
+        return true;
+    }
+
+    QVector<Rule> rules;
+    QHash<QString, int> calls;
+    PatternAutomaton prefix_trie;
+    PatternAutomaton grid_trie;
+    PatternAutomaton text_ac;
+    QList<QPair<QRegularExpression, int> > regexes;
+};
+
+// Matches published decodes against a watchlist file and writes alerts to
+// their own channel (a file or FIFO, or udp:<host>:<port>), one line each:
+//   <Alert> match="call:K1ABC" match="grid:FN4" </Alert> 153015 -8 0.3 1234 ~ CQ K1ABC FN42
+// The file is checked every two seconds and rebuilt off the event loop when
+// it changes; a list that fails to load leaves the previous one in place.
+class WatchlistMonitor : public QObject {
+public:
+    WatchlistMonitor(const QString &path, QObject *parent = nullptr)
+        : QObject(parent), path(path), out_fd(-1), udp(false), loading(false), alerts(0), checked(0), match_ns(0)
+    {
+        QTimer *timer = new QTimer(this);
+        connect(timer, &QTimer::timeout, this, [this]() { poll(); });
+        timer->start(2000);
+    }
+
+    ~WatchlistMonitor() {
+        if (out_fd >= 0) ::close(out_fd);
+        if (checked > 0) {
+            qStdErr << "Watchlist: " << alerts << " alert(s) from " << checked << " decodes, "
+                    << QString::number(match_ns / 1e3 / checked, 'f', 2) << " us per decode\n";
+            qStdErr.flush();
+        }
+    }
+
+    // Load the list now (startup must not run without it) and open the alert channel
+    bool open(const QString &dest, QString &error) {
+        std::shared_ptr<Watchlist> first = std::make_shared<Watchlist>();
+        if (!first->load(path, error)) return false;
+        list = first;
+        stamp = fileStamp();
+        out_fd = open_sink(dest, udp_addr, udp);
+        if (out_fd < 0) {
+            error = "cannot open alert output " + dest;
+            return false;
+        }
+        qStdErr << "Watchlist " << path << ": " << list->describe() << "\n";
+        qStdErr.flush();
+        return true;
+    }
+
+    void check(const DecodeRecord &rec, const QString &line) {
+        qint64 t0 = monotonic_ns();
+        list->match(rec.message, hits);
+        match_ns += monotonic_ns() - t0;
+        checked++;
+        if (hits.empty()) return;
+
+        QString alert = "<Alert>";
+        for (int id : hits) {
+            const Watchlist::Rule &r = list->rule(id);
+            QString pattern = r.pattern;
+            alert += " match=\"" + r.kind + ":" + pattern.replace("\"", "\\\"") + "\"";
+        }
+        alert += " </Alert> " + line + "\n";
+        QByteArray bytes = alert.toUtf8();
+        if (udp) {
+            ::sendto(out_fd, bytes.constData(), bytes.size(), 0, (struct sockaddr*)&udp_addr, sizeof(udp_addr));
+        } else if (::write(out_fd, bytes.constData(), bytes.size()) < 0) {
+            return;
+        }
+        alerts++;
+    }
+
+    int alertCount() const { return alerts; }
+
+private:
+    QString fileStamp() const {
+        QFileInfo info(path);
+        return QString("%1/%2").arg(info.lastModified().toMSecsSinceEpoch()).arg(info.size());
+    }
+
+    void poll() {
+        QString now = fileStamp();
+        if (loading || now == stamp) return;
+        stamp = now;
+        loading = true;
+        QString file = path;
+        QThreadPool::globalInstance()->start(new FunctionTask([this, file]() {
+            qint64 t0 = monotonic_ns();
+            std::shared_ptr<Watchlist> next = std::make_shared<Watchlist>();
+            QString error;
+            bool ok = next->load(file, error);
+            double ms = (monotonic_ns() - t0) / 1e6;
+            QMetaObject::invokeMethod(this, [this, next, ok, error, ms]() {
+                loading = false;
+                if (!ok) {
+                    qStdErr << "Warning: Watchlist not reloaded (" << error << "), keeping the previous one\n";
+                } else {
+                    list = next;
+                    qStdErr << "Watchlist reloaded: " << list->describe() << " in "
+                            << QString::number(ms, 'f', 1) << " ms\n";
+                }
+                qStdErr.flush();
+            }, Qt::QueuedConnection);
+        }));
+    }
+
+    QString path;
+    QString stamp;                      // mtime/size the current list was loaded from
+    std::shared_ptr<Watchlist> list;
+    std::vector<int> hits;
+    int out_fd;
+    bool udp;
+    struct sockaddr_in udp_addr;
+    bool loading;
+    int alerts;
+    qint64 checked;
+    qint64 match_ns;
+};
+
+typedef decltype(dec_data_t::params) DecodeParams;
+
+// Cluster mode: capture nodes ship conditioned cycle windows to decode nodes.
+// Each frame on the TCP connection is a big-endian u32 length (type byte plus
+// payload), a type byte and a QDataStream payload:
+//   HELLO   both ways on connect: "JT9C", version, sizeof(params)
+//   JOB     capture -> decode: id, deadline (UTC ms), ihsym, params, samples
+//   RESULT  decode -> capture: id, status, nsynced, ndecoded, decode ms, lines
+//   STATUS  decode -> capture, every second: workers, busy, queued, avg decode ms
+// Params travel as the raw jt9 struct, so both ends must be built from the
+// same commons.h (HELLO checks its size). Deadlines are absolute UTC, which
+// the stations' clocks must agree on for FT8 anyway.
+enum ClusterFrameType { CLUSTER_HELLO = 1, CLUSTER_JOB = 2, CLUSTER_RESULT = 3, CLUSTER_STATUS = 4 };
+enum ClusterResultStatus { CLUSTER_DONE = 0, CLUSTER_REJECTED = 1 };
+static const quint32 CLUSTER_VERSION = 1;
+
+static QByteArray cluster_hello() {
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.writeRawData("JT9C", 4);
+    out << CLUSTER_VERSION << (quint32)sizeof(DecodeParams);
+    return payload;
+}
+
+static bool cluster_hello_ok(const QByteArray &payload) {
+    QDataStream in(payload);
+    char magic[4];
+    quint32 version = 0, params_size = 0;
+    in.readRawData(magic, 4);
+    in >> version >> params_size;
+    return memcmp(magic, "JT9C", 4) == 0 && version == CLUSTER_VERSION && params_size == sizeof(DecodeParams);
+}
+
+// Samples go out as all high bytes, then all low bytes: deflate does much
+// better on the slowly varying high-byte plane than on interleaved 16-bit
+static QByteArray pack_samples(const short *x, int n) {
+    QByteArray planes(n * 2, 0);
+    char *p = planes.data();
+    for (int i = 0; i < n; i++) {
+        p[i] = (char)((ushort)x[i] >> 8);
+        p[n + i] = (char)(x[i] & 0xff);
+    }
+    return qCompress(planes, 1);
+}
+
+static bool unpack_samples(const QByteArray &packed, std::vector<short> &x) {
+    QByteArray planes = qUncompress(packed);
+    if (planes.isEmpty() || planes.size() % 2 != 0) return false;
+    int n = planes.size() / 2;
+    const uchar *p = reinterpret_cast<const uchar*>(planes.constData());
+    x.resize(n);
+    for (int i = 0; i < n; i++) {
+        x[i] = (short)((p[i] << 8) | p[n + i]);
+    }
+    return true;
+}
+
+// Starts a non-blocking connect; the socket becomes writable when it completes
+static int tcp_connect_async(const QString &host, const QString &port) {
+    struct addrinfo hints, *res = nullptr;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host.toLatin1().constData(), port.toLatin1().constData(), &hints, &res) != 0 || !res) {
+        return -1;
+    }
+    int fd = ::socket(res->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd >= 0 && ::connect(fd, res->ai_addr, res->ai_addrlen) != 0 && errno != EINPROGRESS) {
+        ::close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    return fd;
+}
+
+// Non-blocking framed TCP connection driven by the event loop. The owner
+// learns of a closed or failed connection through on_close and should
+// deleteLater() the socket from there.
+class FrameSocket : public QObject {
+public:
+    static const quint32 MAX_FRAME = 64 * 1024 * 1024;
+    typedef std::function<void(int type, const QByteArray &payload)> FrameFn;
+
+    FrameSocket(int fd, bool connecting, QObject *parent = nullptr)
+        : QObject(parent), fd(fd), connecting(connecting), closed(false)
+    {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        read_notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+        write_notifier = new QSocketNotifier(fd, QSocketNotifier::Write, this);
+        write_notifier->setEnabled(connecting);
+        connect(read_notifier, &QSocketNotifier::activated, this, [this]() { onReadable(); });
+        connect(write_notifier, &QSocketNotifier::activated, this, [this]() { onWritable(); });
+    }
+
+    ~FrameSocket() { ::close(fd); }
+
+    // Set before returning to the event loop
+    void setHandlers(FrameFn frame_fn, std::function<void()> close_fn) {
+        on_frame = frame_fn;
+        on_close = close_fn;
+    }
+
+    void send(int type, const QByteArray &payload) {
+        if (closed) return;
+        quint32 len = payload.size() + 1;
+        char header[5] = { (char)(len >> 24), (char)(len >> 16), (char)(len >> 8), (char)len, (char)type };
+        out.append(header, 5);
+        out.append(payload);
+        if (!connecting) onWritable();
+    }
+
+    // Stop all traffic without calling on_close (the owner is dropping us)
+    void abort() {
+        closed = true;
+        read_notifier->setEnabled(false);
+        write_notifier->setEnabled(false);
+    }
+
+private:
+    void onReadable() {
+        char buf[65536];
+        while (true) {
+            ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+            if (n > 0) {
+                in.append(buf, (int)n);
+                continue;
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            fail();   // closed by the peer, or an error
+            return;
+        }
+        while (in.size() >= 5) {
+            const uchar *p = reinterpret_cast<const uchar*>(in.constData());
+            quint32 len = ((quint32)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+            if (len == 0 || len > MAX_FRAME) {
+                fail();
+                return;
+            }
+            if ((quint32)in.size() < 4 + len) break;
+            int type = p[4];
+            QByteArray payload = in.mid(5, (int)len - 1);
+            in.remove(0, (int)len + 4);
+            on_frame(type, payload);
+            if (closed) return;
+        }
+    }
+
+    void onWritable() {
+        if (connecting) {
+            int err = 0;
+            socklen_t len = sizeof(err);
+            if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0 || err != 0) {
+                fail();
+                return;
+            }
+            connecting = false;
+        }
+        while (!out.isEmpty()) {
+            ssize_t n = ::send(fd, out.constData(), out.size(), MSG_NOSIGNAL);
+            if (n > 0) {
+                out.remove(0, (int)n);
+                continue;
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            fail();
+            return;
+        }
+        write_notifier->setEnabled(!out.isEmpty());
+    }
+
+    void fail() {
+        if (closed) return;
+        closed = true;
+        read_notifier->setEnabled(false);
+        write_notifier->setEnabled(false);
+        on_close();
+    }
+
+    int fd;
+    bool connecting;
+    bool closed;
+    FrameFn on_frame;
+    std::function<void()> on_close;
+    QSocketNotifier *read_notifier;
+    QSocketNotifier *write_notifier;
+    QByteArray in;
+    QByteArray out;
+};
+
+// Capture side of cluster mode: keeps a connection to every decode node and
+// places each main decode on the node predicted to finish it soonest, if
+// that is before the deadline. The job comes back for local decoding when no
+// node fits, when the node rejects it, when its connection drops, or when
+// no result arrives by the time a local pass would still make the deadline.
+class ClusterClient : public QObject {
+public:
+    typedef std::function<void(const CycleJobPtr&, const QStringList&, int nsynced, int ndecoded)> ResultFn;
+    typedef std::function<void(const CycleJobPtr&)> FallbackFn;
+
+    ClusterClient(const QStringList &addrs, ResultFn on_result, FallbackFn on_fallback, QObject *parent = nullptr)
+        : QObject(parent), on_result(on_result), on_fallback(on_fallback), next_id(1),
+          remote_jobs(0), fallbacks(0), rejected(0), timeouts(0)
+    {
+        for (const QString &addr : addrs) {
+            Node n;
+            int colon = addr.lastIndexOf(':');
+            n.host = colon > 0 ? addr.left(colon) : addr;
+            n.port = colon > 0 ? addr.mid(colon + 1) : QString("7400");
+            n.name = n.host + ":" + n.port;
+            nodes.append(n);
+        }
+        QTimer *timer = new QTimer(this);
+        connect(timer, &QTimer::timeout, this, [this]() { tick(); });
+        timer->start(100);
+        tick();
+    }
+
+    // Returns false if no node can take the job in time (decode it locally)
+    bool submit(const CycleJobPtr &job, const DecodeParams &params, int ihsym, qint64 deadline_utc_ms, double local_ms) {
+        qint64 now_ms = QDateTime::currentMSecsSinceEpoch();
+        int best = -1;
+        double best_done = 0.0;
+        for (int i = 0; i < nodes.size(); i++) {
+            const Node &n = nodes[i];
+            if (!n.ready) continue;
+            double avg = n.avg_ms > 0.0 ? n.avg_ms : local_ms;
+            int load = n.busy + n.queued + qMax(0, n.inflight - n.inflight_at_status);
+            double wait = load >= n.workers ? (double)(load - n.workers + 1) / n.workers * avg : 0.0;
+            double done = now_ms + n.rtt_ms + wait + avg;
+            if (done + SAFETY_MS > deadline_utc_ms) continue;
+            if (best < 0 || done < best_done) {
+                best = i;
+                best_done = done;
+            }
+        }
+        if (best < 0) return false;
+
+        Node &n = nodes[best];
+        quint32 id = next_id++;
+        QByteArray payload;
+        QDataStream out(&payload, QIODevice::WriteOnly);
+        out << id << deadline_utc_ms << (qint32)ihsym;
+        out << QByteArray(reinterpret_cast<const char*>(&params), sizeof(params));
+        out << pack_samples(job->samples->data(), (int)job->samples->size());
+        n.sock->send(CLUSTER_JOB, payload);
+        n.inflight++;
+
+        // Give up in time for a local pass, but not before the node could plausibly answer
+        Pending p;
+        p.job = job;
+        p.node = best;
+        p.sent_ms = now_ms;
+        p.giveup_ms = qMin(deadline_utc_ms, qMax((qint64)best_done + 500, deadline_utc_ms - (qint64)local_ms));
+        pending.insert(id, p);
+        job->remote_node = n.name;
+        remote_jobs++;
+        return true;
+    }
+
+    int remoteJobs() const { return remote_jobs; }
+    int fallbackCount() const { return fallbacks; }
+
+    QString summary() const {
+        QStringList parts;
+        for (const Node &n : nodes) {
+            parts << QString("%1 %2 (%3 workers, %4 ms/decode, rtt %5 ms)")
+                     .arg(n.name, n.ready ? "up" : "down").arg(n.workers)
+                     .arg(QString::number(n.avg_ms, 'f', 0)).arg(QString::number(n.rtt_ms, 'f', 0));
+        }
+        return QString("%1 remote, %2 fell back (%3 rejected, %4 timed out); ")
+               .arg(remote_jobs).arg(fallbacks).arg(rejected).arg(timeouts) + parts.join("; ");
+    }
+
+private:
+    static const int SAFETY_MS = 200;       // required margin before the deadline
+    static const int RETRY_MS = 2000;
+
+    struct Node {
+        QString host, port, name;
+        FrameSocket *sock = nullptr;
+        bool ready = false;                 // connected and HELLO accepted
+        int workers = 1;
+        int busy = 0;
+        int queued = 0;
+        double avg_ms = 0.0;
+        double rtt_ms = 20.0;               // transfer and queueing overhead beyond the decode
+        int inflight = 0;                   // our jobs without a result
+        int inflight_at_status = 0;         // ... when the last STATUS was sent
+        int timeouts = 0;                   // consecutive
+        qint64 retry_ms = 0;
+    };
+
+    struct Pending {
+        CycleJobPtr job;
+        int node;
+        qint64 sent_ms;
+        qint64 giveup_ms;
+    };
+
+    void tick() {
+        qint64 now_ms = QDateTime::currentMSecsSinceEpoch();
+        for (int i = 0; i < nodes.size(); i++) {
+            Node &n = nodes[i];
+            if (n.sock || now_ms < n.retry_ms) continue;
+            n.retry_ms = now_ms + RETRY_MS;
+            int fd = tcp_connect_async(n.host, n.port);
+            if (fd < 0) continue;
+            n.sock = new FrameSocket(fd, true, this);
+            n.sock->setHandlers([this, i](int type, const QByteArray &payload) { onFrame(i, type, payload); },
+                                [this, i]() { onClosed(i); });
+            n.sock->send(CLUSTER_HELLO, cluster_hello());
+        }
+
+        QList<quint32> expired;
+        for (QHash<quint32, Pending>::const_iterator it = pending.constBegin(); it != pending.constEnd(); ++it) {
+            if (now_ms >= it.value().giveup_ms) expired.append(it.key());
+        }
+        for (quint32 id : expired) {
+            Pending p = pending.take(id);
+            Node &n = nodes[p.node];
+            n.inflight--;
+            timeouts++;
+            if (++n.timeouts >= 3 && n.sock) {
+                qStdErr << "Warning: Cluster node " << n.name << " keeps missing deadlines, reconnecting\n";
+                qStdErr.flush();
+                dropNode(p.node);
+            }
+            fallBack(p.job);
+        }
+    }
+
+    void onFrame(int i, int type, const QByteArray &payload) {
+        Node &n = nodes[i];
+        QDataStream in(payload);
+        if (type == CLUSTER_HELLO) {
+            if (!cluster_hello_ok(payload)) {
+                qStdErr << "Error: Cluster node " << n.name << " runs an incompatible build\n";
+                qStdErr.flush();
+                dropNode(i);
+                n.retry_ms = QDateTime::currentMSecsSinceEpoch() + 60000;
+                return;
+            }
+            n.ready = true;
+            qStdErr << "Cluster node " << n.name << " connected\n";
+            qStdErr.flush();
+        } else if (type == CLUSTER_STATUS) {
+            qint32 workers, busy, queued;
+            double avg_ms;
+            in >> workers >> busy >> queued >> avg_ms;
+            n.workers = qMax(1, (int)workers);
+            n.busy = busy;
+            n.queued = queued;
+            n.avg_ms = avg_ms;
+            n.inflight_at_status = n.inflight;
+        } else if (type == CLUSTER_RESULT) {
+            quint32 id;
+            qint32 status, nsynced, ndecoded;
+            double decode_ms;
+            QStringList lines;
+            in >> id >> status >> nsynced >> ndecoded >> decode_ms >> lines;
+            if (!pending.contains(id)) return;   // already fell back
+            Pending p = pending.take(id);
+            n.inflight--;
+            if (status == CLUSTER_REJECTED) {
+                rejected++;
+                fallBack(p.job);
+                return;
+            }
+            n.timeouts = 0;
+            double overhead = qMax(0.0, QDateTime::currentMSecsSinceEpoch() - p.sent_ms - decode_ms);
+            n.rtt_ms = 0.8 * n.rtt_ms + 0.2 * overhead;
+            on_result(p.job, lines, nsynced, ndecoded);
+        }
+    }
+
+    void onClosed(int i) {
+        Node &n = nodes[i];
+        if (n.ready) {
+            qStdErr << "Warning: Cluster node " << n.name << " disconnected\n";
+            qStdErr.flush();
+        }
+        dropNode(i);
+    }
+
+    // Forget the connection; its jobs come back for local decoding
+    void dropNode(int i) {
+        Node &n = nodes[i];
+        if (n.sock) {
+            n.sock->abort();
+            n.sock->deleteLater();
+        }
+        n.sock = nullptr;
+        n.ready = false;
+        n.inflight = 0;
+        n.inflight_at_status = 0;
+        n.timeouts = 0;
+        QList<quint32> lost;
+        for (QHash<quint32, Pending>::const_iterator it = pending.constBegin(); it != pending.constEnd(); ++it) {
+            if (it.value().node == i) lost.append(it.key());
+        }
+        for (quint32 id : lost) {
+            fallBack(pending.take(id).job);
+        }
+    }
+
+    void fallBack(const CycleJobPtr &job) {
+        fallbacks++;
+        job->remote_node.clear();
+        on_fallback(job);
+    }
+
+    ResultFn on_result;
+    FallbackFn on_fallback;
+    QList<Node> nodes;
+    QHash<quint32, Pending> pending;
+    quint32 next_id;
+    int remote_jobs;
+    int fallbacks;
+    int rejected;
+    int timeouts;
+};
+
+// Decode side of cluster mode: accepts jobs from capture nodes and runs them
+// on the local worker pool, earliest deadline first. A job that cannot start
+// early enough to finish by its deadline is rejected at once, so the capture
+// node still has time to decode it itself.
+class ClusterServer : public QObject {
+public:
+    ClusterServer(const QList<Jt9Worker*> &workers, QObject *parent = nullptr)
+        : QObject(parent), workers(workers), listen_fd(-1), avg_ms(0.0),
+          jobs(0), rejected(0), decodes(0), busy_ms(0.0)
+    {
+        for (Jt9Worker *w : workers) {
+            w->watchOutput();
+            connect(w, &Jt9Worker::decodeLine, this, [this, w](const QString &line) {
+                if (running.contains(w)) running[w].lines.append(line);
+            });
+            connect(w, &Jt9Worker::decodeFinished, this, [this, w](int nsynced, int ndecoded) {
+                onWorkerFinished(w, nsynced, ndecoded);
+            });
+            connect(w->process(), QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this,
+                    [](int exitCode, QProcess::ExitStatus) {
+                qStdErr << "Error: jt9 process exited unexpectedly (code: " << exitCode << ")\n";
+                qStdErr.flush();
+                QCoreApplication::exit(1);
+            });
+            last_kin[w] = 0;
+        }
+        QTimer *status_timer = new QTimer(this);
+        connect(status_timer, &QTimer::timeout, this, [this]() { broadcastStatus(); });
+        status_timer->start(1000);
+        QTimer *stats_timer = new QTimer(this);
+        connect(stats_timer, &QTimer::timeout, this, [this]() { printStats(); });
+        stats_timer->start(60000);
+    }
+
+    ~ClusterServer() {
+        if (listen_fd >= 0) ::close(listen_fd);
+    }
+
+    bool listen(const QString &addr) {
+        int colon = addr.lastIndexOf(':');
+        QString host = colon >= 0 ? addr.left(colon) : QString();
+        QString port = colon >= 0 ? addr.mid(colon + 1) : addr;
+        struct addrinfo hints, *res = nullptr;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_PASSIVE;
+        if (getaddrinfo(host.isEmpty() ? nullptr : host.toLatin1().constData(), port.toLatin1().constData(),
+                        &hints, &res) != 0 || !res) {
+            return false;
+        }
+        listen_fd = ::socket(res->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int one = 1;
+        bool ok = listen_fd >= 0 && setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) == 0 &&
+                  ::bind(listen_fd, res->ai_addr, res->ai_addrlen) == 0 && ::listen(listen_fd, 16) == 0;
+        freeaddrinfo(res);
+        if (!ok) return false;
+        QSocketNotifier *notifier = new QSocketNotifier(listen_fd, QSocketNotifier::Read, this);
+        connect(notifier, &QSocketNotifier::activated, this, [this]() { onAccept(); });
+        return true;
+    }
+
+private:
+    struct Job {
+        QPointer<FrameSocket> client;
+        quint32 id;
+        qint64 deadline_ms;
+        int ihsym;
+        DecodeParams params;
+        std::vector<short> samples;
+        QStringList lines;
+        qint64 start_ms;
+    };
+
+    void onAccept() {
+        int fd;
+        while ((fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+            FrameSocket *sock = new FrameSocket(fd, false, this);
+            sock->setHandlers([this, sock](int type, const QByteArray &payload) { onFrame(sock, type, payload); },
+                              [this, sock]() { onClientClosed(sock); });
+        }
+    }
+
+    void onClientClosed(FrameSocket *client) {
+        clients.removeAll(client);
+        client->deleteLater();
+    }
+
+    void onFrame(FrameSocket *client, int type, const QByteArray &payload) {
+        QDataStream in(payload);
+        if (type == CLUSTER_HELLO) {
+            if (!cluster_hello_ok(payload)) {
+                qStdErr << "Warning: Cluster: rejecting a capture node with an incompatible build\n";
+                qStdErr.flush();
+                client->abort();
+                onClientClosed(client);
+                return;
+            }
+            clients.append(client);
+            client->send(CLUSTER_HELLO, cluster_hello());
+            sendStatus(client);
+            return;
+        }
+        if (type != CLUSTER_JOB) return;
+
+        Job job;
+        QByteArray params_raw, packed;
+        qint32 ihsym;
+        job.client = client;
+        in >> job.id >> job.deadline_ms >> ihsym >> params_raw >> packed;
+        job.ihsym = ihsym;
+        job.start_ms = 0;
+        if (params_raw.size() != (int)sizeof(DecodeParams) || !unpack_samples(packed, job.samples) ||
+            job.samples.size() > (size_t)(NTMAX * RX_SAMPLE_RATE)) {
+            reject(job);
+            return;
+        }
+        memcpy(&job.params, params_raw.constData(), sizeof(DecodeParams));
+        jobs++;
+
+        // Earliest deadline first; refuse now what cannot finish in time
+        int pos = 0;
+        while (pos < queue.size() && queue[pos].deadline_ms <= job.deadline_ms) pos++;
+        queue.insert(pos, job);
+        if (!feasible(pos)) {
+            Job late = queue.takeAt(pos);
+            reject(late);
+            return;
+        }
+        dispatch();
+    }
+
+    // Could queue[pos] finish by its deadline behind the running and earlier queued jobs?
+    bool feasible(int pos) const {
+        double avg = avg_ms > 0.0 ? avg_ms : 1000.0;
+        int ahead = running.size() + pos;
+        double wait = ahead >= workers.size() ? (double)(ahead - workers.size() + 1) / workers.size() * avg : 0.0;
+        return QDateTime::currentMSecsSinceEpoch() + wait + avg <= queue[pos].deadline_ms;
+    }
+
+    void dispatch() {
+        for (Jt9Worker *w : workers) {
+            if (running.contains(w)) continue;
+            while (!queue.isEmpty() && (!queue.first().client || QDateTime::currentMSecsSinceEpoch() + qMax(avg_ms, 0.0) > queue.first().deadline_ms)) {
+                Job stale = queue.takeFirst();
+                reject(stale);
+            }
+            if (queue.isEmpty()) return;
+            Job job = queue.takeFirst();
+            startJob(w, job);
+        }
+    }
+
+    void startJob(Jt9Worker *w, Job &job) {
+        dec_data_t *d = w->data();
+        int n = (int)job.samples.size();
+        memcpy(d->d2, job.samples.data(), n * sizeof(short));
+        if (last_kin[w] > n) {
+            memset(d->d2 + n, 0, (last_kin[w] - n) * sizeof(short));
+        }
+        last_kin[w] = n;
+        w->memory()->lock();
+        d->params = job.params;
+        w->memory()->unlock();
+
+        job.start_ms = QDateTime::currentMSecsSinceEpoch();
+        job.samples.clear();
+        job.samples.shrink_to_fit();
+        running.insert(w, job);
+        w->trigger(job.ihsym);
+    }
+
+    void onWorkerFinished(Jt9Worker *w, int nsynced, int ndecoded) {
+        w->acknowledge();
+        if (!running.contains(w)) return;
+        Job job = running.take(w);
+        double ms = (double)(QDateTime::currentMSecsSinceEpoch() - job.start_ms);
+        avg_ms = avg_ms <= 0.0 ? ms : 0.8 * avg_ms + 0.2 * ms;
+        busy_ms += ms;
+        decodes += ndecoded;
+        if (job.client) {
+            QByteArray payload;
+            QDataStream out(&payload, QIODevice::WriteOnly);
+            out << job.id << (qint32)CLUSTER_DONE << (qint32)nsynced << (qint32)ndecoded << ms << job.lines;
+            job.client->send(CLUSTER_RESULT, payload);
+        }
+        dispatch();
+    }
+
+    void reject(const Job &job) {
+        rejected++;
+        if (!job.client) return;
+        QByteArray payload;
+        QDataStream out(&payload, QIODevice::WriteOnly);
+        out << job.id << (qint32)CLUSTER_REJECTED << (qint32)0 << (qint32)0 << 0.0 << QStringList();
+        job.client->send(CLUSTER_RESULT, payload);
+    }
+
+    void sendStatus(FrameSocket *client) {
+        QByteArray payload;
+        QDataStream out(&payload, QIODevice::WriteOnly);
+        out << (qint32)workers.size() << (qint32)running.size() << (qint32)queue.size() << avg_ms;
+        client->send(CLUSTER_STATUS, payload);
+    }
+
+    void broadcastStatus() {
+        for (const QPointer<FrameSocket> &c : clients) {
+            if (c) sendStatus(c);
+        }
+    }
+
+    void printStats() {
+        qStdOut << "<ClusterStats>"
+                << " clients=" << clients.size()
+                << " jobs=" << jobs
+                << " rejected=" << rejected
+                << " decodes=" << decodes
+                << " avg_decode_ms=" << QString::number(avg_ms, 'f', 0)
+                << " utilisation=" << QString::number(busy_ms / 600.0 / workers.size(), 'f', 1)
+                << " </ClusterStats>\n";
+        qStdOut.flush();
+        busy_ms = 0.0;
+    }
+
+    QList<Jt9Worker*> workers;
+    int listen_fd;
+    QList<QPointer<FrameSocket> > clients;
+    QList<Job> queue;                  // by deadline
+    QHash<Jt9Worker*, Job> running;
+    QHash<Jt9Worker*, int> last_kin;
+    double avg_ms;
+    int jobs;
+    int rejected;
+    int decodes;
+    double busy_ms;                    // since the last stats line
+};
+
+// Amateur band of a dial frequency for MQTT topics ("20m"); anything
+// outside the bands is named by its frequency in kHz
+static QString band_name(qint64 hz) {
+    static const struct { qint64 low, high; const char *name; } BANDS[] = {
+        { 1800000, 2000000, "160m" }, { 3500000, 4000000, "80m" }, { 5250000, 5450000, "60m" },
+        { 7000000, 7300000, "40m" }, { 10100000, 10150000, "30m" }, { 14000000, 14350000, "20m" },
+        { 18068000, 18168000, "17m" }, { 21000000, 21450000, "15m" }, { 24890000, 24990000, "12m" },
+        { 28000000, 29700000, "10m" }, { 50000000, 54000000, "6m" }, { 70000000, 70500000, "4m" },
+        { 144000000, 148000000, "2m" }, { 222000000, 225000000, "1.25m" }, { 420000000, 450000000, "70cm" },
+    };
+    for (const auto &b : BANDS) {
+        if (hz >= b.low && hz <= b.high) return b.name;
+    }
+    return QString::number(hz / 1000) + "kHz";
+}
+
+// Appends s to out as a JSON string literal
+static void json_string(QByteArray &out, const QString &s) {
+    out += '"';
+    for (QChar c : s) {
+        ushort u = c.unicode();
+        if (u == '"' || u == '\\') {
+            out += '\\';
+            out += (char)u;
+        } else if (u < 0x20) {
+            char esc[8];
+            snprintf(esc, sizeof(esc), "\\u%04x", u);
+            out += esc;
+        } else if (u < 0x80) {
+            out += (char)u;
+        } else {
+            out += QString(c).toUtf8();
+        }
+    }
+    out += '"';
+}
+
+// MQTT 3.1.1 / 5.0 publisher for the output stage. One broker connection,
+// driven by the event loop through a non-blocking socket as FrameSocket is,
+// so publish() never blocks. Messages wait in a bounded memory queue; when
+// that fills while the broker is away, the oldest spill to an append-only
+// spool file, which is sent ahead of the memory queue after reconnecting so
+// order is kept. QoS 1 messages stay in flight until their PUBACK and are
+// resent with DUP after a reconnect. Anything unsent at exit goes to the
+// spool for the next run.
+class MqttPublisher : public QObject {
+public:
+    struct Config {
+        Config() : port("1883"), version(4), qos(0), keepalive_s(30) {}
+        QString host;
+        QString port;
+        QString user;
+        QString password;
+        QString client_id;
+        QString spool_dir;      // empty: no disk spool, overflow is dropped
+        int version;            // protocol level: 4 = 3.1.1, 5 = 5.0
+        int qos;                // 0 or 1
+        int keepalive_s;
+
+        // [user:password@]host[:port]
+        bool setBroker(const QString &addr) {
+            QString rest = addr;
+            int at = rest.lastIndexOf('@');
+            if (at >= 0) {
+                QString cred = rest.left(at);
+                user = cred.section(':', 0, 0);
+                password = cred.section(':', 1);
+                rest = rest.mid(at + 1);
+            }
+            int colon = rest.lastIndexOf(':');
+            host = colon >= 0 ? rest.left(colon) : rest;
+            if (colon >= 0) port = rest.mid(colon + 1);
+            return !host.isEmpty() && port.toInt() > 0;
+        }
+    };
+
+    MqttPublisher(const Config &config, QObject *parent = nullptr)
+        : QObject(parent), cfg(config), state(IDLE), fd(-1), read_notifier(nullptr), write_notifier(nullptr),
+          next_id(1), ping_outstanding(false), backoff_ms(1000), connect_start_ms(0), ever_connected(false),
+          outage_logged(false), spool_fd(-1), spool_read(0), spool_write(0),
+          published(0), sent(0), acked(0), spooled(0), dropped(0), disconnects(0)
+    {
+        if (!cfg.spool_dir.isEmpty()) {
+            QDir().mkpath(cfg.spool_dir);
+            spool_path = QDir(cfg.spool_dir).filePath("jt9_decode_mqtt.spool");
+            spool_fd = ::open(QFile::encodeName(spool_path).constData(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+            if (spool_fd >= 0) {
+                spool_write = lseek(spool_fd, 0, SEEK_END);
+                if (spool_write > 0) {
+                    qStdErr << "MQTT: " << spool_write / 1024 << " kB spooled by a previous run will be sent first\n";
+                }
+            } else {
+                qStdErr << "Warning: Cannot open MQTT spool " << spool_path << ": " << strerror(errno)
+                        << "; overflow will be dropped\n";
+            }
+            qStdErr.flush();
+        }
+
+        reconnect_timer = new QTimer(this);
+        reconnect_timer->setSingleShot(true);
+        connect(reconnect_timer, &QTimer::timeout, this, [this]() { connectToBroker(); });
+
+        // Keep-alive pings, and a limit on how long connecting may take
+        QTimer *ping_timer = new QTimer(this);
+        connect(ping_timer, &QTimer::timeout, this, [this]() { onPingTimer(); });
+        ping_timer->start(cfg.keepalive_s * 500);
+    }
+
+    ~MqttPublisher() {
+        if (state == CONNECTED) {
+            static const char DISCONNECT[2] = { (char)0xE0, 0 };
+            out.append(DISCONNECT, 2);
+            flush();
+        }
+        closeSocket();
+
+        // Unacknowledged and unsent messages wait on disk for the next run
+        for (const Message &m : inflight) spill(m);
+        while (!memory.isEmpty()) spill(memory.dequeue());
+        if (spool_fd >= 0) ::close(spool_fd);
+    }
+
+    void start() { connectToBroker(); }
+
+    QString describe() const {
+        return QString("%1:%2 (MQTT %3, QoS %4)").arg(cfg.host, cfg.port)
+            .arg(cfg.version == 5 ? "5.0" : "3.1.1").arg(cfg.qos);
+    }
+
+    void publish(const QByteArray &topic, const QByteArray &payload) {
+        published++;
+        Message m;
+        m.topic = topic;
+        m.payload = payload;
+        m.id = 0;
+        memory.enqueue(m);
+        if (memory.size() > MEMORY_MESSAGES) spill(memory.dequeue());
+        pump();
+    }
+
+    // Counts since the previous call and the current backlog, e.g.
+    // " connected=1 published=4 sent=4 acked=4 spooled=0 dropped=0 ..."
+    QString takeStats() {
+        QString line = QString(" connected=%1 published=%2 sent=%3 acked=%4 spooled=%5 dropped=%6 disconnects=%7"
+                               " queued=%8 inflight=%9")
+            .arg(state == CONNECTED ? 1 : 0).arg(published).arg(sent).arg(acked).arg(spooled).arg(dropped)
+            .arg(disconnects).arg(memory.size()).arg(inflight.size());
+        line += QString(" spool_kb=%1").arg((spool_write - spool_read) / 1024);
+        published = sent = acked = spooled = dropped = disconnects = 0;
+        return line;
+    }
+
+private:
+    static const int MEMORY_MESSAGES = 1024;
+    static const qint64 SPOOL_MAX_BYTES = 64LL * 1024 * 1024;
+    static const int WINDOW = 32;                  // QoS 1 messages awaiting PUBACK
+    static const int OUT_HIGH_WATER = 256 * 1024;  // socket backlog before messages wait in the queue
+    static const int MAX_PACKET = 1024 * 1024;
+
+    enum State { IDLE, CONNECTING, AWAIT_CONNACK, CONNECTED };
+
+    struct Message {
+        QByteArray topic;
+        QByteArray payload;
+        quint16 id;
+    };
+
+    static void putLength(QByteArray &out, int len) {
+        do {
+            char b = len % 128;
+            len /= 128;
+            if (len > 0) b |= (char)0x80;
+            out += b;
+        } while (len > 0);
+    }
+
+    static void putString(QByteArray &out, const QByteArray &s) {
+        out += (char)(s.size() >> 8);
+        out += (char)(s.size() & 0xff);
+        out += s;
+    }
+
+    void putPacket(int header, const QByteArray &body) {
+        out += (char)header;
+        putLength(out, body.size());
+        out += body;
+    }
+
+    void connectToBroker() {
+        if (state != IDLE) return;
+        fd = tcp_connect_async(cfg.host, cfg.port);
+        if (fd < 0) {
+            fail("cannot resolve or connect");
+            return;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        read_notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+        write_notifier = new QSocketNotifier(fd, QSocketNotifier::Write, this);
+        connect(read_notifier, &QSocketNotifier::activated, this, [this]() { onReadable(); });
+        connect(write_notifier, &QSocketNotifier::activated, this, [this]() { onWritable(); });
+        state = CONNECTING;
+        connect_start_ms = QDateTime::currentMSecsSinceEpoch();
+    }
+
+    void sendConnect() {
+        QByteArray body;
+        putString(body, "MQTT");
+        body += (char)cfg.version;
+        char flags = 0x02;    // clean session: in-flight messages are resent by us
+        if (!cfg.user.isEmpty()) flags |= (char)0x80;
+        if (!cfg.password.isEmpty()) flags |= 0x40;
+        body += flags;
+        body += (char)(cfg.keepalive_s >> 8);
+        body += (char)(cfg.keepalive_s & 0xff);
+        if (cfg.version == 5) body += (char)0;    // no properties
+        putString(body, cfg.client_id.toUtf8());
+        if (!cfg.user.isEmpty()) putString(body, cfg.user.toUtf8());
+        if (!cfg.password.isEmpty()) putString(body, cfg.password.toUtf8());
+        putPacket(0x10, body);
+    }
+
+    void sendPublish(const Message &m, bool dup) {
+        QByteArray body;
+        putString(body, m.topic);
+        if (cfg.qos > 0) {
+            body += (char)(m.id >> 8);
+            body += (char)(m.id & 0xff);
+        }
+        if (cfg.version == 5) body += (char)0;
+        body += m.payload;
+        putPacket(0x30 | (dup ? 0x08 : 0) | (cfg.qos << 1), body);
+    }
+
+    // Move queued messages onto the socket while the broker keeps up
+    void pump() {
+        if (state != CONNECTED) return;
+        while (out.size() < OUT_HIGH_WATER && (cfg.qos == 0 || inflight.size() < WINDOW)) {
+            Message m;
+            if (!takeNext(m)) break;
+            if (cfg.qos > 0) {
+                m.id = next_id;
+                next_id = next_id == 65535 ? 1 : next_id + 1;
+                inflight.append(m);
+            }
+            sendPublish(m, false);
+            sent++;
+        }
+        flush();
+    }
+
+    // Oldest message: the spool first, then memory
+    bool takeNext(Message &m) {
+        if (spool_read < spool_write && readSpool(m)) return true;
+        if (memory.isEmpty()) return false;
+        m = memory.dequeue();
+        return true;
+    }
+
+    // Spool records: u32 topic length, u32 payload length (big-endian), topic, payload
+    void spill(const Message &m) {
+        qint64 size = 8 + m.topic.size() + m.payload.size();
+        if (spool_fd < 0 || spool_write - spool_read + size > SPOOL_MAX_BYTES) {
+            dropped++;
+            return;
+        }
+        QByteArray rec;
+        for (quint32 len : { (quint32)m.topic.size(), (quint32)m.payload.size() }) {
+            for (int shift = 24; shift >= 0; shift -= 8) rec += (char)(len >> shift);
+        }
+        rec += m.topic;
+        rec += m.payload;
+        if (pwrite(spool_fd, rec.constData(), rec.size(), spool_write) != rec.size()) {
+            dropped++;
+            return;
+        }
+        spool_write += rec.size();
+        spooled++;
+    }
+
+    bool readSpool(Message &m) {
+        uchar head[8];
+        bool ok = pread(spool_fd, head, 8, spool_read) == 8;
+        quint32 topic_len = ok ? ((quint32)head[0] << 24) | (head[1] << 16) | (head[2] << 8) | head[3] : 0;
+        quint32 payload_len = ok ? ((quint32)head[4] << 24) | (head[5] << 16) | (head[6] << 8) | head[7] : 0;
+        ok = ok && topic_len > 0 && topic_len < 65536 && payload_len < (quint32)MAX_PACKET &&
+             spool_read + 8 + topic_len + payload_len <= spool_write;
+        if (ok) {
+            m.topic.resize(topic_len);
+            m.payload.resize(payload_len);
+            ok = pread(spool_fd, m.topic.data(), topic_len, spool_read + 8) == (ssize_t)topic_len &&
+                 pread(spool_fd, m.payload.data(), payload_len, spool_read + 8 + topic_len) == (ssize_t)payload_len;
+        }
+        if (ok) {
+            spool_read += 8 + topic_len + payload_len;
+            m.id = 0;
+        } else {
+            // A record cut short by a crash: nothing after it can be trusted
+            qStdErr << "Warning: MQTT spool " << spool_path << " is damaged, discarding the rest\n";
+            qStdErr.flush();
+            spool_read = spool_write;
+        }
+        if (spool_read == spool_write) {
+            if (ftruncate(spool_fd, 0) != 0) {
+                qStdErr << "Warning: Cannot truncate MQTT spool: " << strerror(errno) << "\n";
+                qStdErr.flush();
+            }
+            spool_read = spool_write = 0;
+        }
+        return ok;
+    }
+
+    void onWritable() {
+        if (state == CONNECTING) {
+            int err = 0;
+            socklen_t len = sizeof(err);
+            if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0 || err != 0) {
+                fail(strerror(err));
+                return;
+            }
+            state = AWAIT_CONNACK;
+            sendConnect();
+        }
+        flush();
+    }
+
+    void flush() {
+        while (!out.isEmpty()) {
+            ssize_t n = ::send(fd, out.constData(), out.size(), MSG_NOSIGNAL);
+            if (n > 0) {
+                out.remove(0, (int)n);
+                continue;
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            fail(strerror(errno));
+            return;
+        }
+        write_notifier->setEnabled(!out.isEmpty());
+        // Room on the socket again: take more from the queue
+        if (out.isEmpty() && state == CONNECTED && (!memory.isEmpty() || spool_read < spool_write)) {
+            QMetaObject::invokeMethod(this, [this]() { pump(); }, Qt::QueuedConnection);
+        }
+    }
+
+    void onReadable() {
+        char buf[4096];
+        while (true) {
+            ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+            if (n > 0) {
+                in.append(buf, (int)n);
+                continue;
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            fail(n == 0 ? "closed by the broker" : strerror(errno));
+            return;
+        }
+        while (in.size() >= 2) {
+            const uchar *p = reinterpret_cast<const uchar*>(in.constData());
+            int len = 0, shift = 0, pos = 1;
+            while (pos < in.size() && pos <= 4) {
+                len |= (p[pos] & 0x7f) << shift;
+                shift += 7;
+                if (!(p[pos++] & 0x80)) break;
+                if (pos > 4) {
+                    fail("bad packet length");
+                    return;
+                }
+            }
+            if ((p[pos - 1] & 0x80) || in.size() < pos + len) break;
+            int type = p[0] >> 4;
+            QByteArray body = in.mid(pos, len);
+            in.remove(0, pos + len);
+            onPacket(type, body);
+            if (state == IDLE) return;
+        }
+    }
+
+    void onPacket(int type, const QByteArray &body) {
+        const uchar *p = reinterpret_cast<const uchar*>(body.constData());
+        if (type == 2 && body.size() >= 2) {            // CONNACK
+            if (p[1] != 0) {
+                fail(QString("connection refused, reason code %1").arg(p[1]).toLatin1().constData());
+                return;
+            }
+            state = CONNECTED;
+            backoff_ms = 1000;
+            ping_outstanding = false;
+            if (outage_logged || !ever_connected) {
+                qStdErr << "MQTT: Connected to " << cfg.host << ":" << cfg.port << "\n";
+                qStdErr.flush();
+            }
+            ever_connected = true;
+            outage_logged = false;
+            for (const Message &m : inflight) sendPublish(m, true);
+            pump();
+        } else if (type == 4 && body.size() >= 2) {     // PUBACK
+            quint16 id = (p[0] << 8) | p[1];
+            for (int i = 0; i < inflight.size(); i++) {
+                if (inflight[i].id == id) {
+                    inflight.removeAt(i);
+                    acked++;
+                    break;
+                }
+            }
+            pump();
+        } else if (type == 13) {                         // PINGRESP
+            ping_outstanding = false;
+        }
+    }
+
+    void onPingTimer() {
+        if (state == CONNECTED) {
+            if (ping_outstanding) {
+                fail("no ping response");
+                return;
+            }
+            static const char PINGREQ[2] = { (char)0xC0, 0 };
+            out.append(PINGREQ, 2);
+            ping_outstanding = true;
+            flush();
+        } else if (state != IDLE && QDateTime::currentMSecsSinceEpoch() - connect_start_ms > cfg.keepalive_s * 1000LL) {
+            fail("connect timed out");
+        }
+    }
+
+    void closeSocket() {
+        delete read_notifier;
+        delete write_notifier;
+        read_notifier = write_notifier = nullptr;
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+        in.clear();
+        out.clear();
+    }
+
+    // Drop the connection and try again later; messages keep queueing meanwhile
+    void fail(const char *reason) {
+        if (!outage_logged) {
+            qStdErr << "Warning: MQTT broker " << cfg.host << ":" << cfg.port << " unavailable (" << reason
+                    << "), queueing" << (spool_fd >= 0 ? " and spooling" : "") << "\n";
+            qStdErr.flush();
+            outage_logged = true;
+        }
+        closeSocket();
+        state = IDLE;
+        disconnects++;
+        reconnect_timer->start(backoff_ms);
+        backoff_ms = qMin(30000, backoff_ms * 2);
+    }
+
+    Config cfg;
+    State state;
+    int fd;
+    QSocketNotifier *read_notifier;
+    QSocketNotifier *write_notifier;
+    QTimer *reconnect_timer;
+    QByteArray in;
+    QByteArray out;
+
+    QQueue<Message> memory;
+    QList<Message> inflight;
+    quint16 next_id;
+    bool ping_outstanding;
+    int backoff_ms;
+    qint64 connect_start_ms;
+    bool ever_connected;
+    bool outage_logged;
+
+    QString spool_path;
+    int spool_fd;
+    qint64 spool_read;
+    qint64 spool_write;
+
+    qint64 published;
+    qint64 sent;
+    qint64 acked;
+    qint64 spooled;
+    qint64 dropped;
+    qint64 disconnects;     // lost connections and failed attempts
+};
+
+// Minimal MQTT broker stand-in for testing publishers without a real broker.
+// It accepts 3.1.1 and 5.0 clients, acknowledges CONNECT, QoS 1 PUBLISH,
+// SUBSCRIBE and PINGREQ, prints every message it receives on stdout as
+// "topic payload" and forwards it at QoS 0 to subscribers whose filter
+// matches ('+' and '#' wildcards). No retained messages, sessions or QoS 2.
+class MqttBroker : public QObject {
+public:
+    MqttBroker(QObject *parent = nullptr) : QObject(parent), listen_fd(-1) {}
+
+    ~MqttBroker() {
+        for (Client *c : clients) delete c;
+        if (listen_fd >= 0) ::close(listen_fd);
+    }
+
+    bool listen(const QString &addr) {
+        int colon = addr.lastIndexOf(':');
+        QString host = colon >= 0 ? addr.left(colon) : QString();
+        QString port = colon >= 0 ? addr.mid(colon + 1) : addr;
+        struct addrinfo hints, *res = nullptr;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_PASSIVE;
+        if (getaddrinfo(host.isEmpty() ? nullptr : host.toLatin1().constData(), port.toLatin1().constData(),
+                        &hints, &res) != 0 || !res) {
+            return false;
+        }
+        listen_fd = ::socket(res->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int one = 1;
+        bool ok = listen_fd >= 0 && setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) == 0 &&
+                  ::bind(listen_fd, res->ai_addr, res->ai_addrlen) == 0 && ::listen(listen_fd, 16) == 0;
+        freeaddrinfo(res);
+        if (!ok) return false;
+        QSocketNotifier *notifier = new QSocketNotifier(listen_fd, QSocketNotifier::Read, this);
+        connect(notifier, &QSocketNotifier::activated, this, [this]() { onAccept(); });
+        return true;
+    }
+
+private:
+    struct Client {
+        int fd;
+        int version;
+        QSocketNotifier *notifier;
+        QByteArray in;
+        QStringList filters;
+        ~Client() {
+            delete notifier;
+            ::close(fd);
+        }
+    };
+
+    void onAccept() {
+        while (true) {
+            int fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) return;
+            Client *c = new Client;
+            c->fd = fd;
+            c->version = 4;
+            c->notifier = new QSocketNotifier(fd, QSocketNotifier::Read);
+            connect(c->notifier, &QSocketNotifier::activated, this, [this, c]() { onReadable(c); });
+            clients.append(c);
+        }
+    }
+
+    void onReadable(Client *c) {
+        char buf[65536];
+        while (true) {
+            ssize_t n = ::recv(c->fd, buf, sizeof(buf), 0);
+            if (n > 0) {
+                c->in.append(buf, (int)n);
+                continue;
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            drop(c);
+            return;
+        }
+        while (c->in.size() >= 2) {
+            const uchar *p = reinterpret_cast<const uchar*>(c->in.constData());
+            int len = 0, shift = 0, pos = 1;
+            while (pos < c->in.size() && pos <= 4) {
+                len |= (p[pos] & 0x7f) << shift;
+                shift += 7;
+                if (!(p[pos++] & 0x80)) break;
+                if (pos > 4) {
+                    drop(c);
+                    return;
+                }
+            }
+            if ((p[pos - 1] & 0x80) || c->in.size() < pos + len) break;
+            int header = p[0];
+            QByteArray body = c->in.mid(pos, len);
+            c->in.remove(0, pos + len);
+            if (!onPacket(c, header, body)) {
+                drop(c);
+                return;
+            }
+        }
+    }
+
+    bool onPacket(Client *c, int header, const QByteArray &body) {
+        const uchar *p = reinterpret_cast<const uchar*>(body.constData());
+        switch (header >> 4) {
+        case 1: {       // CONNECT: protocol name, level
+            if (body.size() < 7) return false;
+            c->version = p[6];
+            QByteArray ack;
+            ack += (char)0;
+            ack += (char)0;
+            if (c->version == 5) ack += (char)0;
+            send(c, 0x20, ack);
+            return true;
+        }
+        case 3: {       // PUBLISH
+            int qos = (header >> 1) & 3;
+            if (body.size() < 2) return false;
+            int tlen = (p[0] << 8) | p[1];
+            int pos = 2 + tlen;
+            if (body.size() < pos + (qos ? 2 : 0)) return false;
+            QByteArray topic = body.mid(2, tlen);
+            QByteArray id = qos ? body.mid(pos, 2) : QByteArray();
+            pos += qos ? 2 : 0;
+            if (c->version == 5 && !skipProperties(body, pos)) return false;
+            QByteArray payload = body.mid(pos);
+            qStdOut << QString::fromUtf8(topic) << " " << QString::fromUtf8(payload) << "\n";
+            qStdOut.flush();
+            if (qos == 1) {
+                send(c, 0x40, id);
+            }
+            forward(topic, payload);
+            return true;
+        }
+        case 8: {       // SUBSCRIBE: packet id, [properties], (filter, options)*
+            if (body.size() < 2) return false;
+            int pos = 2;
+            if (c->version == 5 && !skipProperties(body, pos)) return false;
+            QByteArray ack = body.left(2);
+            if (c->version == 5) ack += (char)0;
+            while (pos + 2 <= body.size()) {
+                int flen = (p[pos] << 8) | p[pos + 1];
+                if (pos + 2 + flen + 1 > body.size()) return false;
+                c->filters << QString::fromUtf8(body.mid(pos + 2, flen));
+                pos += 2 + flen + 1;
+                ack += (char)0;     // granted QoS 0
+            }
+            send(c, 0x90, ack);
+            return true;
+        }
+        case 12:        // PINGREQ
+            send(c, 0xD0, QByteArray());
+            return true;
+        case 14:        // DISCONNECT
+            return false;
+        default:        // PUBACK from subscribers and anything else: nothing to do
+            return true;
+        }
+    }
+
+    static bool skipProperties(const QByteArray &body, int &pos) {
+        int len = 0, shift = 0;
+        while (pos < body.size()) {
+            uchar b = (uchar)body[pos++];
+            len |= (b & 0x7f) << shift;
+            shift += 7;
+            if (!(b & 0x80)) {
+                pos += len;
+                return pos <= body.size();
+            }
+        }
+        return false;
+    }
+
+    static bool matches(const QString &filter, const QString &topic) {
+        QStringList f = filter.split('/');
+        QStringList t = topic.split('/');
+        for (int i = 0; i < f.size(); i++) {
+            if (f[i] == "#") return true;
+            if (i >= t.size() || (f[i] != "+" && f[i] != t[i])) return false;
+        }
+        return f.size() == t.size();
+    }
+
+    void forward(const QByteArray &topic, const QByteArray &payload) {
+        QString t = QString::fromUtf8(topic);
+        for (Client *c : clients) {
+            for (const QString &f : c->filters) {
+                if (!matches(f, t)) continue;
+                QByteArray body;
+                body += (char)(topic.size() >> 8);
+                body += (char)(topic.size() & 0xff);
+                body += topic;
+                if (c->version == 5) body += (char)0;
+                body += payload;
+                send(c, 0x30, body);
+                break;
+            }
+        }
+    }
+
+    // Short writes are not retried: a subscriber too slow for a local test loses messages
+    void send(Client *c, int header, const QByteArray &body) {
+        QByteArray packet;
+        packet += (char)header;
+        int len = body.size();
+        do {
+            char b = len % 128;
+            len /= 128;
+            if (len > 0) b |= (char)0x80;
+            packet += b;
+        } while (len > 0);
+        packet += body;
+        if (::send(c->fd, packet.constData(), packet.size(), MSG_NOSIGNAL) != packet.size()) {
+            qStdErr << "Warning: MQTT stand-in: short write to a client\n";
+            qStdErr.flush();
+        }
+    }
+
+    void drop(Client *c) {
+        clients.removeOne(c);
+        c->notifier->setEnabled(false);
+        QMetaObject::invokeMethod(this, [c]() { delete c; }, Qt::QueuedConnection);
+    }
+
+    int listen_fd;
+    QList<Client*> clients;
+};
+
+// Host-wide decode admission for instances whose cycle boundaries coincide.
+// Each instance registers its priority and expected decode cost in a small
+// QSharedMemory table at every boundary; after a short gather window each
+// one lays the same table out on 'lanes' parallel lanes (priority first,
+// then shortest decode first) and starts its decode at its own planned
+// offset. Starts are pulled forward where needed so every decode can still
+// finish within its cycle. Slots of instances that stopped registering or
+// exited are reused.
+class StaggerBoard {
+public:
+    static const int GATHER_MS = 25;       // registrations collected before planning
+    static const int COINCIDE_MS = 250;    // boundaries this close form one herd
+    static const int MARGIN_MS = 300;      // planned finish kept ahead of the next boundary
+    static const int MAX_INSTANCES = 64;
+
+    StaggerBoard(int priority, int lanes)
+        : memory("jt9_decode_stagger"), priority(priority), lanes(qMax(1, lanes)), pid(getpid()),
+          admitted(0), total_delay_ms(0) {}
+
+    ~StaggerBoard() {
+        if (!memory.isAttached()) return;
+        memory.lock();
+        Slot *slot = own(table());
+        if (slot) memset(slot, 0, sizeof(Slot));
+        memory.unlock();
+        memory.detach();
+    }
+
+    bool open(QString &error) {
+        if (!memory.attach() && !memory.create(sizeof(Table))) {
+            if (memory.error() != QSharedMemory::AlreadyExists || !memory.attach()) {
+                error = memory.errorString();
+                return false;
+            }
+        }
+        if (memory.size() < (int)sizeof(Table)) {
+            error = "stagger table from an incompatible build";
+            memory.detach();
+            return false;
+        }
+        memory.lock();
+        Table *t = table();
+        if (t->magic != MAGIC) {
+            memset(t, 0, sizeof(Table));
+            t->magic = MAGIC;
+        }
+        memory.unlock();
+        return true;
+    }
+
+    // At the boundary: announce this instance's decode for the cycle
+    void announce(qint64 boundary_ms, int cost_ms, int cycle_ms) {
+        memory.lock();
+        Table *t = table();
+        Slot *slot = own(t);
+        qint64 now = QDateTime::currentMSecsSinceEpoch();
+        for (int i = 0; !slot && i < MAX_INSTANCES; i++) {
+            Slot &s = t->entries[i];
+            if (s.pid == 0 || now - s.heartbeat_ms > 2 * qMax(s.cycle_ms, cycle_ms)
+                || (kill(s.pid, 0) < 0 && errno == ESRCH)) {
+                slot = &s;
+            }
+        }
+        if (slot) {
+            slot->pid = pid;
+            slot->priority = priority;
+            slot->cost_ms = qMax(1, cost_ms);
+            slot->cycle_ms = cycle_ms;
+            slot->boundary_ms = boundary_ms;
+            slot->heartbeat_ms = now;
+        }
+        memory.unlock();
+    }
+
+    // Planned start of this instance's decode, in ms after the boundary,
+    // with its place in the herd
+    int plan(qint64 boundary_ms, int &rank, int &peers) {
+        memory.lock();
+        const Table *t = table();
+        qint64 now = QDateTime::currentMSecsSinceEpoch();
+        std::vector<Slot> herd;
+        for (int i = 0; i < MAX_INSTANCES; i++) {
+            const Slot &s = t->entries[i];
+            if (s.pid != 0 && qAbs(s.boundary_ms - boundary_ms) < COINCIDE_MS
+                && now - s.heartbeat_ms < 2 * s.cycle_ms) {
+                herd.push_back(s);
+            }
+        }
+        memory.unlock();
+
+        std::sort(herd.begin(), herd.end(), [](const Slot &a, const Slot &b) {
+            if (a.priority != b.priority) return a.priority > b.priority;
+            if (a.cost_ms != b.cost_ms) return a.cost_ms < b.cost_ms;
+            return a.pid < b.pid;
+        });
+
+        // List scheduling: each decode takes the lane that frees up first
+        std::vector<int> lane_free(lanes, 0);
+        int start = 0;
+        rank = 0;
+        peers = (int)herd.size();
+        for (size_t i = 0; i < herd.size(); i++) {
+            std::vector<int>::iterator lane = std::min_element(lane_free.begin(), lane_free.end());
+            int latest = qMax(0, herd[i].cycle_ms - MARGIN_MS - herd[i].cost_ms);
+            int s = qMin(*lane, latest);
+            *lane = s + herd[i].cost_ms;
+            if (herd[i].pid == pid) {
+                start = s;
+                rank = (int)i + 1;
+            }
+        }
+        return start;
+    }
+
+    void countAdmission(int delay_ms) {
+        admitted++;
+        total_delay_ms += delay_ms;
+    }
+
+    double averageDelayMs() const { return admitted > 0 ? (double)total_delay_ms / admitted : 0.0; }
+
+    QString describe() const {
+        return QString("priority %1, %2 lane(s)").arg(priority).arg(lanes);
+    }
+
+private:
+    static const quint32 MAGIC = 0x4a395354;   // "J9ST"
+
+    struct Slot {
+        qint32 pid;
+        qint32 priority;
+        qint32 cost_ms;
+        qint32 cycle_ms;
+        qint64 boundary_ms;
+        qint64 heartbeat_ms;
+    };
+
+    struct Table {
+        quint32 magic;
+        quint32 reserved;
+        Slot entries[MAX_INSTANCES];
+    };
+
+    Table *table() { return static_cast<Table*>(memory.data()); }
+
+    Slot *own(Table *t) {
+        for (int i = 0; i < MAX_INSTANCES; i++) {
+            if (t->entries[i].pid == pid) return &t->entries[i];
+        }
+        return nullptr;
+    }
+
+    QSharedMemory memory;
+    int priority;
+    int lanes;
+    qint32 pid;
+    qint64 admitted;
+    qint64 total_delay_ms;
+};
+
+// Asynchronous stream decoder - matches WSJT-X architecture
+//
+// Each cycle is modelled as a CycleJob passing through explicit stages
+// (extract -> condition -> dispatch -> collect -> post-process -> publish).
+// Extract and condition run on the DSP pool; dispatch, collect and publish
+// run on the event loop. Jobs wait for a free jt9 worker in a bounded queue,
+// so with more than one worker consecutive cycles decode concurrently while
+// output is still published in cycle order.
+class StreamDecoder : public QObject {
+    Q_OBJECT
+    
+public:
+    StreamDecoder(SampleSource *source, const QList<Jt9Worker*> &workers, const ModeConfig &mode_cfg,
+                  DspPool *dsp, SpectrumMonitor *spectrum = nullptr, HintEngine *hints = nullptr,
+                  const QList<Jt9Worker*> &hint_workers = QList<Jt9Worker*>(),
+                  TxSchedule *schedule = nullptr, QObject *parent = nullptr)
+        : QObject(parent), workers(workers), hint_workers(hint_workers), mode(mode_cfg),
+          hints(hints), schedule(schedule), source_latency_ms(source->latencyMs()),
+          dispatch_queue(qMax(2, workers.size() * 2) + (hints ? 32 : 0)),
+          running(workers.size() + hint_workers.size()), cycles(32),
+          total_decodes(0), skipped_cycles(0), watchdog_fires(0), published_cycles(0),
+          cost(mode_cfg.cycle_ms / 4.0)
+    {
+        SAMPLES_PER_CYCLE = (RX_SAMPLE_RATE * mode.cycle_ms) / 1000;
+        BUFFER_SIZE = NTMAX * RX_SAMPLE_RATE;
+        for (int s = 0; s < STAGE_COUNT; s++) stage_total_ns[s] = 0;
+        remove_dc = false;
+        this->source = source;
+        this->spectrum = spectrum;
+        this->dsp = dsp;
+        schedule_timer = nullptr;
+        handover_fd = -1;
+        handover_notifier = nullptr;
+        draining = false;
+        input_ended = false;
+        gap_skipped = 0;
+        resumed = false;
+        last_boundary_ms = 0;
+        batch = nullptr;
+        batch_ms_per_audio_s = 0.0;
+        last_nsynced = 0;
+        last_features.band_db = -150.0;
+        last_features.candidates = 0;
+        live_late = 0;
+        hopper = nullptr;
+        rig = nullptr;
+        retune_timer = nullptr;
+        settle_ms = 0;
+        current_dial_hz = 0;
+        retune_failures = 0;
+        cluster = nullptr;
+        watch = nullptr;
+        mqtt = nullptr;
+        stagger = nullptr;
+        alloc_check_after = 0;
+        last_allocs[ALLOC_CYCLE] = last_allocs[ALLOC_LINE] = 0;
+        job_pool.reserve(64);
+        sample_pool.reserve(8);
+
+        // Parameters set up in main() in the first worker's segment; every job starts from them
+        main_params = workers.first()->data()->params;
+        probe.setPassband(main_params.nfa, main_params.nfb);
+        
+        // Allocate circular buffer (memfd-backed so it can be handed over)
+        ring.create(BUFFER_SIZE);
+        circ_buffer = ring.samples;
+        
+        // Audio reader thread, started by start()
+        reader_thread = new AudioReaderThread(source, circ_buffer, BUFFER_SIZE, &buffer_mutex, spectrum);
+        
+        // Connect jt9 output to our handlers (WSJT-X style)
+        for (Jt9Worker *w : workers + hint_workers) {
+            watchWorker(w);
+        }
+
+        // Extract and condition stages run on the DSP pool's ingest lane, off the event loop
+        stager = new CycleStager(8, dsp, 0,
+            [this](const CycleJobPtr &job, int write_pos) {
+                extract(job, write_pos);
+                condition(job);
+                muteRetune(job);
+                measureFeatures(job);
+            },
+            [this](const CycleJobPtr &job) { onConditioned(job); }, this);
+
+        // Rig control runs here, off the event loop; it blocks on the network, so not on the DSP pool
+        stage_pool.setMaxThreadCount(2);
+
+        // DSP pool lane counts and queue latency, decode yield and cost model error, once a minute
+        QTimer *pool_stats_timer = new QTimer(this);
+        connect(pool_stats_timer, &QTimer::timeout, this, [this]() {
+            printPoolStats();
+            printYieldStats();
+            printCostStats();
+            if (mqtt) printMqttStats();
+        });
+        pool_stats_timer->start(60000);
+        yield_collect_ns = 0;
+        yield_late_mark = 0;
+
+        // Timer for cycle boundaries
+        cycle_timer = new QTimer(this);
+        connect(cycle_timer, &QTimer::timeout, this, &StreamDecoder::onCycleTimer);
+
+        // Watchdog: recovers a worker if jt9 never sends <DecodeFinished>
+        decode_watchdog = new QTimer(this);
+        connect(decode_watchdog, &QTimer::timeout, this, &StreamDecoder::onDecodeWatchdog);
+        
+        // PTT / TX-sequence control polling
+        if (schedule) {
+            schedule_timer = new QTimer(this);
+            connect(schedule_timer, &QTimer::timeout, this, [this]() {
+                struct timespec ts;
+                clock_gettime(CLOCK_REALTIME, &ts);
+                this->schedule->poll(ts.tv_sec * 1000LL + ts.tv_nsec / 1000000LL);
+            });
+            schedule_timer->start(250);
+        }
+
+        qStdErr << "Stream mode: Reading " << source->describe() << "\n";
+        qStdErr << mode.name << " cycle time: " << mode.cycle_ms << " ms (" << SAMPLES_PER_CYCLE << " samples)\n";
+        qStdErr << "Triggering decodes at UTC-aligned " << (mode.cycle_ms / 1000.0) << " second boundaries";
+        if (source_latency_ms > 0) {
+            qStdErr << " + " << source_latency_ms << " ms source latency";
+        }
+        qStdErr << "\n";
+        qStdErr << "Decode workers: " << workers.size() << "\n";
+        qStdErr << "DSP pool: " << dsp->threadCount() << " thread(s)\n";
+        qStdErr.flush();
+    }
+    
+    ~StreamDecoder() {
+        stager->stop();
+        stage_pool.waitForDone();
+        if (reader_thread) {
+            reader_thread->stop();
+            reader_thread->wait();
+            delete reader_thread;
+        }
+        ring.release();
+        if (handover_fd >= 0) {
+            ::close(handover_fd);
+            if (!draining) unlink(QFile::encodeName(handover_path).constData());
+        }
+
+        if (hopper) {
+            qStdErr << "Band rotation: " << hopper->summary() << "\n";
+        }
+        // Retune tasks on stage_pool hold the rig client, so both go only after it drained
+        delete hopper;
+        delete rig;
+        if (cluster) {
+            qStdErr << "Cluster: " << cluster->summary() << "\n";
+        }
+        if (published_cycles > 0) {
+            qStdErr << "Stage averages over " << published_cycles << " cycles:";
+            for (int s = 0; s < STAGE_COUNT; s++) {
+                qStdErr << " " << STAGE_NAMES[s] << "="
+                        << QString::number(stage_total_ns[s] / 1e6 / published_cycles, 'f', 3) << "ms";
+            }
+            qStdErr << "\n";
+            qStdErr.flush();
+        }
+    }
+
+    // Subtract each cycle's DC offset before jt9 sees it (otherwise only measured)
+    void setRemoveDc(bool on) { remove_dc = on; }
+
+    // Continue from a ring handed over by the previous process (before start())
+    bool resumeFrom(const HandoverState &state, int ring_fd) {
+        if (state.ring_size != BUFFER_SIZE) {
+            qStdErr << "Error: handed-over ring has " << state.ring_size << " samples, expected " << BUFFER_SIZE << "\n";
+            qStdErr.flush();
+            return false;
+        }
+        SharedRing handed;
+        if (!handed.attach(ring_fd, state.ring_size)) {
+            qStdErr << "Error: cannot map handed-over ring\n";
+            qStdErr.flush();
+            return false;
+        }
+        ring.release();
+        ring = handed;
+        circ_buffer = ring.samples;
+        delete reader_thread;
+        reader_thread = new AudioReaderThread(source, circ_buffer, BUFFER_SIZE, &buffer_mutex, spectrum);
+        reader_thread->resumeAt(state.write_pos, state.total_samples);
+        total_decodes = state.next_cycle_num - 1;
+        last_boundary_ms = state.last_boundary_ms;
+        resumed = true;
+
+        qStdErr << "Resumed ring at sample " << state.total_samples << ", newest sample "
+                << (getUtcMs() - state.newest_utc_ms) << " ms old, next cycle #" << state.next_cycle_num << "\n";
+        qStdErr.flush();
+        return true;
+    }
+
+    // Fill idle decode capacity with files from a batch spool
+    void setBatchSpool(BatchSpool *spool) {
+        batch = spool;
+        QTimer *timer = new QTimer(this);
+        connect(timer, &QTimer::timeout, this, &StreamDecoder::dispatchJobs);
+        timer->start(1000);
+    }
+
+    // Hop one receiver between bands at cycle boundaries through rigctld; takes ownership of both
+    void setBandHopper(BandHopper *bands, RigctldClient *client, int settle) {
+        hopper = bands;
+        rig = client;
+        settle_ms = settle;
+        retune_timer = new QTimer(this);
+        retune_timer->setSingleShot(true);
+        retune_timer->setTimerType(Qt::PreciseTimer);
+        connect(retune_timer, &QTimer::timeout, this, &StreamDecoder::onRetuneTimer);
+    }
+
+    // Raise alerts for published decodes that match a watchlist
+    void setWatchlist(WatchlistMonitor *monitor) { watch = monitor; }
+
+    // Host-wide staggering: main decodes start at this instance's planned offset
+    void setStagger(StaggerBoard *board) { stagger = board; }
+
+    // Publish each cycle's decodes as one MQTT message on "<topic_base>/<band>";
+    // 'band' is used unless band hopping supplies the cycle's dial frequency
+    void setMqtt(MqttPublisher *publisher, const QString &topic_base, const QString &band) {
+        mqtt = publisher;
+        mqtt_topic = topic_base;
+        mqtt_band = band;
+    }
+
+    // Allocation-counting builds: fail once a cycle after the first 'warmup' allocates
+    void setAllocCheck(int warmup) { alloc_check_after = warmup; }
+
+    // Largest block the reader hands to the ring, in ms of audio (before start())
+    void setReadBlockMs(int ms) { reader_thread->setBlockMs(ms); }
+
+    // Offer main decodes to decode nodes; anything they cannot take runs here
+    void setCluster(const QStringList &nodes) {
+        cluster = new ClusterClient(nodes,
+            [this](const CycleJobPtr &job, const QStringList &lines, int nsynced, int ndecoded) {
+                onRemoteResult(job, lines, nsynced, ndecoded);
+            },
+            [this](const CycleJobPtr &job) { onRemoteFallback(job); }, this);
+    }
+
+    // Accept handover requests from a newer instance on a Unix socket
+    bool listenForHandover(const QString &path) {
+        struct sockaddr_un addr;
+        int fd = unix_socket_address(path, addr);
+        if (fd < 0) return false;
+        unlink(addr.sun_path);
+        if (::bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || ::listen(fd, 1) != 0) {
+            ::close(fd);
+            return false;
+        }
+        handover_fd = fd;
+        handover_path = path;
+        handover_notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+        connect(handover_notifier, &QSocketNotifier::activated, this, &StreamDecoder::onHandoverRequest);
+        qStdErr << "Accepting handover requests on " << path << "\n";
+        qStdErr.flush();
+        return true;
+    }
+    
+    void start() {
+        reader_thread->start();
+
+        // Tune the first band now; later retunes run just before each boundary
+        if (hopper) {
+            qint64 cycle_start = (getUtcMs() / mode.cycle_ms) * mode.cycle_ms;
+            sendRetune(cycle_start);
+            scheduleRetune(cycle_start);
+        }
+
+        qStdErr << "Waiting for first cycle boundary...\n";
+        qStdErr.flush();
+        
+        // Wait for enough samples to accumulate
+        while (reader_thread->getTotalSamples() < SAMPLES_PER_CYCLE) {
+            QThread::msleep(100);
+            QCoreApplication::processEvents();
+        }
+        
+        // A boundary that passed while the previous process was handing over
+        if (resumed && (getUtcMs() / mode.cycle_ms) * mode.cycle_ms > last_boundary_ms) {
+            qStdErr << "Decoding the cycle that ended during handover\n";
+            qStdErr.flush();
+            onCycleTimer();
+        }
+
+        // Calculate time to next cycle boundary
+        qint64 wait_ms = msToNextCycle();
+        if (wait_ms > 100) {
+            qStdErr << "Waiting " << wait_ms << " ms for cycle boundary...\n";
+            qStdErr.flush();
+            QThread::msleep(wait_ms);
+        }
+        
+        qStdErr << "Starting decode loop...\n";
+        qStdErr.flush();
+        
+        // Start cycle timer - triggers at each cycle boundary
+        cycle_timer->start(mode.cycle_ms);
+        decode_watchdog->start(1000);
+        
+        // Trigger first decode immediately
+        onCycleTimer();
+    }
+    
+private slots:
+    // Called at each cycle boundary: create the cycle's job and start extraction
+    void onCycleTimer() {
+        AllocScope scope(ALLOC_CYCLE);
+
+        // Check if jt9 is still running
+        if (!workersRunning()) {
+            qStdErr << "Error: jt9 process is not running!\n";
+            qStdErr.flush();
+            QCoreApplication::quit();
+            return;
+        }
+        
+        // Input ended (stdin EOF): publish the cycles in flight, then exit
+        // instead of decoding the stale ring over and over
+        if (reader_thread->isFinished() && !draining) {
+            qStdErr << "Input ended, finishing " << cycles.size() << " in-flight cycle(s)\n";
+            qStdErr.flush();
+            cycle_timer->stop();
+            input_ended = true;
+            draining = true;
+            checkDrained();
+            return;
+        }
+
+        // Check if we have enough samples
+        if (reader_thread->getTotalSamples() < SAMPLES_PER_CYCLE) {
+            qStdErr << "Warning: Not enough samples yet (" << reader_thread->getTotalSamples() << " < " << SAMPLES_PER_CYCLE << ")\n";
+            qStdErr.flush();
+            return;
+        }
+
+        // Get current UTC time (of the samples at the ring head)
+        qint64 utc_ms = getUtcMs();
+        time_t now = utc_ms / 1000;
+        struct tm *tm_info = gmtime(&now);
+        int nutc = tm_info->tm_hour * 100 + tm_info->tm_min;
+
+        // Calculate precise time for logging
+        qint64 ms_in_minute = utc_ms % 60000;
+        double seconds_in_minute = ms_in_minute / 1000.0;
+
+        // The cycle that just ended (the timer may fire slightly early or late)
+        qint64 cycle_start_ms = ((utc_ms + mode.cycle_ms / 2) / mode.cycle_ms - 1) * mode.cycle_ms;
+        last_boundary_ms = cycle_start_ms + mode.cycle_ms;
+        bool even_seq = TxSchedule::isEven(cycle_start_ms, mode.cycle_ms);
+        bool monitor = false;
+        if (hopper) {
+            // Forget retunes older than the cycle that just ended (skipped cycles included)
+            pruneRetunes(cycle_start_ms);
+        }
+        if (schedule) {
+            if (!schedule->wantSequence(even_seq)) {
+                schedule->countSeqSkip();
+                return;
+            }
+            if (schedule->isTxCycle(cycle_start_ms)) {
+                if (!schedule->monitorTx()) {
+                    schedule->countTxSkip();
+                    qStdErr << "Skipping TX cycle at " << QString("%1").arg(nutc, 4, 10, QChar('0'))
+                            << " +" << QString::number(seconds_in_minute, 'f', 3) << "s\n";
+                    qStdErr.flush();
+                    return;
+                }
+                monitor = true;
+            }
+        }
+        if (source->lostAudio(cycle_start_ms, cycle_start_ms + mode.cycle_ms)) {
+            gap_skipped++;
+            qStdErr << "Skipping cycle at " << QString("%1").arg(nutc, 4, 10, QChar('0'))
+                    << " +" << QString::number(seconds_in_minute, 'f', 3) << "s - capture audio gap (total: "
+                    << gap_skipped << ")\n";
+            qStdErr.flush();
+            return;
+        }
+
+        total_decodes++;
+        LineBuffer log;
+        log << "Triggering decode #" << total_decodes << " at " << ZeroPadded(nutc, 4)
+            << " +" << Fixed(seconds_in_minute, 3) << "s (" << SAMPLES_PER_CYCLE << " samples)\n";
+        qStdErr.flush();
+        log.writeTo(stderr);
+
+        CycleJobPtr job = newJob(total_decodes, nutc, false);
+        job->deadline_ms = utc_ms + msToNextCycle();
+        job->even_seq = even_seq;
+        job->monitor = monitor;
+        job->samples = cycleBuffer();
+        if (stagger && !job->monitor) {
+            stagger->announce(job->deadline_ms - mode.cycle_ms, (int)expectedPassMs(), mode.cycle_ms);
+        }
+        if (hopper) {
+            job->dial_hz = dialFor(cycle_start_ms);
+            if (retune_boundaries.contains(cycle_start_ms)) {
+                job->mute_head = qMin(SAMPLES_PER_CYCLE / 2, settle_ms * RX_SAMPLE_RATE / 1000);
+            }
+            if (retune_boundaries.contains(cycle_start_ms + mode.cycle_ms)) {
+                job->mute_tail = RETUNE_LEAD_MS * RX_SAMPLE_RATE / 1000;
+            }
+        }
+
+        cycles.insert(job->cycle_num, CycleState());
+
+        // Snapshot the ring position now; the copy itself runs on the stage thread
+        int write_pos = reader_thread->getWritePos();
+        job->reader_lag_ms = (int)(reader_thread->takeMaxLagUs() / 1000);
+        job->reader_head_ms = (int)((monotonic_ns() - reader_thread->lastArrivalNs()) / 1000000);
+        if (!stager->submit(job, write_pos)) {
+            skipCycle(job->cycle_num);
+            advancePublish();
+        }
+    }
+
+    // Just before a boundary: retune for the cycle that starts there
+    void onRetuneTimer() {
+        qint64 boundary = ((getUtcMs() + source_latency_ms + RETUNE_LEAD_MS + mode.cycle_ms / 2) / mode.cycle_ms) * mode.cycle_ms;
+        sendRetune(boundary);
+        scheduleRetune(boundary);
+    }
+
+    // A newer instance asked for our state: stop reading, send the ring and
+    // descriptors, then stop triggering and exit once in-flight cycles are out
+    void onHandoverRequest() {
+        int client = ::accept4(handover_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0) return;
+        struct timeval tv = { 2, 0 };
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        char request[32];
+        ssize_t n = ::recv(client, request, sizeof(request) - 1, 0);
+        if (n <= 0 || strncmp(request, "HANDOVER 1", 10) != 0 || ring.fd < 0) {
+            ::close(client);
+            return;
+        }
+
+        reader_thread->stop();
+        reader_thread->wait();
+        cycle_timer->stop();
+
+        HandoverState state;
+        memset(&state, 0, sizeof(state));
+        memcpy(state.magic, "JT9H", 4);
+        state.version = HANDOVER_VERSION;
+        state.ring_size = BUFFER_SIZE;
+        state.write_pos = reader_thread->getWritePos();
+        state.total_samples = reader_thread->getTotalSamples();
+        state.newest_utc_ms = getUtcMs();
+        state.last_boundary_ms = last_boundary_ms;
+        state.next_cycle_num = total_decodes + 1;
+        state.pending_byte = source->pendingByte();
+        int fds[3] = { ring.fd, STDOUT_FILENO, source->handoverFd() };
+        state.nfds = fds[2] >= 0 ? 3 : 2;
+
+        qStdOut.flush();
+        bool ok = send_with_fds(client, &state, sizeof(state), fds, state.nfds);
+        ::close(client);
+        if (!ok) {
+            qStdErr << "Handover failed, continuing\n";
+            qStdErr.flush();
+            source->resume();
+            reader_thread->start();
+            QTimer::singleShot(msToNextCycle(), this, [this]() {
+                cycle_timer->start(mode.cycle_ms);
+                onCycleTimer();
+            });
+            return;
+        }
+
+        qStdErr << "Handed over at sample " << state.total_samples << " (next cycle #" << state.next_cycle_num
+                << "), draining " << cycles.size() << " in-flight cycle(s)\n";
+        qStdErr.flush();
+        draining = true;
+        handover_notifier->setEnabled(false);
+        checkDrained();
+    }
+
+    // Checks running jobs; recovers a worker if jt9 did not finish within 2 cycle periods
+    void onDecodeWatchdog() {
+        qint64 now_ns = monotonic_ns();
+        QList<Jt9Worker*> stuck;
+        for (FlatMap<Jt9Worker*, CycleJobPtr>::const_iterator it = running.constBegin(); it != running.constEnd(); ++it) {
+            if (it.value() && now_ns - it.value()->stage_start_ns > mode.cycle_ms * 2 * 1000000LL) {
+                stuck.append(it.key());
+            }
+        }
+        for (Jt9Worker *w : stuck) {
+            recoverWorker(w);
+        }
+        if (!stuck.isEmpty()) {
+            advancePublish();
+            dispatchJobs();
+        }
+    }
+
+    void jt9Finished(int exitCode, QProcess::ExitStatus exitStatus) {
+        qStdErr << "Error: jt9 process exited unexpectedly (code: " << exitCode << ")\n";
+        qStdErr.flush();
+        QCoreApplication::quit();
+    }
+    
+    void jt9Error(QProcess::ProcessError error) {
+        qStdErr << "Error: jt9 process error: " << error << "\n";
+        qStdErr.flush();
+        QCoreApplication::quit();
+    }
+    
+    // Decode yield over the cycles published since the previous line
+    void printYieldStats() {
+        if (yield_total.cycles == 0) return;
+        LineBuffer out;
+        out << "<YieldStats>"
+            << " cycles=" << yield_total.cycles
+            << " decoded=" << yield_total.ndecoded
+            << " decodes=" << yield_total.decodes
+            << " depth=" << main_params.ndepth
+            << " workers=" << workers.size()
+            << " collect_avg_ms=" << Fixed(yield_collect_ns / 1e6 / yield_total.cycles, 1)
+            << " late_cycles=" << live_late - yield_late_mark;
+        yield_total.write(out, main_params.nfa, main_params.nfb);
+        out << " </YieldStats>\n";
+        qStdOut.flush();
+        out.writeTo(stdout);
+        yield_total.reset();
+        yield_collect_ns = 0;
+        yield_late_mark = live_late;
+    }
+
+    void printCostStats() {
+        if (cost.windowPasses() == 0) return;
+        LineBuffer out;
+        out << "<CostStats>";
+        cost.writeStats(out);
+        out << " </CostStats>\n";
+        qStdOut.flush();
+        out.writeTo(stdout);
+        cost.resetErrors();
+    }
+
+    void printMqttStats() {
+        qStdOut << "<MqttStats>" << mqtt->takeStats() << " </MqttStats>\n";
+        qStdOut.flush();
+    }
+
+    void printPoolStats() {
+        qStdOut << "<PoolStats>" << dsp->takeStats();
+        if (spectrum) qStdOut << " spectrum_dropped=" << spectrum->droppedSamples();
+        qStdOut << " </PoolStats>\n";
+        qStdOut.flush();
+    }
+
+private:
+    // Per-cycle publishing state, kept until the cycle's output is complete
+    struct CycleState {
+        CycleJobPtr main;
+        bool main_done;
+        bool dropped;               // skipped or abandoned: no stats are published
+        int hints_outstanding;
+        int hint_passes;
+        int hint_extra;
+        double hint_cpu_s;
+        QStringList main_lines;     // collected but not yet published
+        QStringList hint_lines;
+        QSet<QString> messages;     // for deduplicating hint results
+        DecodeYield yield;
+        QList<DecodeRecord> records;  // MQTT batch, in publishing order
+        CycleState() : main_done(false), dropped(false), hints_outstanding(0),
+                       hint_passes(0), hint_extra(0), hint_cpu_s(0.0) {}
+    };
+
+    // Jobs and cycle buffers are reused once nothing but the pool holds them
+    CycleJobPtr newJob(int cycle_num, int nutc, bool hint) {
+        CycleJobPtr job;
+        for (const CycleJobPtr &pooled : job_pool) {
+            if (pooled.use_count() == 1) {
+                job = pooled;
+                *job = CycleJob();
+                break;
+            }
+        }
+        if (!job) {
+            job = std::make_shared<CycleJob>();
+            job_pool.push_back(job);
+        }
+        job->cycle_num = cycle_num;
+        job->nutc = nutc;
+        job->deadline_ms = 0;
+        job->hint = hint;
+        job->even_seq = false;
+        job->monitor = false;
+        job->batch = false;
+        job->deferred = false;
+        job->dial_hz = 0;
+        job->mute_head = 0;
+        job->mute_tail = 0;
+        job->dc_offset = 0.0;
+        job->rms = 0.0;
+        job->clipped = 0;
+        job->features.band_db = -150.0;
+        job->features.candidates = 0;
+        job->prev_nsynced = 0;
+        job->predicted_ms = 0.0;
+        job->worker = nullptr;
+        job->cpu_start = 0.0;
+        job->nsynced = 0;
+        job->ndecoded = 0;
+        job->reader_lag_ms = 0;
+        job->reader_head_ms = 0;
+        for (int s = 0; s < STAGE_COUNT; s++) job->stage_ns[s] = 0;
+        job->beginStage();
+        return job;
+    }
+
+    std::shared_ptr<std::vector<short> > cycleBuffer() {
+        for (const std::shared_ptr<std::vector<short> > &pooled : sample_pool) {
+            if (pooled.use_count() == 1) return pooled;
+        }
+        sample_pool.push_back(std::make_shared<std::vector<short> >(SAMPLES_PER_CYCLE));
+        return sample_pool.back();
+    }
+
+    // Stage 1 (stage thread): copy the most recent cycle window out of the ring
+    void extract(const CycleJobPtr &job, int write_pos) {
+        job->beginStage();
+        extract_cycle(circ_buffer, BUFFER_SIZE, &buffer_mutex, write_pos, job->samples->data(), SAMPLES_PER_CYCLE);
+        job->endStage(STAGE_EXTRACT);
+    }
+
+    // Stage 2 (stage thread): measure levels; remove the DC offset (common on SDR audio) only if asked
+    void condition(const CycleJobPtr &job) {
+        job->beginStage();
+        condition_cycle(job->samples->data(), SAMPLES_PER_CYCLE, remove_dc, job->dc_offset, job->rms, job->clipped);
+        job->endStage(STAGE_CONDITION);
+    }
+
+    // Stage 2c (stage thread): cost model inputs, after muting so a retune transient is not counted
+    void measureFeatures(const CycleJobPtr &job) {
+        job->beginStage();
+        job->features = probe.measure(job->samples->data(), SAMPLES_PER_CYCLE);
+        job->endStage(STAGE_CONDITION);
+    }
+
+    // Back on the event loop: queue the main job and its hint passes for dispatch
+    void onConditioned(const CycleJobPtr &job) {
+        AllocScope scope(ALLOC_CYCLE);
+        job->beginStage();
+        CycleState &cs = cycles[job->cycle_num];
+        cs.main = job;
+
+        // Predict the pass before it is queued; one that cannot make its
+        // deadline even on an idle worker is flagged now, not after it overruns
+        job->prev_nsynced = last_nsynced;
+        job->predicted_ms = cost.predict(costKind(job), job->features, job->prev_nsynced);
+        last_features = job->features;
+        qint64 left_ms = job->deadline_ms - getUtcMs();
+        if (!job->monitor && job->predicted_ms > left_ms) {
+            cost.countPredictedLate();
+            qStdErr << "Warning: Cycle #" << job->cycle_num << " predicted to decode in "
+                    << (int)job->predicted_ms << " ms with " << left_ms << " ms to its deadline\n";
+            qStdErr.flush();
+        }
+
+        // A main job still queued from an earlier cycle is now stale
+        dropStaleJobs();
+
+        if (cluster && offerRemote(job)) {
+            // Decoding on a cluster node; the result or a fallback comes back later
+        } else if (stagger && !job->monitor) {
+            admitLater(job, getUtcMs());
+            return;
+        } else if (!dispatch_queue.push(job)) {
+            skipCycle(job->cycle_num);
+        }
+        queueHints(job);
+        dispatchJobs();
+    }
+
+    // Stagger mode: after the gather window, wait for this instance's planned
+    // start in the host-wide herd, then queue the cycle as usual
+    void admitLater(const CycleJobPtr &job, qint64 ready_ms) {
+        qint64 boundary_ms = job->deadline_ms - mode.cycle_ms;
+        qint64 gather_ms = boundary_ms + StaggerBoard::GATHER_MS - getUtcMs();
+        if (gather_ms > 0) {
+            QTimer::singleShot((int)gather_ms, this, [this, job, ready_ms]() { admitLater(job, ready_ms); });
+            return;
+        }
+        int offset = stagger->plan(boundary_ms, job->admit_rank, job->admit_peers);
+        qint64 delay_ms = qMax<qint64>(0, boundary_ms + offset - getUtcMs());
+        job->admit_delay_ms = (int)(getUtcMs() + delay_ms - ready_ms);
+        QTimer::singleShot((int)delay_ms, this, [this, job]() { admit(job); });
+    }
+
+    void admit(const CycleJobPtr &job) {
+        if (!cycles.contains(job->cycle_num)) return;
+        stagger->countAdmission(job->admit_delay_ms);
+        dropStaleJobs();
+        if (!dispatch_queue.push(job)) {
+            skipCycle(job->cycle_num);
+        }
+        queueHints(job);
+        dispatchJobs();
+    }
+
+    // Main pass duration for the next cycle, from the latest cycle's inputs
+    double expectedPassMs() const {
+        return cost.predict(DecodeCostModel::KIND_MAIN, last_features, last_nsynced);
+    }
+
+    DecodeCostModel::Kind costKind(const CycleJobPtr &job) const {
+        return job->hint ? DecodeCostModel::KIND_HINT
+             : job->monitor ? DecodeCostModel::KIND_MONITOR : DecodeCostModel::KIND_MAIN;
+    }
+
+    // Queue AP hint passes for this cycle from what earlier cycles heard
+    void queueHints(const CycleJobPtr &job) {
+        CycleState &cs = cycles[job->cycle_num];
+        if (hints && !job->monitor) {
+            QList<HintCandidate> targets = hints->candidates(job->cycle_num);
+            for (const HintCandidate &c : targets) {
+                CycleJobPtr hj = newJob(job->cycle_num, job->nutc, true);
+                hj->candidate = c;
+                hj->samples = job->samples;
+                hj->deadline_ms = job->deadline_ms;
+                hj->features = job->features;
+                hj->prev_nsynced = job->prev_nsynced;
+                hj->predicted_ms = cost.predict(DecodeCostModel::KIND_HINT, hj->features, hj->prev_nsynced);
+                if (!dispatch_queue.push(hj)) break;
+                cs.hints_outstanding++;
+            }
+        }
+    }
+
+    // Cluster mode: send the main job to a decode node if one can meet its deadline
+    bool offerRemote(const CycleJobPtr &job) {
+        decltype(dec_data_t::params) params;
+        prepareParams(job, params);
+        if (!cluster->submit(job, params, mode.ihsym, job->deadline_ms + source_latency_ms, job->predicted_ms)) {
+            return false;
+        }
+        job->endStage(STAGE_DISPATCH);
+        job->beginStage();
+        return true;
+    }
+
+    // Cluster mode: a decode node returned the main job's lines
+    void onRemoteResult(const CycleJobPtr &job, const QStringList &lines, int nsynced, int ndecoded) {
+        if (!cycles.contains(job->cycle_num)) return;
+        job->nsynced = nsynced;
+        job->ndecoded = ndecoded;
+        job->endStage(STAGE_COLLECT);
+        CycleState &cs = cycles[job->cycle_num];
+        cs.main_lines.append(lines);
+        cs.main_done = true;
+        if (getUtcMs() > job->deadline_ms) live_late++;
+        if (job->cycle_num == cycles.firstKey()) {
+            publishMainLines(cs);
+        }
+        advancePublish();
+        dispatchJobs();
+        checkDrained();
+    }
+
+    // Cluster mode: no node decoded the job in time; decode it here if it still can be
+    void onRemoteFallback(const CycleJobPtr &job) {
+        if (!cycles.contains(job->cycle_num) || cycles[job->cycle_num].main_done) return;
+        if (getUtcMs() >= job->deadline_ms || !dispatch_queue.push(job)) {
+            skipCycle(job->cycle_num);
+            advancePublish();
+            checkDrained();
+            return;
+        }
+        dispatchJobs();
+    }
+
+    // Stage 2b (stage thread): silence the audio around a band change so transients and
+    // the other band's tail never reach jt9 (signals start 0.5 s into a cycle)
+    void muteRetune(const CycleJobPtr &job) {
+        short *x = job->samples->data();
+        if (job->mute_head > 0) {
+            memset(x, 0, job->mute_head * sizeof(short));
+        }
+        if (job->mute_tail > 0) {
+            memset(x + SAMPLES_PER_CYCLE - job->mute_tail, 0, job->mute_tail * sizeof(short));
+        }
+    }
+
+    // Stage 3: hand queued jobs to idle workers (main jobs first)
+    void dispatchJobs() {
+        dropStaleJobs();
+        QVector<CycleJobPtr> &q = dispatch_queue.raw();
+        for (int i = 0; i < q.size();) {
+            CycleJobPtr job = q[i];
+            Jt9Worker *w = idleWorkerFor(job);
+            if (!w) {
+                i++;
+                continue;
+            }
+            q.removeAt(i);
+            startJob(job, w);
+        }
+        dispatchBatch();
+    }
+
+    Jt9Worker *idleWorkerFor(const CycleJobPtr &job) {
+        if (job->hint) {
+            // Dedicated hint workers first
+            for (Jt9Worker *w : hint_workers) {
+                if (!running.contains(w)) return w;
+            }
+            // A decode worker only if no main job waits and the pass fits before the boundary
+            for (const CycleJobPtr &queued : dispatch_queue.raw()) {
+                if (!queued->hint) return nullptr;
+            }
+            if (msToNextCycle() < job->predicted_ms + 500) return nullptr;
+            if (!cycles.value(job->cycle_num).main_done) return nullptr;
+        }
+        for (Jt9Worker *w : workers) {
+            if (!running.contains(w)) return w;
+        }
+        return nullptr;
+    }
+    
+    // True while the jt9 process of every decode and hint worker is alive;
+    // checked every cycle, so the two lists are walked without joining them
+    bool workersRunning() const {
+        for (const QList<Jt9Worker*> *list : { &workers, &hint_workers }) {
+            for (Jt9Worker *w : *list) {
+                if (w->process()->state() != QProcess::Running) return false;
+            }
+        }
+        return true;
+    }
+
+    void watchWorker(Jt9Worker *w) {
+        w->watchOutput();
+        connect(w, &Jt9Worker::decodeLine, this, [this, w](const QString &line) {
+            onWorkerLine(w, line);
+        });
+        connect(w, &Jt9Worker::decodeFinished, this, [this, w](int nsynced, int ndecoded) {
+            onWorkerFinished(w, nsynced, ndecoded);
+        });
+
+        // Connect jt9 error/finished signals for health monitoring
+        connect(w->process(), QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+                this, &StreamDecoder::jt9Finished);
+        connect(w->process(), &QProcess::errorOccurred, this, &StreamDecoder::jt9Error);
+    }
+
+    // Gives up on the job a stuck worker is running
+    void recoverWorker(Jt9Worker *w) {
+        watchdog_fires++;
+        qStdErr << "Warning: Decode watchdog fired (total: " << watchdog_fires
+                << ") - jt9 did not finish in time, dropping its job\n";
+        qStdErr.flush();
+
+        // jt9 cannot abandon a pass, so the worker stays busy with no job until
+        // its late <DecodeFinished> arrives; only then is it acknowledged and reused
+        CycleJobPtr job = running.value(w);
+        running[w] = CycleJobPtr();
+        if (job->batch) {
+            batch->fail(job->batch_path);
+        } else if (job->hint) {
+            hintJobDone(job);
+        } else {
+            cycles[job->cycle_num].main_done = true;
+            cycles[job->cycle_num].dropped = true;
+        }
+    }
+
+    // Batch files only take decode workers that live work does not need: no
+    // live job may be waiting, and either another worker stays free for the
+    // next boundary or the predicted pass ends comfortably before it. jt9
+    // cannot abandon a pass, so admission is the only lever; a file that does
+    // not fit waits for the next gap.
+    void dispatchBatch() {
+        if (!batch || draining) return;
+        for (const CycleJobPtr &queued : dispatch_queue.raw()) {
+            if (!queued->hint) return;
+        }
+        while (true) {
+            QList<Jt9Worker*> idle;
+            for (Jt9Worker *w : workers) {
+                if (!running.contains(w)) idle.append(w);
+            }
+            if (idle.isEmpty()) return;
+
+            if (!batch_next) {
+                QString path = batch->take();
+                if (path.isEmpty()) return;
+                CycleJobPtr job = newJob(0, 0, false);
+                job->batch = true;
+                job->batch_path = path;
+                job->samples = std::make_shared<std::vector<short> >();
+                if (!batch->load(path, BUFFER_SIZE, *job->samples, job->nutc)) continue;
+                batch_next = job;
+            }
+
+            double audio_s = (double)batch_next->samples->size() / RX_SAMPLE_RATE;
+            double predicted_ms = batch_ms_per_audio_s > 0.0 ? batch_ms_per_audio_s * audio_s
+                                : published_cycles > 0 ? cost.recentMs(DecodeCostModel::KIND_MAIN) * audio_s * 1000.0 / mode.cycle_ms
+                                : -1.0;
+            bool spare_left = idle.size() > 1;
+            if (!spare_left && (predicted_ms < 0.0 || predicted_ms + 500 > msToNextCycle())) {
+                if (!batch_next->deferred) {
+                    batch_next->deferred = true;
+                    batch->countDeferral();
+                }
+                return;
+            }
+
+            CycleJobPtr job = batch_next;
+            batch_next.reset();
+            startJob(job, idle.first());
+        }
+    }
+
+    void startJob(const CycleJobPtr &job, Jt9Worker *w) {
+        dec_data_t *d = w->data();
+        int nsamples = (int)job->samples->size();
+        memcpy(d->d2, job->samples->data(), nsamples * sizeof(short));
+
+        // Lock shared memory to set params and trigger decode atomically
+        w->memory()->lock();
+        prepareParams(job, d->params);
+        w->memory()->unlock();
+
+        job->worker = w;
+        job->cpu_start = job->hint ? w->cpuSeconds() : 0.0;
+        job->endStage(STAGE_DISPATCH);
+        job->beginStage();
+        running[w] = job;
+        w->trigger(mode.ihsym);
+
+        // RETURN IMMEDIATELY - don't wait! (matching WSJT-X line 5651)
+        // jt9 will signal us via readyReadStandardOutput when done
+    }
+
+    // Decode parameters for one job, starting from those set up in main()
+    void prepareParams(const CycleJobPtr &job, decltype(dec_data_t::params) &params) {
+        params = main_params;
+        params.nutc = job->nutc;
+        params.kin = (int)job->samples->size();
+        params.newdat = true;
+        params.b_even_seq = job->even_seq;
+        if (job->monitor) {
+            // Own TX slot: shallow pass, no AP, flagged as transmitting
+            params.ltxing = true;
+            params.ndepth = 1;
+            params.lft8apon = false;
+        }
+        if (job->hint) {
+            applyHint(params, job->candidate);
+        }
+    }
+
+    // Stage 4: a decode line arrived from a worker
+    void onWorkerLine(Jt9Worker *w, const QString &line) {
+        AllocScope scope(ALLOC_LINE);
+        CycleJobPtr job = running.value(w);
+        if (job && job->batch) {
+            job->batch_lines.append(line);
+            return;
+        }
+        if (!job || !cycles.contains(job->cycle_num)) return;
+        CycleState &cs = cycles[job->cycle_num];
+        if (job->hint) {
+            cs.hint_lines.append(line);
+        } else {
+            cs.main_lines.append(line);
+            // Stream the main decode's lines as they arrive when this cycle is next to publish
+            if (job->cycle_num == cycles.firstKey()) {
+                publishMainLines(cs);
+            }
+        }
+    }
+
+    void onWorkerFinished(Jt9Worker *w, int nsynced, int ndecoded) {
+        AllocScope scope(ALLOC_CYCLE);
+        CycleJobPtr job = running.take(w);
+
+        // Acknowledge decode (matching WSJT-X: to_jt9(m_ihsym, -1, 1) at line 5756)
+        w->acknowledge();
+        if (!job) {
+            // Late finish of a pass the watchdog dropped: the worker is free again
+            dispatchJobs();
+            checkDrained();
+            return;
+        }
+
+        job->nsynced = nsynced;
+        job->ndecoded = ndecoded;
+        job->endStage(STAGE_COLLECT);
+
+        if (job->batch) {
+            double seconds = job->stage_ns[STAGE_COLLECT] / 1e9;
+            double audio_s = (double)job->samples->size() / RX_SAMPLE_RATE;
+            batch_ms_per_audio_s = batch_ms_per_audio_s <= 0.0 ? seconds * 1000.0 / audio_s
+                                                              : 0.7 * batch_ms_per_audio_s + 0.3 * seconds * 1000.0 / audio_s;
+            batch->finish(job->batch_path, job->batch_lines, seconds);
+            qStdErr << "Batch: " << QFileInfo(job->batch_path).fileName() << " decoded, "
+                    << job->batch_lines.size() << " messages in " << QString::number(seconds, 'f', 2) << " s\n";
+            qStdErr.flush();
+        } else if (job->hint) {
+            double cpu = qMax(0.0, w->cpuSeconds() - job->cpu_start);
+            hints->recordPass(cpu);
+            cost.observe(DecodeCostModel::KIND_HINT, job->features, job->prev_nsynced, job->predicted_ms,
+                         job->stage_ns[STAGE_COLLECT] / 1e6);
+            if (cycles.contains(job->cycle_num)) {
+                CycleState &cs = cycles[job->cycle_num];
+                cs.hint_passes++;
+                cs.hint_cpu_s += cpu;
+            }
+            hintJobDone(job);
+        } else if (cycles.contains(job->cycle_num)) {
+            cycles[job->cycle_num].main_done = true;
+            cost.observe(costKind(job), job->features, job->prev_nsynced, job->predicted_ms,
+                         job->stage_ns[STAGE_COLLECT] / 1e6);
+            if (!job->monitor) last_nsynced = nsynced;
+            // Finished after the next boundary: the live deadline was missed
+            if (getUtcMs() > job->deadline_ms) live_late++;
+        }
+
+        advancePublish();
+        dispatchJobs();
+        checkDrained();
+    }
+
+    // After a handover: quit once every triggered cycle has been published
+    void checkDrained() {
+        if (!draining || !cycles.isEmpty()) return;
+        // Passes the watchdog dropped do not hold up the exit
+        for (FlatMap<Jt9Worker*, CycleJobPtr>::const_iterator it = running.constBegin(); it != running.constEnd(); ++it) {
+            if (it.value()) return;
+        }
+        qStdErr << (input_ended ? "All cycles published, exiting\n" : "Handover complete, exiting\n");
+        qStdErr.flush();
+        QCoreApplication::quit();
+    }
+    
+    void hintJobDone(const CycleJobPtr &job) {
+        if (cycles.contains(job->cycle_num)) {
+            cycles[job->cycle_num].hints_outstanding--;
+        }
+    }
+
+    // Stages 5 and 6 for main-decode lines: parse, remember, output
+    void publishMainLines(CycleState &cs) {
+        if (cs.main_lines.isEmpty()) return;
+        CycleJob *job = cs.main.get();
+        for (const QString &line : cs.main_lines) {
+            AllocScope scope(ALLOC_LINE);
+            qint64 t0 = monotonic_ns();
+            DecodeRecord rec;
+            bool parsed = parse_decode_line(line, rec);
+            QString tagged = tagDial(job, line);
+            if (parsed) {
+                cs.messages.insert(rec.message);
+                cs.yield.add(rec);
+                if (mqtt) cs.records.append(rec);
+                if (hints) hints->observe(job->cycle_num, rec);
+                if (watch) watch->check(rec, tagged);
+            }
+            qint64 t1 = monotonic_ns();
+            qStdOut << tagged << "\n";
+            qStdOut.flush();
+            job->stage_ns[STAGE_POSTPROCESS] += t1 - t0;
+            job->stage_ns[STAGE_PUBLISH] += monotonic_ns() - t1;
+        }
+        cs.main_lines.clear();
+    }
+
+    // Publish completed cycles in order; a cycle whose main decode is done
+    // waits for its hint passes unless a later cycle's main decode has started
+    void advancePublish() {
+        while (!cycles.isEmpty()) {
+            int cycle_num = cycles.firstKey();
+            CycleState &cs = cycles.first();
+            if (!cs.main_done) return;
+
+            publishMainLines(cs);
+            bool later_started = false;
+            for (FlatMap<int, CycleState>::iterator it = cycles.begin(); it != cycles.end(); ++it) {
+                const CycleState &later = it.value();
+                if (it.key() > cycle_num && (later.main_done || (later.main && later.main->worker))) {
+                    later_started = true;
+                }
+            }
+            if (cs.hints_outstanding > 0 && !later_started && !cs.dropped) return;
+
+            if (!cs.dropped && cs.main) {
+                publishHintLines(cs);
+                publishStats(cs);
+                if (mqtt) publishMqtt(cs);
+            }
+            cycles.remove(cycle_num);
+
+            // The next cycle may have collected lines while waiting its turn
+            if (!cycles.isEmpty()) publishMainLines(cycles.first());
+        }
+    }
+    
+    // One MQTT message per cycle carrying all of its decodes
+    void publishMqtt(const CycleState &cs) {
+        AllocScope scope(ALLOC_LINE);
+        const CycleJob *job = cs.main.get();
+        QString band = hopper && job->dial_hz > 0 ? band_name(job->dial_hz) : mqtt_band;
+        QByteArray payload = "{\"cycle\":";
+        payload += QByteArray::number(job->cycle_num);
+        payload += ",\"mode\":";
+        json_string(payload, mode.name);
+        payload += ",\"band\":";
+        json_string(payload, band);
+        if (job->dial_hz > 0) {
+            payload += ",\"dial_hz\":";
+            payload += QByteArray::number(job->dial_hz);
+        }
+        payload += ",\"nsynced\":";
+        payload += QByteArray::number(job->nsynced);
+        payload += ",\"decodes\":[";
+        for (int i = 0; i < cs.records.size(); i++) {
+            const DecodeRecord &rec = cs.records[i];
+            payload += i ? ",{\"utc\":" : "{\"utc\":";
+            json_string(payload, QString("%1").arg(rec.utc, 6, 10, QChar('0')));
+            payload += ",\"snr\":";
+            payload += QByteArray::number(rec.snr);
+            payload += ",\"dt\":";
+            payload += QByteArray::number(rec.dt, 'f', 1);
+            payload += ",\"freq\":";
+            payload += QByteArray::number(rec.freq);
+            payload += ",\"msg\":";
+            json_string(payload, rec.message);
+            if (!rec.flags.isEmpty()) {
+                payload += ",\"flags\":";
+                json_string(payload, rec.flags);
+            }
+            payload += '}';
+        }
+        payload += "]}";
+        mqtt->publish((mqtt_topic + "/" + band).toUtf8(), payload);
+    }
+
+    // Output hint-pass decodes that the main pass (or another hint) did not already have
+    void publishHintLines(CycleState &cs) {
+        for (const QString &line : cs.hint_lines) {
+            AllocScope scope(ALLOC_LINE);
+            DecodeRecord rec;
+            if (!parse_decode_line(line, rec) || cs.messages.contains(rec.message)) continue;
+            cs.messages.insert(rec.message);
+            hints->observe(cs.main->cycle_num, rec);
+            hints->recordExtraDecode();
+            cs.hint_extra++;
+            cs.yield.add(rec);
+            if (mqtt) cs.records.append(rec);
+            QString tagged = tagDial(cs.main.get(), line);
+            if (watch) watch->check(rec, tagged);
+            qStdOut << tagged << "\n";
+            qStdOut.flush();
+        }
+        cs.hint_lines.clear();
+    }
+
+    void publishStats(CycleState &cs) {
+        CycleJob *job = cs.main.get();
+        qint64 t0 = monotonic_ns();
+        double decode_duration_s = job->stage_ns[STAGE_COLLECT] / 1e9;
+
+        // Output machine-readable statistics to stdout; built without
+        // allocating since it runs every cycle
+        LineBuffer out;
+        out << "<DecodeStats>"
+                << " cycle_num=" << job->cycle_num
+                << " duration_s=" << Fixed(decode_duration_s, 3)
+                << " num_decodes=" << job->ndecoded
+                << " skipped_cycles=" << skipped_cycles;
+        job->stage_ns[STAGE_PUBLISH] += monotonic_ns() - t0;
+        for (int s = 0; s < STAGE_COUNT; s++) {
+            out << " " << STAGE_NAMES[s] << "_ms=" << Fixed(job->stage_ns[s] / 1e6, 3);
+            stage_total_ns[s] += job->stage_ns[s];
+        }
+        out << " rms=" << Fixed(job->rms, 1)
+                << " dc=" << Fixed(job->dc_offset, 0)
+                << " clipped=" << job->clipped
+                << " reader_lag_ms=" << job->reader_lag_ms
+                << " reader_head_ms=" << job->reader_head_ms
+                << " depth=" << (job->monitor ? 1 : main_params.ndepth)
+                << " band_db=" << Fixed(job->features.band_db, 1)
+                << " candidates=" << job->features.candidates;
+        if (job->remote_node.isEmpty() && job->predicted_ms > 0.0) {
+            out << " predicted_ms=" << Fixed(job->predicted_ms, 1)
+                    << " predict_err_ms=" << Fixed(job->stage_ns[STAGE_COLLECT] / 1e6 - job->predicted_ms, 1);
+        }
+        CaptureHealth capture;
+        if (source->captureHealth(capture)) {
+            out << " capture_restarts=" << capture.restarts
+                    << " gap_skipped=" << gap_skipped
+                    << " gap_ms=" << capture.gap_ms
+                    << " last_gap_ms=" << capture.last_gap_ms;
+        }
+        cs.yield.finish(job->nsynced, job->ndecoded);
+        cs.yield.write(out, main_params.nfa, main_params.nfb);
+        yield_total.merge(cs.yield);
+        yield_collect_ns += job->stage_ns[STAGE_COLLECT];
+        if (schedule) {
+            out << " seq=" << (job->even_seq ? "even" : "odd")
+                    << " tx=" << (job->monitor ? 1 : 0)
+                    << " tx_skipped=" << schedule->txSkipped()
+                    << " seq_skipped=" << schedule->seqSkipped();
+        }
+        if (hopper) {
+            out << " dial_hz=" << job->dial_hz
+                    << " retune_failures=" << retune_failures;
+            if (job->dial_hz > 0 && !job->monitor) {
+                hopper->observe(job->dial_hz, job->ndecoded + cs.hint_extra);
+            }
+        }
+        if (watch) {
+            out << " alerts=" << watch->alertCount();
+        }
+        if (cluster) {
+            out << " node=" << (job->remote_node.isEmpty() ? "local" : job->remote_node.toLatin1().constData())
+                    << " remote_jobs=" << cluster->remoteJobs()
+                    << " fallbacks=" << cluster->fallbackCount();
+        }
+        if (stagger && !job->monitor) {
+            out << " admit_delay_ms=" << job->admit_delay_ms
+                << " admit_rank=" << job->admit_rank
+                << " admit_peers=" << job->admit_peers
+                << " admit_avg_ms=" << Fixed(stagger->averageDelayMs(), 1);
+        }
+        if (AllocScope::enabled) {
+            qint64 cycle_allocs = AllocScope::count(ALLOC_CYCLE) - last_allocs[ALLOC_CYCLE];
+            qint64 line_allocs = AllocScope::count(ALLOC_LINE) - last_allocs[ALLOC_LINE];
+            last_allocs[ALLOC_CYCLE] += cycle_allocs;
+            last_allocs[ALLOC_LINE] += line_allocs;
+            out << " allocs=" << cycle_allocs << " line_allocs=" << line_allocs;
+            if (alloc_check_after > 0 && published_cycles >= alloc_check_after && cycle_allocs > 0) {
+                qStdErr << "Error: cycle " << job->cycle_num << " allocated " << cycle_allocs
+                        << " times after warm-up\n";
+                qStdErr.flush();
+                QCoreApplication::exit(3);
+            }
+        }
+        out << " </DecodeStats>\n";
+        qStdOut.flush();
+        out.writeTo(stdout);
+
+        if (cs.hint_passes > 0) {
+            double total_cpu = hints->totalCpuSeconds();
+            qStdOut << "<HintStats>"
+                    << " cycle_num=" << job->cycle_num
+                    << " passes=" << cs.hint_passes
+                    << " extra_decodes=" << cs.hint_extra
+                    << " cpu_s=" << QString::number(cs.hint_cpu_s, 'f', 3)
+                    << " total_passes=" << hints->totalPasses()
+                    << " total_extra_decodes=" << hints->totalExtraDecodes()
+                    << " total_cpu_s=" << QString::number(total_cpu, 'f', 3)
+                    << " yield_per_cpu_s=" << QString::number(total_cpu > 0.0 ? hints->totalExtraDecodes() / total_cpu : 0.0, 'f', 3)
+                    << " </HintStats>\n";
+        }
+        if (batch) {
+            // Live deadlines and batch progress are reported side by side, never mixed
+            qStdOut << "<BatchStats>"
+                    << " cycle_num=" << job->cycle_num
+                    << " live_skipped=" << skipped_cycles
+                    << " live_late=" << live_late
+                    << " queued=" << batch->queued() + (batch_next ? 1 : 0)
+                    << " done=" << batch->done()
+                    << " failed=" << batch->failed()
+                    << " deferrals=" << batch->deferralCount()
+                    << " decodes=" << batch->decodeCount()
+                    << " audio_s=" << QString::number(batch->audioSeconds(), 'f', 1)
+                    << " decode_s=" << QString::number(batch->decodeSeconds(), 'f', 1)
+                    << " throughput_x=" << QString::number(batch->throughput(), 'f', 2)
+                    << " </BatchStats>\n";
+        }
+        qStdOut.flush();
+        published_cycles++;
+    }
+    
+    // Jobs still queued past their deadline are dropped; a dropped main job skips its cycle
+    void dropStaleJobs() {
+        qint64 now_ms = getUtcMs();
+        QVector<CycleJobPtr> &q = dispatch_queue.raw();
+        for (int i = 0; i < q.size();) {
+            CycleJobPtr job = q[i];
+            if (job->deadline_ms > now_ms) {
+                i++;
+                continue;
+            }
+            q.removeAt(i);
+            if (job->hint) {
+                hintJobDone(job);
+            } else {
+                skipCycle(job->cycle_num);
+            }
+        }
+        advancePublish();
+    }
+
+    void skipCycle(int cycle_num) {
+        skipped_cycles++;
+        qStdErr << "Warning: No decode worker became free in time, skipping cycle #" << cycle_num
+                << " (total skipped: " << skipped_cycles << ")\n";
+        qStdErr.flush();
+        if (cycles.contains(cycle_num)) {
+            cycles[cycle_num].main_done = true;
+            cycles[cycle_num].dropped = true;
+        }
+    }
+
+    void applyHint(decltype(dec_data_t::params) &params, const HintCandidate &c) {
+        memset(params.mycall, 0, sizeof(params.mycall));
+        memset(params.hiscall, 0, sizeof(params.hiscall));
+        memset(params.hisgrid, 0, sizeof(params.hisgrid));
+        strncpy(params.mycall, c.mycall.toLatin1().constData(), sizeof(params.mycall) - 1);
+        strncpy(params.hiscall, c.hiscall.toLatin1().constData(), sizeof(params.hiscall) - 1);
+        strncpy(params.hisgrid, c.hisgrid.toLatin1().constData(), sizeof(params.hisgrid) - 1);
+        params.nQSOProgress = c.nqso_progress;
+        params.lft8apon = true;
+        params.napwid = 50;
+        params.ndepth = 3;
+
+        // AP only helps near the expected reply, so decode a narrow slice around it
+        params.nfqso = c.freq;
+        params.nftx = c.freq;
+        params.nfa = qMax(main_params.nfa, c.freq - 250);
+        params.nfb = qMin(main_params.nfb, c.freq + 250);
+    }
+
+    // Band hopping: decode lines carry the absolute dial frequency of their cycle
+    QString tagDial(const CycleJob *job, const QString &line) const {
+        if (!hopper || job->dial_hz <= 0) return line;
+        return line + "  dial_hz=" + QString::number(job->dial_hz);
+    }
+
+    // Choose the band for the cycle starting at boundary and tune it off the event loop
+    void sendRetune(qint64 boundary) {
+        qint64 dial = hopper->next();
+        if (dial == current_dial_hz) {
+            cycle_dial.insert(boundary, dial);
+            return;
+        }
+        retune_boundaries.insert(boundary);
+        RigctldClient *client = rig;
+        stage_pool.start(new FunctionTask([this, client, boundary, dial]() {
+            qint64 actual = dial;
+            QString error;
+            bool ok = client->setFrequency(dial, actual, error);
+            QMetaObject::invokeMethod(this, [this, boundary, dial, actual, ok, error]() {
+                onRetuned(boundary, dial, actual, ok, error);
+            }, Qt::QueuedConnection);
+        }));
+    }
+
+    void onRetuned(qint64 boundary, qint64 dial, qint64 actual, bool ok, const QString &error) {
+        if (!ok) {
+            // The rig stays where it was; cycles keep the previous dial
+            retune_failures++;
+            qStdErr << "Warning: Retune to " << dial << " Hz failed: " << error
+                    << " (total failures: " << retune_failures << ")\n";
+            qStdErr.flush();
+            return;
+        }
+        cycle_dial.insert(boundary, actual);
+        current_dial_hz = actual;
+    }
+
+    // Wall-clock time (the rig acts on live audio) of the retune before the boundary after 'after'
+    void scheduleRetune(qint64 after) {
+        qint64 wall_ms = getUtcMs() + source_latency_ms;
+        qint64 next = after + mode.cycle_ms;
+        while (next - RETUNE_LEAD_MS <= wall_ms) next += mode.cycle_ms;
+        retune_timer->start((int)(next - RETUNE_LEAD_MS - wall_ms));
+    }
+
+    // Dial in effect for the cycle starting at cycle_start_ms (0 if unknown)
+    qint64 dialFor(qint64 cycle_start_ms) const {
+        QMap<qint64, qint64>::const_iterator it = cycle_dial.upperBound(cycle_start_ms);
+        if (it == cycle_dial.constBegin()) return 0;
+        --it;
+        return it.value();
+    }
+
+    void pruneRetunes(qint64 cycle_start_ms) {
+        qint64 dial = dialFor(cycle_start_ms);
+        while (!cycle_dial.isEmpty() && cycle_dial.firstKey() < cycle_start_ms) {
+            cycle_dial.remove(cycle_dial.firstKey());
+        }
+        if (dial > 0) cycle_dial.insert(cycle_start_ms, dial);
+        for (qint64 boundary : retune_boundaries.values()) {
+            if (boundary < cycle_start_ms) retune_boundaries.remove(boundary);
+        }
+    }
+
+    // UTC capture time of the newest samples: wall clock minus the source's fixed latency
+    qint64 getUtcMs() {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000LL - source_latency_ms;
+    }
+
+    qint64 msToNextCycle() {
+        qint64 now_ms = getUtcMs();
+        qint64 ms_in_cycle = now_ms % mode.cycle_ms;
+        return mode.cycle_ms - ms_in_cycle;
+    }
+
+    QList<Jt9Worker*> workers;
+    QList<Jt9Worker*> hint_workers;
+    decltype(dec_data_t::params) main_params;
+    ModeConfig mode;
+    HintEngine *hints;
+    TxSchedule *schedule;
+    bool remove_dc;                   // condition stage subtracts the DC offset it measures
+    int source_latency_ms;
+    
+    SampleSource *source;
+    SpectrumMonitor *spectrum;
+    DspPool *dsp;
+    SharedRing ring;
+    short *circ_buffer;
+    int BUFFER_SIZE;
+    int SAMPLES_PER_CYCLE;
+    QMutex buffer_mutex;
+    AudioReaderThread *reader_thread;
+    
+    QThreadPool stage_pool;
+    BoundedQueue<CycleJobPtr> dispatch_queue;
+    FlatMap<Jt9Worker*, CycleJobPtr> running;
+    FlatMap<int, CycleState> cycles;
+    CycleStager *stager;
+    std::vector<CycleJobPtr> job_pool;
+    std::vector<std::shared_ptr<std::vector<short> > > sample_pool;
+    qint64 last_allocs[ALLOC_BUCKETS];    // counts at the previous stats line
+    int alloc_check_after;
+
+    QTimer *cycle_timer;
+    QTimer *decode_watchdog;
+    QTimer *schedule_timer;
+
+    // Handover to a newer instance
+    int handover_fd;
+    QString handover_path;
+    QSocketNotifier *handover_notifier;
+    bool draining;
+    bool input_ended;                 // draining because the source reached end of stream
+    bool resumed;
+    qint64 last_boundary_ms;
+
+    // Batch backfill
+    BatchSpool *batch;
+    CycleJobPtr batch_next;           // loaded, waiting for a gap
+    double batch_ms_per_audio_s;      // running average decode cost of batch audio
+    FeatureProbe probe;               // cost model inputs, measured on the ingest lane
+    CycleFeatures last_features;      // of the latest conditioned cycle
+    int last_nsynced;                 // sync count of the latest main pass
+    int live_late;                    // live decodes that finished after the next boundary
+    DecodeYield yield_total;          // published cycles since the last <YieldStats>
+    qint64 yield_collect_ns;
+    int yield_late_mark;              // live_late at the last <YieldStats>
+
+    // Band hopping
+    static const int RETUNE_LEAD_MS = 100;  // retune this long before the boundary
+    BandHopper *hopper;
+    RigctldClient *rig;
+    QTimer *retune_timer;
+    int settle_ms;                    // muted at the start of a cycle after a retune
+    qint64 current_dial_hz;
+    QMap<qint64, qint64> cycle_dial;  // cycle start (UTC ms) -> dial from then on
+    QSet<qint64> retune_boundaries;   // boundaries with a retune sent
+    int retune_failures;
+
+    ClusterClient *cluster;           // cluster mode: decode nodes for main jobs
+    WatchlistMonitor *watch;          // alert matcher on the output path
+    MqttPublisher *mqtt;              // per-cycle decode batches
+    QString mqtt_topic;
+    QString mqtt_band;
+    StaggerBoard *stagger;            // host-wide decode start planning
+    int total_decodes;
+    int skipped_cycles;
+    int gap_skipped;                  // cycles overlapping a capture audio gap
+    int watchdog_fires;
+    int published_cycles;
+    DecodeCostModel cost;             // predicted pass durations, updated from each finished pass
+    qint64 stage_total_ns[STAGE_COUNT];
+};
+
+// Sequential byte source for archive input. Subclasses fill(); read() serves
+// pushed-back bytes first, so a parser can return what a decompressor read
+// past the end of a member.
+class ByteStream {
+public:
+    virtual ~ByteStream() {}
+
+    // Returns bytes read, 0 at end of stream, -1 on error (see error)
+    qint64 read(char *dst, qint64 n) {
+        if (!pushback.isEmpty()) {
+            qint64 k = qMin(n, (qint64)pushback.size());
+            memcpy(dst, pushback.constData(), k);
+            pushback.remove(0, (int)k);
+            return k;
+        }
+        return fill(dst, n);
+    }
+
+    bool readFully(char *dst, qint64 n) {
+        while (n > 0) {
+            qint64 k = read(dst, n);
+            if (k <= 0) return false;
+            dst += k;
+            n -= k;
+        }
+        return true;
+    }
+
+    bool skip(qint64 n) {
+        char buf[65536];
+        while (n > 0) {
+            qint64 k = read(buf, qMin(n, (qint64)sizeof(buf)));
+            if (k <= 0) return false;
+            n -= k;
+        }
+        return true;
+    }
+
+    void unread(const char *data, int n) { pushback.prepend(QByteArray(data, n)); }
+
+    QString error;
+
+protected:
+    virtual qint64 fill(char *dst, qint64 n) = 0;
+
+private:
+    QByteArray pushback;
+};
+
+class FileStream : public ByteStream {
+public:
+    explicit FileStream(const QString &path) : file(path) {
+        if (!file.open(QIODevice::ReadOnly)) error = file.errorString();
+    }
+
+protected:
+    qint64 fill(char *dst, qint64 n) override { return file.read(dst, n); }
+
+private:
+    QFile file;
+};
+
+// gzip (including concatenated members, as written by pigz) inflated with zlib
+class GzipStream : public ByteStream {
+public:
+    explicit GzipStream(const QString &path) : file(path), in(65536, 0), finished(false), mid_member(false) {
+        memset(&z, 0, sizeof(z));
+        if (!file.open(QIODevice::ReadOnly)) {
+            error = file.errorString();
+            finished = true;
+        } else if (inflateInit2(&z, 16 + MAX_WBITS) != Z_OK) {
+            error = "zlib initialisation failed";
+            finished = true;
+        }
+    }
+
+    ~GzipStream() { inflateEnd(&z); }
+
+protected:
+    qint64 fill(char *dst, qint64 n) override {
+        uInt want = (uInt)qMin(n, (qint64)(1 << 30));
+        z.next_out = reinterpret_cast<Bytef*>(dst);
+        z.avail_out = want;
+        while (!finished && z.avail_out == want) {
+            if (z.avail_in == 0) {
+                qint64 k = file.read(in.data(), in.size());
+                if (k <= 0) {
+                    if (k < 0) error = file.errorString();
+                    else if (mid_member) error = "truncated gzip member";
+                    finished = true;
+                    break;
+                }
+                z.next_in = reinterpret_cast<Bytef*>(in.data());
+                z.avail_in = (uInt)k;
+            }
+            int rc = inflate(&z, Z_NO_FLUSH);
+            if (rc == Z_STREAM_END) {
+                inflateReset(&z);
+                mid_member = false;
+            } else if (rc != Z_OK && rc != Z_BUF_ERROR) {
+                error = QString("gzip data error (%1)").arg(z.msg ? z.msg : "corrupt");
+                return -1;
+            } else {
+                mid_member = true;
+            }
+        }
+        // Bytes inflated before a truncation are still served; the error follows on the next read
+        qint64 produced = (qint64)(reinterpret_cast<char*>(z.next_out) - dst);
+        if (produced == 0 && !error.isEmpty()) return -1;
+        return produced;
+    }
+
+private:
+    QFile file;
+    QByteArray in;
+    z_stream z;
+    bool finished;
+    bool mid_member;            // input ended inside a member: truncated, not end of stream
+};
+
+// Output of an external decompressor (zstd -dc), read as it is produced
+class CommandStream : public ByteStream {
+public:
+    CommandStream(const QString &program, const QStringList &args) {
+        proc.setReadChannel(QProcess::StandardOutput);
+        proc.start(program, args, QIODevice::ReadOnly);
+        if (!proc.waitForStarted()) error = QString("cannot run %1").arg(program);
+    }
+
+    ~CommandStream() {
+        proc.kill();
+        proc.waitForFinished();
+    }
+
+protected:
+    qint64 fill(char *dst, qint64 n) override {
+        while (proc.bytesAvailable() == 0) {
+            if (proc.state() == QProcess::NotRunning || !proc.waitForReadyRead(-1)) {
+                if (proc.bytesAvailable() > 0) break;
+                if (proc.exitStatus() != QProcess::NormalExit || proc.exitCode() != 0) {
+                    error = QString("%1 failed: %2").arg(proc.program(),
+                                                         QString::fromLocal8Bit(proc.readAllStandardError()).trimmed());
+                    return -1;
+                }
+                return 0;
+            }
+        }
+        return proc.read(dst, n);
+    }
+
+private:
+    QProcess proc;
+};
+
+// An archive or single recording to read, and the name its output is tagged with
+struct ArchiveInput {
+    QString path;
+    QString name;
+};
+
+// One audio member of an archive decoded to 12 kHz samples, or the marker
+// that an input (or the whole run) has ended
+struct ArchiveItem {
+    enum Kind { MEMBER, INPUT_END, STREAM_END };
+    Kind kind;
+    int seq;                    // input order, for in-order output
+    QString tag;                // archive:member
+    int nutc;
+    qint64 start_ms;            // UTC start of the recording (0 if unknown)
+    ArchiveInput input;         // INPUT_END: the input that was read
+    QString error;              // member unreadable, or (INPUT_END) the whole input
+    std::shared_ptr<std::vector<short> > samples;
+};
+
+typedef std::shared_ptr<ArchiveItem> ArchiveItemPtr;
+
+// Source of inputs for the reader thread; returns false when there are no more
+typedef std::function<bool(ArchiveInput&, const std::atomic<bool>&)> ArchiveInputFn;
+
+// Streams audio members out of tar (plain, .gz or .zst) and zip archives
+// without extracting them; a plain recording is read as a one-member input.
+// Runs ahead of the jt9 pool by at most the number of slots; a member is
+// released to the decoder as soon as it is read, so reading and
+// decompression overlap decoding. Each input is followed by an INPUT_END.
+class ArchiveReader : public QThread {
+public:
+    static const qint64 MAX_MEMBER_BYTES = 64LL * 1024 * 1024;
+
+    ArchiveReader(ArchiveInputFn next_input, int max_samples, int slot_count,
+                  std::function<void(const ArchiveItemPtr&)> deliver)
+        : next_input(next_input), max_samples(max_samples), free_slots(slot_count), deliver(deliver),
+          next_seq(0), archives_failed(0), aborting(false) {}
+
+    // Called by the decoder when a member has been handed to a worker
+    void releaseSlot() { free_slots.release(); }
+
+    // Stop after the current member (the decoder is going away)
+    void abort() {
+        aborting = true;
+        free_slots.release(1 << 20);
+    }
+
+    int archivesFailed() const { return archives_failed; }
+
+    void run() override {
+        ArchiveInput input;
+        while (!aborting && next_input(input, aborting)) {
+            QString error;
+            bool ok = readArchive(input, error);
+            if (aborting) return;   // partly read: no INPUT_END, so nothing is committed
+            if (!ok) {
+                archives_failed++;
+                log_from_thread(QString("Error: %1: %2\n").arg(input.name, error));
+            }
+            ArchiveItemPtr end = newItem(ArchiveItem::INPUT_END);
+            end->seq = next_seq++;
+            end->input = input;
+            end->error = ok ? QString() : error;
+            deliver(end);
+        }
+        deliver(newItem(ArchiveItem::STREAM_END));
+    }
+
+private:
+    static ArchiveItemPtr newItem(ArchiveItem::Kind kind) {
+        ArchiveItemPtr item = std::make_shared<ArchiveItem>();
+        item->kind = kind;
+        item->seq = -1;
+        item->nutc = 0;
+        item->start_ms = 0;
+        return item;
+    }
+
+    bool readArchive(const ArchiveInput &input, QString &error) {
+        const QString &path = input.path;
+        QFile probe(path);
+        if (!probe.open(QIODevice::ReadOnly)) {
+            error = probe.errorString();
+            return false;
+        }
+        QByteArray magic = probe.read(512);
+        probe.close();
+
+        const QString &name = input.name;
+        std::unique_ptr<ByteStream> stream;
+        bool zip = false;
+        if (magic.startsWith("RIFF") || magic.startsWith("fLaC") || name.toLower().endsWith(".raw")) {
+            // A single recording rather than an archive
+            QFile f(path);
+            if (!f.open(QIODevice::ReadOnly)) {
+                error = f.errorString();
+                return false;
+            }
+            emitMember(QString(), name, f.read(MAX_MEMBER_BYTES), QFileInfo(path).lastModified());
+            return true;
+        } else if (magic.startsWith("\x1f\x8b")) {
+            stream.reset(new GzipStream(path));
+        } else if (magic.startsWith("\x28\xb5\x2f\xfd")) {
+            stream.reset(new CommandStream("zstd", QStringList() << "-dcq" << "--" << path));
+        } else if (magic.startsWith("PK\x03\x04")) {
+            stream.reset(new FileStream(path));
+            zip = true;
+        } else if (magic.size() >= 262 && magic.mid(257, 5) == "ustar") {
+            stream.reset(new FileStream(path));
+        } else {
+            error = "not a recording or a tar, tar.gz, tar.zst or zip archive";
+            return false;
+        }
+        if (!stream->error.isEmpty()) {
+            error = stream->error;
+            return false;
+        }
+        bool ok = zip ? readZip(*stream, name, error) : readTar(*stream, name, error);
+        if (!ok && error.isEmpty()) error = stream->error.isEmpty() ? "truncated archive" : stream->error;
+        return ok;
+    }
+
+    bool readTar(ByteStream &in, const QString &archive, QString &error) {
+        char h[512];
+        QString long_name;
+        while (in.readFully(h, 512)) {
+            bool zero = true;
+            for (int i = 0; i < 512 && zero; i++) zero = h[i] == 0;
+            if (zero) return true;   // end-of-archive block
+
+            qint64 size = tarNumber(h + 124, 12);
+            qint64 mtime = tarNumber(h + 136, 12);
+            char type = h[156];
+            qint64 padded = (size + 511) & ~511LL;
+            if (size < 0) {
+                error = "bad tar header";
+                return false;
+            }
+
+            if (type == 'L' || type == 'x') {
+                // GNU long name, or pax extended header (only path= is used);
+                // an oversized one is ignored and the member keeps its header name
+                if (size > 1024 * 1024) {
+                    long_name.clear();
+                    if (!in.skip(padded)) return false;
+                    continue;
+                }
+                QByteArray data(padded, 0);
+                if (!in.readFully(data.data(), padded)) return false;
+                data.truncate(size);
+                if (type == 'L') {
+                    long_name = QString::fromUtf8(data.constData());
+                } else {
+                    for (const QByteArray &rec : data.split('\n')) {
+                        int sp = rec.indexOf(' ');
+                        if (sp > 0 && rec.mid(sp + 1).startsWith("path=")) {
+                            long_name = QString::fromUtf8(rec.mid(sp + 6));
+                        }
+                    }
+                }
+                continue;
+            }
+
+            QString member = long_name;
+            long_name.clear();
+            if (member.isEmpty()) {
+                member = QString::fromUtf8(h, qstrnlen(h, 100));
+                if (memcmp(h + 257, "ustar", 5) == 0 && h[345]) {
+                    member = QString::fromUtf8(h + 345, qstrnlen(h + 345, 155)) + "/" + member;
+                }
+            }
+
+            bool regular = type == '0' || type == '\0' || type == '7';
+            if (!regular || !isAudio(member)) {
+                if (!in.skip(padded)) return false;
+                continue;
+            }
+            QByteArray data;
+            qint64 keep = qMin(size, MAX_MEMBER_BYTES);
+            data.resize((int)keep);
+            if (!in.readFully(data.data(), keep) || !in.skip(padded - keep)) return false;
+            if (!emitMember(archive, member, data, QDateTime::fromSecsSinceEpoch(mtime, Qt::UTC))) return true;
+        }
+        // Archives ending without the zero blocks are accepted if they end on a header boundary
+        return in.error.isEmpty();
+    }
+
+    // Walks local file headers in order, so no seeking to the central directory
+    bool readZip(ByteStream &in, const QString &archive, QString &error) {
+        uchar h[30];
+        while (in.readFully(reinterpret_cast<char*>(h), 4)) {
+            quint32 sig = le32(h);
+            if (sig == 0x02014b50 || sig == 0x06054b50) return true;   // central directory
+            if (sig != 0x04034b50 || !in.readFully(reinterpret_cast<char*>(h + 4), 26)) {
+                error = "bad zip local header";
+                return false;
+            }
+            int flags = le16(h + 6);
+            int method = le16(h + 8);
+            int dos_time = le16(h + 10);
+            int dos_date = le16(h + 12);
+            qint64 csize = le32(h + 18);
+            qint64 usize = le32(h + 22);
+            int name_len = le16(h + 26);
+            int extra_len = le16(h + 28);
+            QByteArray name_raw(name_len, 0), extra(extra_len, 0);
+            if (!in.readFully(name_raw.data(), name_len) || !in.readFully(extra.data(), extra_len)) return false;
+            QString member = QString::fromUtf8(name_raw);
+
+            // Zip64: real sizes in extra field 0x0001
+            bool zip64 = false;
+            for (int p = 0; p + 4 <= extra.size();) {
+                int id = le16(reinterpret_cast<const uchar*>(extra.constData()) + p);
+                int len = le16(reinterpret_cast<const uchar*>(extra.constData()) + p + 2);
+                if (id == 0x0001 && p + 4 + 16 <= extra.size()) {
+                    zip64 = true;
+                    const uchar *z = reinterpret_cast<const uchar*>(extra.constData()) + p + 4;
+                    if (usize == 0xffffffffLL) usize = (qint64)le32(z) | ((qint64)le32(z + 4) << 32);
+                    if (csize == 0xffffffffLL) csize = (qint64)le32(z + 8) | ((qint64)le32(z + 12) << 32);
+                }
+                p += 4 + len;
+            }
+
+            bool descriptor = (flags & 0x08) != 0;
+            if (method != 0 && method != 8) {
+                if (descriptor) {
+                    error = QString("%1: compression method %2 with unknown size").arg(member).arg(method);
+                    return false;
+                }
+                log_from_thread(QString("Warning: %1:%2 uses compression method %3, skipped\n").arg(archive, member).arg(method));
+                if (!in.skip(csize)) return false;
+                continue;
+            }
+            if (method == 0 && descriptor) {
+                error = QString("%1: stored member with unknown size").arg(member);
+                return false;
+            }
+
+            bool wanted = !member.endsWith('/') && isAudio(member);
+            QByteArray data;
+            if (method == 0) {
+                qint64 keep = wanted ? qMin(csize, MAX_MEMBER_BYTES) : 0;
+                data.resize((int)keep);
+                if (!in.readFully(data.data(), keep) || !in.skip(csize - keep)) return false;
+            } else if (!inflateMember(in, data, wanted, error)) {
+                if (error.isEmpty()) error = QString("%1: corrupt deflate data").arg(member);
+                return false;
+            }
+            if (descriptor) {
+                // Optional signature, CRC-32, then 32- or 64-bit sizes
+                uchar d[4];
+                if (!in.readFully(reinterpret_cast<char*>(d), 4)) return false;
+                if (le32(d) != 0x08074b50) in.unread(reinterpret_cast<const char*>(d), 4);
+                if (!in.skip(zip64 ? 20 : 12)) return false;
+            }
+            if (wanted) {
+                QDateTime mtime(QDate(1980 + (dos_date >> 9), (dos_date >> 5) & 15, dos_date & 31),
+                                QTime(dos_time >> 11, (dos_time >> 5) & 63, (dos_time & 31) * 2), Qt::UTC);
+                if (!emitMember(archive, member, data, mtime)) return true;
+            }
+        }
+        return in.error.isEmpty();
+    }
+
+    // Raw deflate until the end of the member; bytes read past it go back to the stream
+    bool inflateMember(ByteStream &in, QByteArray &out, bool keep, QString &error) {
+        z_stream z;
+        memset(&z, 0, sizeof(z));
+        if (inflateInit2(&z, -MAX_WBITS) != Z_OK) {
+            error = "zlib initialisation failed";
+            return false;
+        }
+        char ibuf[65536], obuf[65536];
+        int rc = Z_OK;
+        while (rc != Z_STREAM_END) {
+            if (z.avail_in == 0) {
+                qint64 k = in.read(ibuf, sizeof(ibuf));
+                if (k <= 0) break;
+                z.next_in = reinterpret_cast<Bytef*>(ibuf);
+                z.avail_in = (uInt)k;
+            }
+            z.next_out = reinterpret_cast<Bytef*>(obuf);
+            z.avail_out = sizeof(obuf);
+            rc = inflate(&z, Z_NO_FLUSH);
+            if (rc != Z_OK && rc != Z_STREAM_END && rc != Z_BUF_ERROR) break;
+            int produced = (int)(sizeof(obuf) - z.avail_out);
+            if (keep && out.size() < MAX_MEMBER_BYTES) {
+                out.append(obuf, (int)qMin((qint64)produced, MAX_MEMBER_BYTES - out.size()));
+            }
+        }
+        if (z.avail_in > 0) in.unread(reinterpret_cast<const char*>(z.next_in), (int)z.avail_in);
+        inflateEnd(&z);
+        return rc == Z_STREAM_END;
+    }
+
+    // Decode a member to samples and hand it over, waiting for a free slot first;
+    // false once aborted
+    bool emitMember(const QString &archive, const QString &member, const QByteArray &data, const QDateTime &mtime) {
+        free_slots.acquire();
+        if (aborting) return false;
+        ArchiveItemPtr item = newItem(ArchiveItem::MEMBER);
+        item->seq = next_seq++;
+        item->tag = archive.isEmpty() ? member : archive + ":" + member;
+        QDateTime start = utc_from_name(QFileInfo(member).fileName(), mtime);
+        item->nutc = start.isValid() ? start.time().hour() * 100 + start.time().minute() : 0;
+        item->start_ms = start.isValid() ? start.toMSecsSinceEpoch() : 0;
+        item->samples = std::make_shared<std::vector<short> >();
+
+        QByteArray wav = data;
+        QString lower = member.toLower();
+        if (lower.endsWith(".flac")) {
+            // No FLAC decoder is linked in; the reference flac tool turns it into WAV
+            QProcess flac;
+            flac.start("flac", QStringList() << "-dcs" << "-");
+            bool ok = flac.waitForStarted();
+            if (ok) {
+                flac.write(data);
+                flac.closeWriteChannel();
+                ok = flac.waitForFinished(60000) && flac.exitStatus() == QProcess::NormalExit && flac.exitCode() == 0;
+                wav = flac.readAllStandardOutput();
+            }
+            if (!ok || wav.isEmpty()) {
+                item->error = "cannot decode FLAC (is flac installed?)";
+            }
+        }
+        if (item->error.isEmpty()) {
+            std::vector<short> &samples = *item->samples;
+            int n = -1;
+            if (lower.endsWith(".raw")) {
+                n = qMin(max_samples, wav.size() / (int)sizeof(short));
+                samples.assign(reinterpret_cast<const short*>(wav.constData()),
+                               reinterpret_cast<const short*>(wav.constData()) + n);
+            } else {
+                samples.resize(qMin(max_samples, wav.size() / (int)sizeof(short)));
+                QBuffer buf(&wav);
+                buf.open(QIODevice::ReadOnly);
+                n = read_wav(buf, samples.data(), (int)samples.size(), false);
+                samples.resize(qMax(0, n));
+            }
+            if (n <= 0) item->error = "no audio";
+        }
+        deliver(item);
+        return true;
+    }
+
+    static bool isAudio(const QString &name) {
+        QString lower = name.toLower();
+        return lower.endsWith(".wav") || lower.endsWith(".flac") || lower.endsWith(".raw");
+    }
+
+    // Octal, or GNU base-256 for large values
+    static qint64 tarNumber(const char *p, int len) {
+        if ((uchar)p[0] & 0x80) {
+            qint64 v = (uchar)p[0] & 0x3f;
+            for (int i = 1; i < len; i++) v = (v << 8) | (uchar)p[i];
+            return v;
+        }
+        qint64 v = 0;
+        for (int i = 0; i < len && p[i]; i++) {
+            if (p[i] == ' ') continue;
+            if (p[i] < '0' || p[i] > '7') break;
+            v = v * 8 + (p[i] - '0');
+        }
+        return v;
+    }
+
+    static quint32 le32(const uchar *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((quint32)p[3] << 24); }
+    static int le16(const uchar *p) { return p[0] | (p[1] << 8); }
+
+    ArchiveInputFn next_input;
+    int max_samples;
+    QSemaphore free_slots;
+    std::function<void(const ArchiveItemPtr&)> deliver;
+    int next_seq;
+    std::atomic<int> archives_failed;
+    std::atomic<bool> aborting;
+};
+
+// Offline decoding of archive members on the jt9 worker pool. Members are
+// decoded as they arrive from the reader and published in archive order,
+// each line tagged with file=<archive>:<member>. With an input-done
+// callback the lines of each input are handed to it instead of stdout.
+class ArchiveDecoder : public QObject {
+    Q_OBJECT
+
+public:
+    // Lines are "<recording start ms> <tagged line>"
+    typedef std::function<void(const ArchiveItemPtr &end, const QStringList &lines)> InputDoneFn;
+
+    ArchiveDecoder(ArchiveInputFn next_input, const QList<Jt9Worker*> &workers, const ModeConfig &mode_cfg,
+                   QObject *parent = nullptr)
+        : QObject(parent), workers(workers), mode(mode_cfg), next_publish(0), reader_done(false),
+          members(0), failed(0), decodes(0), audio_s(0.0), decode_s(0.0), started_ns(0), watch(nullptr)
+    {
+        main_params = workers.first()->data()->params;
+        for (Jt9Worker *w : workers) {
+            w->watchOutput();
+            connect(w, &Jt9Worker::decodeLine, this, [this, w](const QString &line) {
+                if (running.contains(w)) running[w].lines.append(line);
+            });
+            connect(w, &Jt9Worker::decodeFinished, this, [this, w](int, int ndecoded) {
+                onWorkerFinished(w, ndecoded);
+            });
+            connect(w->process(), QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this,
+                    [](int exitCode, QProcess::ExitStatus) {
+                qStdErr << "Error: jt9 process exited unexpectedly (code: " << exitCode << ")\n";
+                qStdErr.flush();
+                QCoreApplication::exit(1);
+            });
+            last_kin[w] = 0;
+        }
+        reader = new ArchiveReader(next_input, NTMAX * RX_SAMPLE_RATE, workers.size() * 2,
+                                   [this](const ArchiveItemPtr &item) {
+            QMetaObject::invokeMethod(this, [this, item]() { enqueue(item); }, Qt::QueuedConnection);
+        });
+    }
+
+    ~ArchiveDecoder() {
+        reader->abort();
+        reader->wait();
+        delete reader;
+    }
+
+    void setInputDone(InputDoneFn fn) { input_done = fn; }
+    void setWatchlist(WatchlistMonitor *monitor) { watch = monitor; }
+
+    void start() {
+        started_ns = monotonic_ns();
+        reader->start();
+    }
+
+private:
+    struct Running {
+        ArchiveItemPtr item;
+        QStringList lines;
+        qint64 start_ns;
+    };
+
+    void enqueue(const ArchiveItemPtr &item) {
+        if (item->kind == ArchiveItem::STREAM_END) {
+            reader_done = true;
+        } else if (item->kind == ArchiveItem::INPUT_END) {
+            input_ends.insert(item->seq, item);
+            finished.insert(item->seq, QStringList());
+        } else if (!item->error.isEmpty()) {
+            reader->releaseSlot();
+            failed++;
+            qStdErr << "Warning: " << item->tag << ": " << item->error << "\n";
+            qStdErr.flush();
+            finished.insert(item->seq, QStringList());
+        } else {
+            queue.enqueue(item);
+        }
+        dispatch();
+        publish();
+    }
+
+    void dispatch() {
+        for (Jt9Worker *w : workers) {
+            if (queue.isEmpty()) break;
+            if (running.contains(w)) continue;
+            ArchiveItemPtr item = queue.dequeue();
+            reader->releaseSlot();
+            startItem(w, item);
+        }
+    }
+
+    void startItem(Jt9Worker *w, const ArchiveItemPtr &item) {
+        dec_data_t *d = w->data();
+        int n = (int)item->samples->size();
+        memcpy(d->d2, item->samples->data(), n * sizeof(short));
+        if (last_kin[w] > n) {
+            // Leftover audio from a longer member would otherwise be decoded again
+            memset(d->d2 + n, 0, (last_kin[w] - n) * sizeof(short));
+        }
+        last_kin[w] = n;
+
+        w->memory()->lock();
+        d->params = main_params;
+        d->params.nutc = item->nutc;
+        d->params.kin = n;
+        d->params.newdat = true;
+        w->memory()->unlock();
+
+        Running &r = running[w];
+        r.item = item;
+        r.lines.clear();
+        r.start_ns = monotonic_ns();
+        w->trigger(mode.ihsym);
+    }
+
+    void onWorkerFinished(Jt9Worker *w, int ndecoded) {
+        w->acknowledge();
+        if (!running.contains(w)) return;
+        Running r = running.take(w);
+        double seconds = (monotonic_ns() - r.start_ns) / 1e9;
+        members++;
+        decodes += ndecoded;
+        audio_s += (double)r.item->samples->size() / RX_SAMPLE_RATE;
+        decode_s += seconds;
+
+        QStringList out;
+        for (const QString &line : r.lines) {
+            QString tagged = line + "  file=" + r.item->tag;
+            DecodeRecord rec;
+            if (watch && parse_decode_line(line, rec)) watch->check(rec, tagged);
+            out << (input_done ? QString::number(r.item->start_ms) + " " + tagged : tagged);
+        }
+        finished.insert(r.item->seq, out);
+        qStdErr << "Archive: " << r.item->tag << " decoded, " << r.lines.size() << " messages in "
+                << QString::number(seconds, 'f', 2) << " s\n";
+        qStdErr.flush();
+
+        dispatch();
+        publish();
+    }
+
+    void publish() {
+        while (finished.contains(next_publish)) {
+            QStringList lines = finished.take(next_publish);
+            if (input_ends.contains(next_publish)) {
+                ArchiveItemPtr end = input_ends.take(next_publish);
+                if (input_done) input_done(end, input_lines);
+                input_lines.clear();
+            } else if (input_done) {
+                input_lines += lines;
+            } else {
+                for (const QString &line : lines) {
+                    qStdOut << line << "\n";
+                }
+            }
+            next_publish++;
+        }
+        qStdOut.flush();
+        if (reader_done && queue.isEmpty() && running.isEmpty() && finished.isEmpty()) {
+            double wall_s = (monotonic_ns() - started_ns) / 1e9;
+            qStdOut << "<ArchiveStats>"
+                    << " archives_failed=" << reader->archivesFailed()
+                    << " members=" << members
+                    << " failed=" << failed
+                    << " decodes=" << decodes
+                    << " audio_s=" << QString::number(audio_s, 'f', 1)
+                    << " decode_s=" << QString::number(decode_s, 'f', 1)
+                    << " wall_s=" << QString::number(wall_s, 'f', 1)
+                    << " throughput_x=" << QString::number(wall_s > 0.0 ? audio_s / wall_s : 0.0, 'f', 2)
+                    << " </ArchiveStats>\n";
+            qStdOut.flush();
+            QCoreApplication::exit(reader->archivesFailed() > 0 ? 1 : 0);
+        }
+    }
+
+    QList<Jt9Worker*> workers;
+    ModeConfig mode;
+    decltype(dec_data_t::params) main_params;
+    ArchiveReader *reader;
+    QQueue<ArchiveItemPtr> queue;
+    QHash<Jt9Worker*, Running> running;
+    QHash<Jt9Worker*, int> last_kin;
+    QMap<int, QStringList> finished;   // decoded, waiting for earlier members
+    QMap<int, ArchiveItemPtr> input_ends;
+    InputDoneFn input_done;
+    QStringList input_lines;           // collected for input_done
+    int next_publish;
+    bool reader_done;
+    int members;
+    int failed;
+    int decodes;
+    double audio_s;
+    double decode_s;
+    qint64 started_ns;
+    WatchlistMonitor *watch;
+};
+
+// Work queue shared by several nodes through a common directory:
+//   todo/     items (archives or recordings); copy in under a dot-name, then rename
+//   leases/   claimed items, renamed to <item>@<node>; the file's mtime is the heartbeat
+//   results/  <item>.txt with the item's decodes, then <item>.commit once complete
+//   done/     items whose results are committed; failed/ items that could not be read
+//   nodes/    one file per node, touched with every heartbeat
+// Claims and hand-backs are single renames, atomic on one filesystem, so no
+// two nodes hold the same lease. A lease whose heartbeat is older than the
+// expiry belongs to a crashed node and goes back to todo/ (or to done/ if its
+// results were committed). Ages are measured against this node's own file in
+// nodes/, so both timestamps come from the file server's clock.
+class WorkQueue {
+public:
+    WorkQueue(const QString &dir, int lease_s)
+        : dir(dir), lease_ms(lease_s * 1000LL), claimed(0), committed(0), failed(0), recovered(0), lost(0)
+    {
+        char host[256] = "node";
+        gethostname(host, sizeof(host) - 1);
+        node = QString("%1.%2").arg(QString::fromLocal8Bit(host)).arg(QCoreApplication::applicationPid());
+    }
+
+    bool open() {
+        QDir d(dir);
+        for (const char *sub : { "todo", "leases", "results", "done", "failed", "nodes" }) {
+            if (!d.mkpath(sub)) return false;
+        }
+        return serverNowMs() > 0;
+    }
+
+    // Reader thread: claim the next item, waiting while another node's lease may still expire
+    bool claim(ArchiveInput &input, const std::atomic<bool> &aborting) {
+        while (!aborting) {
+            recoverExpired();
+            QStringList items = QDir(dir + "/todo").entryList(QDir::Files, QDir::Name);
+            for (const QString &item : items) {
+                QString lease = QString("%1/leases/%2@%3").arg(dir, item, node);
+                if (::rename(QFile::encodeName(dir + "/todo/" + item).constData(), QFile::encodeName(lease).constData()) != 0) {
+                    continue;   // taken by another node first
+                }
+                // rename() keeps the item's old mtime, which would read as an expired lease
+                utimensat(AT_FDCWD, QFile::encodeName(lease).constData(), nullptr, 0);
+                {
+                    QMutexLocker lock(&mutex);
+                    held.insert(lease);
+                }
+                claimed++;
+                input.path = lease;
+                input.name = item;
+                log_from_thread(QString("Queue: claimed %1\n").arg(item));
+                return true;
+            }
+            if (!foreignLeases()) return false;
+            for (int i = 0; i < 20 && !aborting; i++) QThread::msleep(100);
+        }
+        return false;
+    }
+
+    // Main thread, a few times per lease period
+    void heartbeat() {
+        serverNowMs();
+        QMutexLocker lock(&mutex);
+        for (const QString &lease : held) {
+            if (utimensat(AT_FDCWD, QFile::encodeName(lease).constData(), nullptr, 0) != 0 && errno == ENOENT &&
+                !lost_leases.contains(lease)) {
+                lost_leases.insert(lease);
+                qStdErr << "Warning: Queue: lease " << QFileInfo(lease).fileName() << " was taken over\n";
+                qStdErr.flush();
+            }
+        }
+    }
+
+    // Main thread: write the item's results, then the commit marker, then release the lease
+    void commit(const ArchiveItemPtr &end, const QStringList &lines) {
+        const QString &item = end->input.name;
+        const QString &lease = end->input.path;
+        {
+            QMutexLocker lock(&mutex);
+            held.remove(lease);
+            lost_leases.remove(lease);
+        }
+        if (!end->error.isEmpty()) {
+            failed++;
+            ::rename(QFile::encodeName(lease).constData(), QFile::encodeName(dir + "/failed/" + item).constData());
+            return;
+        }
+
+        // Time order within the item; merge interleaves items by the same key
+        QStringList sorted = lines;
+        std::stable_sort(sorted.begin(), sorted.end(), [](const QString &a, const QString &b) {
+            return a.section(' ', 0, 0).toLongLong() < b.section(' ', 0, 0).toLongLong();
+        });
+        QString tmp = QString("%1/results/.%2.%3.tmp").arg(dir, item, node);
+        QString txt = QString("%1/results/%2.txt").arg(dir, item);
+        QString marker = QString("%1/results/%2.commit").arg(dir, item);
+        QByteArray info = QString("node=%1 lines=%2 committed=%3\n")
+                          .arg(node).arg(sorted.size())
+                          .arg(QDateTime::currentDateTimeUtc().toString(Qt::ISODate)).toUtf8();
+        if (!writeSynced(tmp, sorted.join("\n").toUtf8() + (sorted.isEmpty() ? "" : "\n")) ||
+            ::rename(QFile::encodeName(tmp).constData(), QFile::encodeName(txt).constData()) != 0 ||
+            !writeSynced(marker, info)) {
+            // Lease stays; it expires and another node redoes the item
+            qStdErr << "Error: Queue: cannot write results for " << item << "\n";
+            qStdErr.flush();
+            QFile::remove(tmp);
+            return;
+        }
+        committed++;
+        if (::rename(QFile::encodeName(lease).constData(), QFile::encodeName(dir + "/done/" + item).constData()) != 0) {
+            // Expired while decoding; whoever re-claimed it writes identical results
+            lost++;
+            qStdErr << "Warning: Queue: lease on " << item << " was lost before commit\n";
+        }
+        qStdErr << "Queue: committed " << item << " (" << sorted.size() << " decodes)\n";
+        qStdErr.flush();
+    }
+
+    void printStats() {
+        qStdOut << "<QueueStats>"
+                << " node=" << node
+                << " claimed=" << claimed
+                << " committed=" << committed
+                << " failed=" << failed
+                << " recovered=" << recovered
+                << " lost=" << lost
+                << " </QueueStats>\n";
+        qStdOut.flush();
+    }
+
+    const QString &nodeName() const { return node; }
+
+private:
+    // Touch this node's file and read back its mtime as set by the file server
+    qint64 serverNowMs() {
+        QByteArray path = QFile::encodeName(QString("%1/nodes/%2").arg(dir, node));
+        int fd = ::open(path.constData(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0) return 0;
+        struct stat st;
+        bool ok = futimens(fd, nullptr) == 0 && fstat(fd, &st) == 0;
+        ::close(fd);
+        return ok ? st.st_mtim.tv_sec * 1000LL + st.st_mtim.tv_nsec / 1000000 : 0;
+    }
+
+    bool foreignLeases() {
+        for (const QString &lease : QDir(dir + "/leases").entryList(QDir::Files)) {
+            if (!lease.endsWith("@" + node)) return true;
+        }
+        return false;
+    }
+
+    void recoverExpired() {
+        qint64 now_ms = serverNowMs();
+        if (now_ms <= 0) return;
+        for (const QFileInfo &fi : QDir(dir + "/leases").entryInfoList(QDir::Files)) {
+            QString name = fi.fileName();
+            int at = name.lastIndexOf('@');
+            if (at <= 0 || name.endsWith("@" + node)) continue;
+            qint64 age_ms = now_ms - fi.lastModified().toMSecsSinceEpoch();
+            if (age_ms < lease_ms) continue;
+            QString item = name.left(at);
+            bool done = QFile::exists(QString("%1/results/%2.commit").arg(dir, item));
+            QString dest = QString("%1/%2/%3").arg(dir, done ? "done" : "todo", item);
+            if (::rename(QFile::encodeName(fi.filePath()).constData(), QFile::encodeName(dest).constData()) == 0) {
+                recovered++;
+                log_from_thread(QString("Queue: lease of %1 held by %2 expired after %3 s, %4\n")
+                                .arg(item, name.mid(at + 1)).arg(age_ms / 1000)
+                                .arg(done ? "results were committed" : "requeued"));
+            }
+        }
+    }
+
+    static bool writeSynced(const QString &path, const QByteArray &data) {
+        QFile f(path);
+        if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+        bool ok = f.write(data) == data.size() && f.flush() && fsync(f.handle()) == 0;
+        f.close();
+        return ok;
+    }
+
+    QString dir;
+    QString node;
+    qint64 lease_ms;
+    QMutex mutex;
+    QSet<QString> held;         // lease paths this node is working on
+    QSet<QString> lost_leases;
+    std::atomic<int> claimed;
+    int committed;
+    int failed;
+    std::atomic<int> recovered;
+    int lost;
+};
+
+// Merge committed queue results into one time-ordered listing on stdout.
+// Each results file is already sorted, so this is a k-way merge reading one
+// line per file at a time; output lines are prefixed yymmdd_ like ALL.TXT.
+int merge_queue_results(const QString &dir) {
+    QDir results(dir + "/results");
+    QStringList markers = results.entryList(QStringList() << "*.commit", QDir::Files, QDir::Name);
+    int pending = QDir(dir + "/todo").entryList(QDir::Files).size() + QDir(dir + "/leases").entryList(QDir::Files).size();
+
+    // One open file per committed item
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    struct Head {
+        qint64 ms;
+        int file;
+        QString line;
+    };
+    auto later = [](const Head &a, const Head &b) { return a.ms != b.ms ? a.ms > b.ms : a.file > b.file; };
+    std::vector<Head> heap;
+    std::vector<std::unique_ptr<QFile> > files;
+
+    auto advance = [&](int i) {
+        while (!files[i]->atEnd()) {
+            QString raw = QString::fromUtf8(files[i]->readLine()).trimmed();
+            int sp = raw.indexOf(' ');
+            if (sp <= 0) continue;
+            heap.push_back(Head{ raw.left(sp).toLongLong(), i, raw.mid(sp + 1) });
+            std::push_heap(heap.begin(), heap.end(), later);
+            return;
+        }
+    };
+
+    for (const QString &marker : markers) {
+        QString txt = results.filePath(marker.left(marker.size() - 7) + ".txt");
+        std::unique_ptr<QFile> f(new QFile(txt));
+        if (!f->open(QIODevice::ReadOnly)) {
+            qStdErr << "Warning: Cannot open " << txt << "\n";
+            continue;
+        }
+        files.push_back(std::move(f));
+        advance((int)files.size() - 1);
+    }
+
+    qint64 lines = 0;
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        Head h = heap.back();
+        heap.pop_back();
+        QString date = h.ms > 0 ? QDateTime::fromMSecsSinceEpoch(h.ms, Qt::UTC).toString("yyMMdd") : QString("000000");
+        qStdOut << date << "_" << h.line << "\n";
+        lines++;
+        advance(h.file);
+    }
+    qStdOut.flush();
+
+    qStdErr << "Merged " << lines << " decodes from " << files.size() << " committed item(s)";
+    if (pending > 0) {
+        qStdErr << "; " << pending << " item(s) not yet committed";
+    }
+    qStdErr << "\n";
+    qStdErr.flush();
+    return 0;
+}
+
+// Synthetic 12 kHz PCM for the ingest benchmark: a shared noise-plus-tone
+// table replayed from a per-stream offset, paced at 'speed' times real time.
+// Every stream starts at the same instant, so cycle boundaries coincide the
+// way UTC-aligned receivers' do.
+class SyntheticSource : public SampleSource {
+public:
+    SyntheticSource(const std::vector<short> *table, int offset, double speed, qint64 start_ns)
+        : table(table), pos(offset), speed(speed), start_ns(start_ns), produced(0), closed(false) {}
+
+    bool open() override { return true; }
+
+    int readSamples(short *buf, int max_samples) override {
+        while (!closed) {
+            qint64 due = samplesDue(monotonic_ns()) - produced;
+            if (due < BLOCK) {
+                QThread::usleep((unsigned long)((BLOCK - due) * 1e6 / (RX_SAMPLE_RATE * speed)) + 1);
+                continue;
+            }
+            int n = (int)qMin<qint64>(due, max_samples);
+            for (int i = 0; i < n; i++) {
+                buf[i] = (*table)[pos];
+                if (++pos == (int)table->size()) pos = 0;
+            }
+            produced += n;
+            return n;
+        }
+        return -1;
+    }
+
+    void close() override { closed = true; }
+    QString describe() const override { return "synthetic PCM"; }
+
+    // Time at which sample k was due from the source
+    qint64 sampleTimeNs(qint64 k) const { return start_ns + (qint64)(k * 1e9 / (RX_SAMPLE_RATE * speed)); }
+    qint64 samplesDue(qint64 now_ns) const { return (qint64)((now_ns - start_ns) * 1e-9 * RX_SAMPLE_RATE * speed); }
+    qint64 producedSamples() const { return produced; }
+
+private:
+    static const int BLOCK = 240;   // 20 ms of audio per read at real time
+
+    const std::vector<short> *table;
+    int pos;
+    double speed;
+    qint64 start_ns;
+    std::atomic<qint64> produced;
+    std::atomic<bool> closed;
+};
+
+// Ingest scalability benchmark: N synthetic streams, each with its own reader
+// thread and ring, go through cycle extraction, conditioning and a stub output
+// stage on the DSP pool's ingest lane. jt9 is not involved. For each stream
+// count it prints one <IngestBench> and one <PoolStats> line on stdout.
+class IngestBenchmark {
+public:
+    IngestBenchmark(const ModeConfig &mode, double speed, int seconds, double ring_cycles, DspPool *pool)
+        : mode(mode), speed(speed), seconds(seconds), pool(pool)
+    {
+        cycle_samples = (RX_SAMPLE_RATE * mode.cycle_ms) / 1000;
+        ring_size = (int)(cycle_samples * ring_cycles) + RX_SAMPLE_RATE;
+
+        // Band noise plus a weak tone, long enough that streams do not share phase
+        table.resize(RX_SAMPLE_RATE * 7);
+        quint32 seed = 12345;
+        for (size_t i = 0; i < table.size(); i++) {
+            seed = seed * 1664525u + 1013904223u;
+            double noise = ((seed >> 16) & 0xffff) / 65536.0 - 0.5;
+            table[i] = (short)(noise * 2000.0 + 300.0 * sin(2.0 * M_PI * 1500.0 * i / RX_SAMPLE_RATE) + 40.0);
+        }
+        null_fd = ::open("/dev/null", O_WRONLY);
+    }
+
+    ~IngestBenchmark() {
+        if (null_fd >= 0) ::close(null_fd);
+    }
+
+    void run(int streams) {
+        qint64 start_ns = monotonic_ns() + 100000000LL;
+        std::vector<Stream*> list;
+        for (int i = 0; i < streams; i++) {
+            Stream *st = new Stream;
+            st->ring = new short[ring_size];
+            memset(st->ring, 0, ring_size * sizeof(short));
+            st->source = new SyntheticSource(&table, (int)((i * 7919LL) % table.size()), speed, start_ns);
+            st->reader = new AudioReaderThread(st->source, st->ring, ring_size, &st->mutex);
+            st->reader->setStackSize(256 * 1024);
+            st->index = i;
+            st->next_cycle = 1;
+            list.push_back(st);
+        }
+
+        latencies_ms.clear();
+        cycles_done = 0;
+        bytes_moved = 0;
+        pool->takeStats();
+
+        struct rusage ru0, ru1;
+        getrusage(RUSAGE_SELF, &ru0);
+        for (Stream *st : list) st->reader->start();
+
+        // Scan for cycle boundaries, as the cycle timer does for a single stream
+        qint64 end_ns = start_ns + (qint64)seconds * 1000000000LL;
+        qint64 max_lag_samples = 0;
+        while (monotonic_ns() < end_ns) {
+            qint64 now_ns = monotonic_ns();
+            for (Stream *st : list) {
+                qint64 total = st->reader->getTotalSamples();
+                max_lag_samples = qMax(max_lag_samples, st->source->samplesDue(now_ns) - total);
+                if (total < st->next_cycle * cycle_samples) continue;
+
+                qint64 boundary_ns = st->source->sampleTimeNs(st->next_cycle * cycle_samples);
+                int cycle_num = st->next_cycle++;
+                int write_pos = st->reader->getWritePos();
+                pool->submit(new FunctionDspTask([this, st, write_pos, boundary_ns, cycle_num]() {
+                    processCycle(st, write_pos, boundary_ns, cycle_num);
+                }), DSP_INGEST, st->index);
+            }
+            QThread::usleep(2000);
+        }
+
+        for (Stream *st : list) st->reader->stop();
+        for (Stream *st : list) st->reader->wait();
+        pool->waitForDone();
+        getrusage(RUSAGE_SELF, &ru1);
+        double wall_s = (monotonic_ns() - start_ns) / 1e9;
+
+        qint64 ingested = 0;
+        for (Stream *st : list) {
+            ingested += st->reader->getTotalSamples();
+            delete st->reader;
+            delete st->source;
+            delete[] st->ring;
+            delete st;
+        }
+        report(streams, wall_s, ingested, max_lag_samples, ru0, ru1);
+    }
+
+private:
+    struct Stream {
+        short *ring;
+        QMutex mutex;
+        SyntheticSource *source;
+        AudioReaderThread *reader;
+        int index;
+        qint64 next_cycle;
+    };
+
+    // Extract, condition and publish one cycle; decoding is stubbed out
+    void processCycle(Stream *st, int write_pos, qint64 boundary_ns, int cycle_num) {
+        std::vector<short> samples(cycle_samples);
+        extract_cycle(st->ring, ring_size, &st->mutex, write_pos, samples.data(), cycle_samples);
+        double dc, rms;
+        int clipped;
+        condition_cycle(samples.data(), cycle_samples, false, dc, rms, clipped);
+
+        QByteArray line = QString("<DecodeStats> cycle_num=%1 num_decodes=0 rms=%2 dc=%3 clipped=%4 </DecodeStats>\n")
+            .arg(cycle_num).arg(rms, 0, 'f', 1).arg(dc, 0, 'f', 0).arg(clipped).toLatin1();
+        if (null_fd >= 0 && ::write(null_fd, line.constData(), line.size()) < 0) {
+            // Nothing to report; the output stage only has to cost what a real write costs
+        }
+
+        double latency_ms = (monotonic_ns() - boundary_ns) / 1e6;
+        QMutexLocker lock(&stats_mutex);
+        latencies_ms.push_back(latency_ms);
+        cycles_done++;
+        // Ring read into the cycle copy, then conditioning reads and rewrites it
+        bytes_moved += (qint64)cycle_samples * sizeof(short) * 4;
+    }
+
+    void report(int streams, double wall_s, qint64 ingested, qint64 max_lag_samples,
+                const struct rusage &ru0, const struct rusage &ru1) {
+        double cpu_s = (ru1.ru_utime.tv_sec - ru0.ru_utime.tv_sec) + (ru1.ru_utime.tv_usec - ru0.ru_utime.tv_usec) / 1e6 +
+                       (ru1.ru_stime.tv_sec - ru0.ru_stime.tv_sec) + (ru1.ru_stime.tv_usec - ru0.ru_stime.tv_usec) / 1e6;
+        qint64 vcsw = ru1.ru_nvcsw - ru0.ru_nvcsw;
+        qint64 ivcsw = ru1.ru_nivcsw - ru0.ru_nivcsw;
+
+        // Ring writes: the sample lands in the reader's buffer, then in the ring
+        double mb_s = (bytes_moved + ingested * (qint64)sizeof(short) * 2) / wall_s / 1e6;
+
+        std::sort(latencies_ms.begin(), latencies_ms.end());
+        qStdOut << "<IngestBench>"
+                << " streams=" << streams
+                << " speed=" << speed
+                << " seconds=" << QString::number(wall_s, 'f', 1)
+                << " cycles=" << cycles_done
+                << " samples=" << ingested
+                << " cpu_pct_per_stream=" << QString::number(100.0 * cpu_s / wall_s / streams, 'f', 3)
+                << " cpu_pct_total=" << QString::number(100.0 * cpu_s / wall_s, 'f', 1)
+                << " mem_mb_s=" << QString::number(mb_s, 'f', 1)
+                << " ctx_switches_s=" << QString::number((vcsw + ivcsw) / wall_s, 'f', 0)
+                << " involuntary_s=" << QString::number(ivcsw / wall_s, 'f', 0)
+                << " extract_p50_ms=" << QString::number(percentile(0.50), 'f', 2)
+                << " extract_p99_ms=" << QString::number(percentile(0.99), 'f', 2)
+                << " extract_p999_ms=" << QString::number(percentile(0.999), 'f', 2)
+                << " extract_max_ms=" << QString::number(latencies_ms.empty() ? 0.0 : latencies_ms.back(), 'f', 2)
+                << " max_lag_ms=" << QString::number(max_lag_samples * 1000.0 / RX_SAMPLE_RATE, 'f', 1)
+                << " rss_mb=" << QString::number(rssBytes() / 1e6, 'f', 1)
+                << " </IngestBench>\n";
+        qStdOut << "<PoolStats> streams=" << streams << pool->takeStats() << " </PoolStats>\n";
+        qStdOut.flush();
+    }
+
+    double percentile(double p) const {
+        if (latencies_ms.empty()) return 0.0;
+        size_t idx = qMin(latencies_ms.size() - 1, (size_t)(p * latencies_ms.size()));
+        return latencies_ms[idx];
+    }
+
+    static qint64 rssBytes() {
+        QFile f("/proc/self/statm");
+        if (!f.open(QIODevice::ReadOnly)) return 0;
+        QList<QByteArray> fields = f.readAll().split(' ');
+        return fields.size() > 1 ? fields[1].toLongLong() * sysconf(_SC_PAGESIZE) : 0;
+    }
+
+    ModeConfig mode;
+    double speed;
+    int seconds;
+    DspPool *pool;
+    int cycle_samples;
+    int ring_size;
+    std::vector<short> table;
+    int null_fd;
+
+    QMutex stats_mutex;
+    std::vector<double> latencies_ms;
+    qint64 cycles_done;
+    qint64 bytes_moved;
+};
+
+// Watchlist matching benchmark: synthetic watchlists of growing size (mostly
+// callsigns, then prefixes, grids and message substrings, plus a fixed set of
+// regexes) matched against synthetic FT8 traffic. For each size it prints one
+// <WatchlistBench> line, including the cost of the naive alternative, every
+// pattern tested against every decode the way a grep pipeline does.
+class WatchlistBenchmark {
+public:
+    WatchlistBenchmark() : seed(12345) {
+        for (int i = 0; i < DECODES; i++) {
+            QString a = randomCall(), b = randomCall();
+            switch (i % 4) {
+            case 0: messages << "CQ " + a + " " + randomGrid(); break;
+            case 1: messages << a + " " + b + " " + randomGrid(); break;
+            case 2: messages << a + " " + b + " R-" + QString::number(next() % 20 + 1).rightJustified(2, '0'); break;
+            default: messages << a + " " + b + " RR73"; break;
+            }
+        }
+    }
+
+    void run(int patterns) {
+        QList<QPair<QString, QString> > rules;
+        for (int i = 0; i < patterns; i++) {
+            int r = i % 20;
+            if (r < 14) rules << qMakePair(QString("call"), randomCall());
+            else if (r < 17) rules << qMakePair(QString("prefix"), randomCall().left(2 + next() % 2));
+            else if (r < 19) rules << qMakePair(QString("grid"), randomGrid().left(2 + 2 * (next() % 2)));
+            else rules << qMakePair(QString("text"), "CQ " + randomCall().left(3));
+        }
+        static const char *const REGEXES[] = { "^CQ DX ", "^CQ [A-Z]{2} ", " R[+-]\\d\\d$", "^CQ POTA", "\\bJA\\d\\w+ PM\\d\\d$" };
+        for (const char *re : REGEXES) rules << qMakePair(QString("regex"), QString(re));
+
+        qint64 t0 = monotonic_ns();
+        Watchlist list;
+        for (const QPair<QString, QString> &r : rules) list.add(r.first, r.second);
+        list.build();
+        double build_ms = (monotonic_ns() - t0) / 1e6;
+
+        std::vector<int> hits;
+        qint64 matches = 0;
+        t0 = monotonic_ns();
+        for (int pass = 0; pass < PASSES; pass++) {
+            for (const QString &m : messages) {
+                list.match(m, hits);
+                matches += hits.size();
+            }
+        }
+        double ns_per_decode = (double)(monotonic_ns() - t0) / (PASSES * messages.size());
+
+        // Naive: test every pattern against a sample of decodes
+        int naive_n = qMax(1, qMin(messages.size(), 20000000 / qMax(1, patterns)));
+        QList<QRegularExpression> compiled;
+        for (int k = patterns; k < rules.size(); k++) compiled << QRegularExpression(rules[k].second);
+        t0 = monotonic_ns();
+        qint64 naive_matches = 0;
+        for (int i = 0; i < naive_n; i++) {
+            const QString &m = messages[i];
+            for (int k = 0; k < patterns; k++) {
+                if (m.contains(rules[k].second)) naive_matches++;
+            }
+            for (const QRegularExpression &re : compiled) {
+                if (re.match(m).hasMatch()) naive_matches++;
+            }
+        }
+        double naive_ns = (double)(monotonic_ns() - t0) / naive_n;
+
+        qStdOut << "<WatchlistBench>"
+                << " patterns=" << list.size()
+                << " build_ms=" << QString::number(build_ms, 'f', 1)
+                << " memory_kb=" << list.memoryBytes() / 1024
+                << " decodes=" << PASSES * messages.size()
+                << " alerts_per_1k=" << QString::number(1000.0 * matches / (PASSES * messages.size()), 'f', 2)
+                << " ns_per_decode=" << QString::number(ns_per_decode, 'f', 0)
+                << " naive_ns_per_decode=" << QString::number(naive_ns, 'f', 0)
+                << " speedup_x=" << QString::number(naive_ns / qMax(1.0, ns_per_decode), 'f', 1)
+                << " </WatchlistBench>\n";
+        qStdOut.flush();
+    }
+
+private:
+    static const int DECODES = 20000;
+    static const int PASSES = 5;
+
+    quint32 next() {
+        seed = seed * 1664525u + 1013904223u;
+        return seed >> 8;
+    }
+
+    QString randomCall() {
+        static const char *const FORMATS[] = { "LDLLL", "LLDLL", "LLDLLL", "LDLL", "DLDLL" };
+        QString call;
+        for (const char *f = FORMATS[next() % 5]; *f; f++) {
+            call += *f == 'L' ? QChar('A' + next() % 26) : QChar('0' + next() % 10);
+        }
+        return call;
+    }
+
+    QString randomGrid() {
+        return QString(QChar('A' + next() % 18)) + QChar('A' + next() % 18) + QChar('0' + next() % 10) + QChar('0' + next() % 10);
+    }
+
+    quint32 seed;
+    QStringList messages;
+};
+
+// HF channel simulator for benchmark audio. The input (assumed clean, e.g.
+// from WSJT-X's ft8sim) is made analytic with a Hilbert FIR and passed
+// through a Watterson two-path channel: two equal-power paths, the second
+// delayed, each with a complex gain whose spectrum is Gaussian with the
+// given two-sigma Doppler spread (sum of 24 phasors at Gaussian frequencies).
+// Then come a per-cycle linear frequency drift, slow QSB, impulse noise,
+// crowding by random-payload signals carrying the mode's sync pattern (so
+// jt9 has to work on them but they never decode) and AWGN at an SNR in
+// 2500 Hz relative to the input power. Every random choice comes from one
+// seeded generator, so a spec and seed always give the same output.
+class ChannelSimulator {
+public:
+    struct Params {
+        double doppler_hz;      // two-sigma Doppler spread per path (0: no fading)
+        double delay_ms;        // differential delay of the second path
+        double drift_hz_min;    // frequency drift within each cycle
+        double qsb_db;          // peak-to-trough depth of slow fading
+        double qsb_period_s;
+        double impulse_rate;    // clicks per second
+        double impulse_db;      // click peak relative to the input RMS
+        double snr_db;          // AWGN, SNR in 2500 Hz (NAN: no noise)
+        int crowd;              // interfering signals per cycle
+        double crowd_db;        // their power relative to the input
+        quint64 seed;
+    };
+
+    // "<preset>[,key=value,...]" with presets awgn, good, moderate, poor and flutter
+    static bool parse(const QString &spec, Params &p, QString &error) {
+        p.doppler_hz = 0.0;
+        p.delay_ms = 0.0;
+        p.drift_hz_min = 0.0;
+        p.qsb_db = 0.0;
+        p.qsb_period_s = 20.0;
+        p.impulse_rate = 0.0;
+        p.impulse_db = 20.0;
+        p.snr_db = NAN;
+        p.crowd = 0;
+        p.crowd_db = 0.0;
+        p.seed = 1;
+        QStringList items = spec.split(',', Qt::SkipEmptyParts);
+        if (!items.isEmpty() && !items[0].contains('=')) {
+            // CCIR 520 / ITU-R F.1487 channels
+            QString preset = items.takeFirst().toLower();
+            if (preset == "good") { p.doppler_hz = 0.1; p.delay_ms = 0.5; }
+            else if (preset == "moderate") { p.doppler_hz = 0.5; p.delay_ms = 1.0; }
+            else if (preset == "poor") { p.doppler_hz = 1.0; p.delay_ms = 2.0; }
+            else if (preset == "flutter") { p.doppler_hz = 10.0; p.delay_ms = 0.5; }
+            else if (preset != "awgn") {
+                error = QString("unknown channel preset '%1'").arg(preset);
+                return false;
+            }
+        }
+        for (const QString &item : items) {
+            QString key = item.section('=', 0, 0).trimmed().toLower();
+            bool ok = false;
+            double v = item.section('=', 1).toDouble(&ok);
+            if (!ok) {
+                error = QString("bad channel setting '%1'").arg(item);
+                return false;
+            }
+            if (key == "doppler" && v >= 0.0) p.doppler_hz = v;
+            else if (key == "delay" && v >= 0.0 && v <= 10.0) p.delay_ms = v;
+            else if (key == "drift") p.drift_hz_min = v;
+            else if (key == "qsb" && v >= 0.0) p.qsb_db = v;
+            else if (key == "qsb_period" && v > 0.0) p.qsb_period_s = v;
+            else if (key == "impulse" && v >= 0.0) p.impulse_rate = v;
+            else if (key == "impulse_db") p.impulse_db = v;
+            else if (key == "snr") p.snr_db = v;
+            else if (key == "crowd" && v >= 0.0 && v <= 100.0) p.crowd = (int)v;
+            else if (key == "crowd_db") p.crowd_db = v;
+            else if (key == "seed") p.seed = (quint64)v;
+            else {
+                error = QString("bad channel setting '%1'").arg(item);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // ref_power: mean square of the whole input, the reference for all levels
+    ChannelSimulator(const Params &params, const ModeConfig &mode, double ref_power)
+        : p(params), rng(params.seed), t(0), cycle_samples((RX_SAMPLE_RATE * mode.cycle_ms) / 1000),
+          hist_pos(0), drift_phase(0.0), next_impulse(0), impulse_left(0), impulse_amp(0.0),
+          impulses(0), crowders(0), clipped(0)
+    {
+        ref_rms = sqrt(qMax(ref_power, 1.0));
+        design_hilbert();
+        hist.assign(hilbert.size() * 2, 0.0f);
+        delay_samples = (int)lround(p.delay_ms * RX_SAMPLE_RATE / 1000.0);
+        delay_re.assign(qMax(1, delay_samples), 0.0f);
+        delay_im.assign(qMax(1, delay_samples), 0.0f);
+        for (int path = 0; path < 2; path++) {
+            for (int m = 0; m < PHASORS; m++) {
+                Phasor &ph = fading[path][m];
+                double f = p.doppler_hz / 2.0 * rng.gauss();
+                double theta = 2.0 * M_PI * rng.uniform();
+                ph.re = cos(theta);
+                ph.im = sin(theta);
+                ph.step_re = cos(2.0 * M_PI * f / RX_SAMPLE_RATE);
+                ph.step_im = sin(2.0 * M_PI * f / RX_SAMPLE_RATE);
+            }
+        }
+        qsb_phase = 2.0 * M_PI * rng.uniform();
+
+        // WSJT-X quotes SNR in 2500 Hz; white noise at 12 kHz spans 6000 Hz
+        noise_sigma = std::isnan(p.snr_db) ? 0.0
+                    : ref_rms / sqrt(pow(10.0, p.snr_db / 10.0) * 2500.0 / 6000.0);
+        crowd_amp = ref_rms * sqrt(2.0 * pow(10.0, p.crowd_db / 10.0));
+
+        // With noise added, scale the sum to about -20 dBFS so weak SNRs do not clip
+        double total = ref_rms * ref_rms + p.crowd * crowd_amp * crowd_amp / 2.0 + noise_sigma * noise_sigma;
+        out_gain = noise_sigma > 0.0 ? 3300.0 / sqrt(total) : 1.0;
+        if (!strcmp(mode.name, "FT8")) shape = &FT8_SHAPE;
+        else if (!strcmp(mode.name, "FT4")) shape = &FT4_SHAPE;
+        else shape = &FT2_SHAPE;
+        scheduleImpulse();
+    }
+
+    void process(const short *in, short *out, int n) {
+        for (int i = 0; i < n; i++, t++) {
+            if (t % cycle_samples == 0) newCycle();
+
+            // Analytic signal: Hilbert output against the centre tap's delayed input
+            hist[hist_pos] = hist[hist_pos + hilbert.size()] = in[i];
+            if (++hist_pos == (int)hilbert.size()) hist_pos = 0;
+            const float *x = &hist[hist_pos];
+            int centre = (int)hilbert.size() / 2;
+            double a_re = x[centre];
+            double a_im = 0.0;
+            for (int k = 1; k <= centre; k += 2) {
+                a_im += hilbert[centre + k] * (x[centre - k] - x[centre + k]);
+            }
+
+            // Two-path fading
+            double y_re = a_re, y_im = a_im;
+            if (p.doppler_hz > 0.0) {
+                int d = (int)(t % delay_re.size());
+                double b_re = delay_re[d], b_im = delay_im[d];   // input 'delay_samples' ago
+                delay_re[d] = (float)a_re;
+                delay_im[d] = (float)a_im;
+                double g0_re, g0_im, g1_re, g1_im;
+                gain(0, g0_re, g0_im);
+                gain(1, g1_re, g1_im);
+                y_re = g0_re * a_re - g0_im * a_im + g1_re * b_re - g1_im * b_im;
+                y_im = g0_re * a_im + g0_im * a_re + g1_re * b_im + g1_im * b_re;
+            }
+
+            // Drift: offset runs from -d/2 to +d/2 over each cycle
+            if (p.drift_hz_min != 0.0) {
+                double span_hz = p.drift_hz_min * cycle_samples / (60.0 * RX_SAMPLE_RATE);
+                double offset_hz = span_hz * ((double)(t % cycle_samples) / cycle_samples - 0.5);
+                drift_phase = fmod(drift_phase + 2.0 * M_PI * offset_hz / RX_SAMPLE_RATE, 2.0 * M_PI);
+                y_re = y_re * cos(drift_phase) - y_im * sin(drift_phase);
+            }
+
+            double y = y_re;
+            if (p.qsb_db > 0.0) {
+                double phase = 2.0 * M_PI * t / (p.qsb_period_s * RX_SAMPLE_RATE) + qsb_phase;
+                y *= pow(10.0, -p.qsb_db * (1.0 - cos(phase)) / 40.0);
+            }
+            y += crowdSample() + impulseSample();
+            if (noise_sigma > 0.0) y += noise_sigma * rng.gauss();
+
+            long v = lround(y * out_gain);
+            if (v > 32767 || v < -32768) {
+                clipped++;
+                v = qBound(-32768L, v, 32767L);
+            }
+            out[i] = (short)v;
+        }
+    }
+
+    qint64 impulseCount() const { return impulses; }
+    qint64 crowderCount() const { return crowders; }
+    qint64 clippedCount() const { return clipped; }
+    double noiseDbfs() const { return noise_sigma > 0.0 ? 20.0 * log10(noise_sigma * out_gain / 32768.0) : -999.0; }
+
+private:
+    static const int PHASORS = 24;
+    static const int HILBERT_TAPS = 255;
+    static const int MAX_SYMBOLS = 105;
+
+    struct Phasor { double re, im, step_re, step_im; };
+
+    // Keying of a mode's signals, enough to fake their sync
+    struct Shape {
+        int tones;
+        int sps;                // samples per symbol at 12 kHz
+        int nsym;
+        double start_s;         // nominal start after the boundary
+        int sync_len;
+        int sync_groups;
+        int sync_pos[4];
+        int sync[4][7];
+    };
+    static const Shape FT8_SHAPE;
+    static const Shape FT4_SHAPE;
+    static const Shape FT2_SHAPE;
+
+    struct Crowder {
+        double freq_hz;
+        double amp;
+        double phase;
+        qint64 start;
+        int tones[MAX_SYMBOLS];
+    };
+
+    // Deterministic splitmix64 generator; the standard distributions differ between libraries
+    class Random {
+    public:
+        explicit Random(quint64 seed) : state(seed), spare_ok(false), spare(0.0) {}
+        quint64 next() {
+            quint64 z = (state += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            return z ^ (z >> 31);
+        }
+        double uniform() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+        double gauss() {
+            if (spare_ok) {
+                spare_ok = false;
+                return spare;
+            }
+            double u = qMax(uniform(), 1e-300), v = uniform();
+            double r = sqrt(-2.0 * log(u));
+            spare = r * sin(2.0 * M_PI * v);
+            spare_ok = true;
+            return r * cos(2.0 * M_PI * v);
+        }
+
+    private:
+        quint64 state;
+        bool spare_ok;
+        double spare;
+    };
+
+    // Hamming-windowed ideal Hilbert transformer (odd taps only are non-zero)
+    void design_hilbert() {
+        hilbert.assign(HILBERT_TAPS, 0.0f);
+        int centre = HILBERT_TAPS / 2;
+        for (int k = 1; k <= centre; k += 2) {
+            double win = 0.54 + 0.46 * cos(M_PI * k / centre);
+            hilbert[centre + k] = (float)(2.0 / (M_PI * k) * win);
+            hilbert[centre - k] = -hilbert[centre + k];
+        }
+    }
+
+    // Complex path gain with unit mean power, halved so the two paths sum to one
+    void gain(int path, double &re, double &im) {
+        re = im = 0.0;
+        for (int m = 0; m < PHASORS; m++) {
+            Phasor &ph = fading[path][m];
+            re += ph.re;
+            im += ph.im;
+            double r = ph.re * ph.step_re - ph.im * ph.step_im;
+            ph.im = ph.re * ph.step_im + ph.im * ph.step_re;
+            ph.re = r;
+        }
+        double scale = sqrt(0.5 / PHASORS);
+        re *= scale;
+        im *= scale;
+        if (t % 4096 == 0) {
+            // Keep the rotating phasors on the unit circle
+            for (int m = 0; m < PHASORS; m++) {
+                Phasor &ph = fading[path][m];
+                double mag = sqrt(ph.re * ph.re + ph.im * ph.im);
+                ph.re /= mag;
+                ph.im /= mag;
+            }
+        }
+    }
+
+    void newCycle() {
+        crowd.clear();
+        for (int c = 0; c < p.crowd; c++) {
+            Crowder cr;
+            cr.freq_hz = 200.0 + rng.uniform() * (2800.0 - shape->tones * RX_SAMPLE_RATE / (double)shape->sps);
+            cr.amp = crowd_amp * pow(10.0, (rng.uniform() - 0.5) * 0.6);   // +-3 dB spread
+            cr.phase = 0.0;
+            cr.start = t + (qint64)((shape->start_s + rng.uniform() - 0.3) * RX_SAMPLE_RATE);
+            for (int k = 0; k < shape->nsym; k++) {
+                cr.tones[k] = (int)(rng.next() % shape->tones);
+            }
+            for (int g = 0; g < shape->sync_groups; g++) {
+                for (int k = 0; k < shape->sync_len; k++) {
+                    cr.tones[shape->sync_pos[g] + k] = shape->sync[g][k];
+                }
+            }
+            crowd.push_back(cr);
+            crowders++;
+        }
+    }
+
+    double crowdSample() {
+        double sum = 0.0;
+        for (Crowder &cr : crowd) {
+            qint64 k = t - cr.start;
+            if (k < 0 || k >= (qint64)shape->nsym * shape->sps) continue;
+            double f = cr.freq_hz + cr.tones[k / shape->sps] * (double)RX_SAMPLE_RATE / shape->sps;
+            cr.phase = fmod(cr.phase + 2.0 * M_PI * f / RX_SAMPLE_RATE, 2.0 * M_PI);
+            sum += cr.amp * sin(cr.phase);
+        }
+        return sum;
+    }
+
+    // Clicks: exponentially decaying noise bursts about 2 ms long, Poisson arrivals
+    double impulseSample() {
+        if (p.impulse_rate <= 0.0) return 0.0;
+        if (t >= next_impulse) {
+            impulse_left = 24;
+            impulse_amp = ref_rms * pow(10.0, p.impulse_db / 20.0) * (0.5 + rng.uniform());
+            impulses++;
+            scheduleImpulse();
+        }
+        if (impulse_left <= 0) return 0.0;
+        impulse_left--;
+        double v = impulse_amp * (rng.uniform() * 2.0 - 1.0);
+        impulse_amp *= 0.8;
+        return v;
     }
-    
-    // Called if jt9 never sends <DecodeFinished> within 2 cycle periods
-    void onDecodeWatchdog() {
-        watchdog_fires++;
-        qStdErr << "Warning: Decode watchdog fired (total: " << watchdog_fires
-                << ") - jt9 did not finish in time, resetting state\n";
-        qStdErr.flush();
 
-        // Reset flag so the next cycle can trigger a fresh decode
-        decode_in_progress = false;
-        jt9_decode_count = 0;
+    void scheduleImpulse() {
+        if (p.impulse_rate <= 0.0) return;
+        double gap_s = -log(qMax(rng.uniform(), 1e-12)) / p.impulse_rate;
+        next_impulse = t + 1 + (qint64)(gap_s * RX_SAMPLE_RATE);
+    }
 
-        // Force-acknowledge so jt9 is not left waiting for ipc[2]
-        sharedMemory->lock();
-        dec_data->ipc[2] = 1;
-        sharedMemory->unlock();
-    }
-
-    // Called when decode is complete (matching WSJT-X decodeDone at line 5717)
-    void decodeDone() {
-        // Cancel watchdog - clean finish, no recovery needed
-        decode_watchdog->stop();
-        // Calculate decode duration
-        qint64 decode_end_ms = getUtcMs();
-        double decode_duration_s = (decode_end_ms - decode_start_ms) / 1000.0;
-
-        // Output machine-readable statistics to stdout
-        qStdOut << "<DecodeStats>"
-                << " cycle_num=" << total_decodes
-                << " duration_s=" << QString::number(decode_duration_s, 'f', 3)
-                << " num_decodes=" << jt9_decode_count
-                << " skipped_cycles=" << skipped_cycles
-                << " </DecodeStats>\n";
-        qStdOut.flush();
+    Params p;
+    Random rng;
+    qint64 t;                       // samples processed
+    int cycle_samples;
+    double ref_rms;
+    std::vector<float> hilbert;
+    std::vector<float> hist;        // stored twice, as in UsbDemodulator
+    int hist_pos;
+    int delay_samples;
+    std::vector<float> delay_re;
+    std::vector<float> delay_im;
+    Phasor fading[2][PHASORS];
+    double drift_phase;
+    double qsb_phase;
+    double noise_sigma;
+    double crowd_amp;
+    double out_gain;
+    const Shape *shape;
+    std::vector<Crowder> crowd;
+    qint64 next_impulse;
+    int impulse_left;
+    double impulse_amp;
+    qint64 impulses;
+    qint64 crowders;
+    qint64 clipped;
+};
 
-        // Clear decode in progress flag BEFORE acknowledgment (matching WSJT-X line 5750)
-        decode_in_progress = false;
-        jt9_decode_count = 0;
+// FT8: 8-FSK at 6.25 baud, Costas 7x7 at symbols 0, 36 and 72
+const ChannelSimulator::Shape ChannelSimulator::FT8_SHAPE =
+    {8, 1920, 79, 0.5, 7, 3, {0, 36, 72, 0},
+     {{3, 1, 4, 0, 6, 5, 2}, {3, 1, 4, 0, 6, 5, 2}, {3, 1, 4, 0, 6, 5, 2}, {0}}};
+// FT4: 4-FSK at 20.8 baud, four 4x4 sync groups after a ramp symbol
+const ChannelSimulator::Shape ChannelSimulator::FT4_SHAPE =
+    {4, 576, 105, 0.5, 4, 4, {1, 34, 67, 100},
+     {{0, 1, 3, 2}, {1, 0, 2, 3}, {2, 3, 1, 0}, {3, 2, 0, 1}}};
+// FT2: FT4's structure keyed twice as fast
+const ChannelSimulator::Shape ChannelSimulator::FT2_SHAPE =
+    {4, 288, 105, 0.5, 4, 4, {1, 34, 67, 100},
+     {{0, 1, 3, 2}, {1, 0, 2, 3}, {2, 3, 1, 0}, {3, 2, 0, 1}}};
 
-        // Acknowledge decode (matching WSJT-X: to_jt9(m_ihsym, -1, 1) at line 5756)
-        sharedMemory->lock();
-        dec_data->ipc[2] = 1;  // Tell jt9 we know it has finished
-        sharedMemory->unlock();
+// --chansim: read 'input' whole (WAV, otherwise raw 16-bit PCM), pass it
+// through the channel model and write a WAV file or raw PCM on stdout
+int run_channel_simulator(const QString &spec, const ModeConfig &mode, const QString &input,
+                          const QString &output, bool realtime) {
+    ChannelSimulator::Params params;
+    QString error;
+    if (!ChannelSimulator::parse(spec, params, error)) {
+        qStdErr << "Error: " << error << "\n";
+        qStdErr.flush();
+        return 1;
     }
-    
-    void jt9Finished(int exitCode, QProcess::ExitStatus exitStatus) {
-        qStdErr << "Error: jt9 process exited unexpectedly (code: " << exitCode << ")\n";
+    if (input.isEmpty()) {
+        qStdErr << "Error: --chansim needs an input file (raw PCM can come from /dev/stdin)\n";
         qStdErr.flush();
-        QCoreApplication::quit();
+        return 1;
     }
-    
-    void jt9Error(QProcess::ProcessError error) {
-        qStdErr << "Error: jt9 process error: " << error << "\n";
+
+    std::vector<short> in(NTMAX * RX_SAMPLE_RATE);
+    int n;
+    if (input.toLower().endsWith(".wav")) {
+        n = read_wav_file(input, in.data(), (int)in.size());
+    } else {
+        // Pipes return short reads, so read until end of input
+        QFile file(input);
+        n = -1;
+        if (file.open(QIODevice::ReadOnly)) {
+            char *bytes = reinterpret_cast<char*>(in.data());
+            qint64 have = 0, got;
+            while (have < (qint64)(in.size() * sizeof(short))
+                   && (got = file.read(bytes + have, in.size() * sizeof(short) - have)) > 0) {
+                have += got;
+            }
+            n = (int)(have / 2);
+        }
+    }
+    if (n <= 0) {
+        qStdErr << "Error: No audio read from " << input << "\n";
         qStdErr.flush();
-        QCoreApplication::quit();
+        return 1;
     }
-    
-private:
-    qint64 getUtcMs() {
-        struct timespec ts;
-        clock_gettime(CLOCK_REALTIME, &ts);
-        return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000LL;
+    in.resize(n);
+
+    double power = 0.0;
+    for (short x : in) power += (double)x * x;
+    power /= n;
+    ChannelSimulator sim(params, mode, power);
+
+    bool raw = output == "-";
+    std::vector<short> out(n);
+    const int BLOCK = RX_SAMPLE_RATE / 50;
+    qint64 start_ns = monotonic_ns();
+    for (int done = 0; done < n; done += BLOCK) {
+        int len = qMin(BLOCK, n - done);
+        sim.process(in.data() + done, out.data() + done, len);
+        if (!raw) continue;
+        if (realtime) {
+            qint64 due_ns = start_ns + (qint64)done * 1000000000LL / RX_SAMPLE_RATE;
+            qint64 wait_ns = due_ns - monotonic_ns();
+            if (wait_ns > 0) QThread::usleep((unsigned long)(wait_ns / 1000));
+        }
+        if (fwrite(out.data() + done, sizeof(short), len, stdout) != (size_t)len) break;
+        fflush(stdout);
     }
-    
-    qint64 msToNextCycle() {
-        qint64 now_ms = getUtcMs();
-        qint64 ms_in_cycle = now_ms % mode.cycle_ms;
-        return mode.cycle_ms - ms_in_cycle;
+    if (!raw && !write_wav_file(output, out.data(), n)) return 1;
+
+    // Raw audio owns stdout, so the summary goes to stderr then
+    QTextStream &stats = raw ? qStdErr : qStdOut;
+    stats << "<ChanSimStats>"
+          << " spec=" << spec
+          << " mode=" << mode.name
+          << " samples=" << n
+          << " seconds=" << QString::number((double)n / RX_SAMPLE_RATE, 'f', 1)
+          << " input_dbfs=" << QString::number(10.0 * log10(qMax(power, 1.0) / (32768.0 * 32768.0)), 'f', 1)
+          << " noise_dbfs=" << QString::number(sim.noiseDbfs(), 'f', 1)
+          << " crowders=" << sim.crowderCount()
+          << " impulses=" << sim.impulseCount()
+          << " clipped=" << sim.clippedCount()
+          << " </ChanSimStats>\n";
+    stats.flush();
+    return 0;
+}
+
+// Start count extra jt9 workers named <key>_<tag><n>, numbered from first
+bool start_workers(QList<Jt9Worker*> &list, int first, int count, const QString &tag,
+                   const QString &key, const QString &temp_dir_path, const QString &jt9_path,
+                   Jt9OutputCollector *collector) {
+    for (int n = first; n < first + count; n++) {
+        Jt9Worker *w = new Jt9Worker(QString("%1_%2%3").arg(key).arg(tag).arg(n),
+                                     QString("%1_%2%3").arg(temp_dir_path).arg(tag).arg(n),
+                                     QString("jt9[%1%2]").arg(tag).arg(n));
+        list.append(w);
+        if (!w->create() || !w->start(jt9_path, collector)) {
+            return false;
+        }
     }
-    
-    QSharedMemory *sharedMemory;
-    dec_data_t *dec_data;
-    QProcess *jt9;
-    ModeConfig mode;
-    
-    short *circ_buffer;
-    int BUFFER_SIZE;
-    int SAMPLES_PER_CYCLE;
-    QMutex buffer_mutex;
-    AudioReaderThread *reader_thread;
-    
-    QTimer *cycle_timer;
-    QTimer *decode_watchdog;
-    bool decode_in_progress;
-    int total_decodes;
-    int skipped_cycles;
-    int jt9_decode_count;
-    int watchdog_fires;
-    qint64 decode_start_ms;
-};
+    return true;
+}
+
+// Stop, clean up and delete workers created by start_workers()
+void stop_workers(QList<Jt9Worker*> &list) {
+    for (Jt9Worker *w : list) {
+        w->stop();
+        w->removeTempDir();
+        delete w;
+    }
+    list.clear();
+}
+
+// Parses "14074000", "14074k", "14.074M" or "1.2G" into Hz
+bool parse_frequency_hz(const QString &text, qint64 &hz) {
+    QString t = text.trimmed();
+    double scale = 1.0;
+    if (t.endsWith('k', Qt::CaseInsensitive)) scale = 1e3;
+    else if (t.endsWith('M')) scale = 1e6;
+    else if (t.endsWith('G', Qt::CaseInsensitive)) scale = 1e9;
+    if (scale != 1.0) t.chop(1);
+    bool ok = false;
+    double value = t.toDouble(&ok) * scale;
+    if (!ok || value <= 0.0 || value > 4e9) return false;
+    hz = (qint64)llround(value);
+    return true;
+}
 
 int main(int argc, char *argv[]) {
     QCoreApplication app(argc, argv);
     
-    // Create unique application name for this instance (for shared memory key)
-    QString unique_app_name = QString("JT9DECODE_%1_%2")
+    // Create unique application name for this instance (for shared memory key);
+    // the temp dir and registry entry carry the same suffix
+    QString instance_id = QString("%1_%2")
         .arg(QCoreApplication::applicationPid())
         .arg(QDateTime::currentMSecsSinceEpoch());
+    QString unique_app_name = QString("JT9DECODE_%1").arg(instance_id);
     app.setApplicationName(unique_app_name);
+
+    // "jt9_decode gc": reclaim what crashed instances left behind, then exit
+    if (argc == 2 && QString(argv[1]) == "gc") {
+        InstanceRegistry::SweepStats gc = InstanceRegistry::sweep(true);
+        qStdOut << "<GcStats> entries=" << gc.entries << " jt9_killed=" << gc.jt9_killed
+                << " segments=" << gc.segments << " dirs=" << gc.dirs << " bytes=" << gc.bytes << " </GcStats>\n";
+        qStdOut.flush();
+        return 0;
+    }
     
     // Parse command-line arguments
     QString wav_file;
@@ -514,6 +9486,62 @@ int main(int argc, char *argv[]) {
     QString jt9_path;
     bool stream_mode = false;    // Stream PCM from stdin
     bool multithread = false;    // Multithreaded FT8 decoding
+    QString spectrum_dest;       // Spectrum/waterfall output (file or udp:host:port)
+    int spectrum_fft = 4096;     // STFT size (2.93 Hz bins)
+    double spectrum_rate = 2.0;  // Waterfall rows per second
+    double spectrum_avg = 0.0;   // Averaged spectrum period in seconds (0 = one cycle)
+    int decode_worker_count = 1; // jt9 workers for main decodes (stream mode)
+    int hint_top_k = 0;          // AP hint passes per cycle (0 = disabled)
+    int hint_worker_count = 0;   // Spare jt9 workers for hint passes
+    bool remove_dc = false;      // Condition stage: subtract the DC offset, not just measure it
+    int hint_age = 4;            // Cycles a heard station stays a hint candidate
+    RtlTcpConfig rtl;            // Built-in rtl_tcp source (stream mode)
+    rtl.dial_hz = 0;
+    rtl.rate = 240000;
+    rtl.gain_tenths = -1;
+    rtl.ppm = 0;
+    rtl.jitter_ms = 500;
+    QString capture_cmd;         // Supervised capture command (stream mode)
+    QString follow_path;         // WAV file tailed while it is recorded (stream mode)
+    int follow_idle = 60;        // Seconds without growth that end --follow (0 = never)
+    TxSchedule::Sequence decode_seq = TxSchedule::SEQ_BOTH;  // Sequences to decode
+    QString tx_file;             // PTT / TX-sequence control file
+    bool tx_monitor = false;     // Cheap monitor pass on TX cycles instead of skipping
+    QString batch_dir;           // Spool of archive files to backfill
+    QStringList archives;        // tar / zip archives decoded without extraction
+    QString queue_dir;           // Shared work queue directory (multi-node batch)
+    int lease_s = 120;           // Queue lease expiry
+    QString merge_dir;           // Merge committed queue results (no jt9)
+    QList<qint64> hop_dials;     // Band-hopping dial frequencies (stream mode)
+    QString rigctld_host = "localhost";  // Hamlib rigctld for band hopping
+    QString rigctld_port = "4532";
+    int hop_settle_ms = 300;     // Muted after each retune
+    QStringList cluster_nodes;   // Decode nodes for main decodes (stream mode)
+    QString watchlist_path;      // Alert rules matched against every decode
+    QString alerts_dest = "/dev/stderr";  // Alert channel: file, FIFO or udp:host:port
+    QList<int> bench_watchlist;  // Watchlist benchmark sizes (no jt9)
+    QString chansim_spec;        // Channel simulator: preset and settings (no jt9)
+    QString chansim_out = "-";   // Simulator output: WAV file, or '-' for raw PCM on stdout
+    bool chansim_realtime = false;  // Pace raw output at real time
+    int stagger_priority = -1;   // Host-wide decode staggering priority (-1 = off)
+    int stagger_lanes = QThread::idealThreadCount();  // Decodes the host runs side by side
+    int alloc_check = 0;         // Fail on cycle allocations after this many cycles (counting build)
+    int read_block_ms = 20;      // Stream reader: largest block handed to the ring
+    QString mqtt_addr;           // MQTT broker for per-cycle decode batches (stream mode)
+    MqttPublisher::Config mqtt_cfg;
+    QString mqtt_prefix = "jt9_decode";  // Topics: <prefix>/<stream>/<mode>/<band>
+    QString mqtt_stream;         // Stream name in topics (default: host name)
+    QString mqtt_band = "rx";    // Band in topics when not band hopping
+    QString mqtt_broker_addr;    // Run the MQTT broker stand-in here (no jt9)
+    int dsp_threads = 0;         // DSP pool threads (0 = default for the mode)
+    QList<int> dsp_cpus;         // CPUs the DSP pool workers are pinned to
+    QString serve_addr;          // Decode node: accept cycles from capture nodes here
+    QString handover_path;       // Unix socket accepting handover requests
+    QString take_over_path;      // Take over the instance listening here
+    QList<int> bench_streams;    // Ingest benchmark stream counts (no jt9)
+    double bench_speed = 1.0;    // Synthetic source rate relative to real time
+    int bench_seconds = 30;      // Duration of each benchmark step
+    double bench_ring = 2.0;     // Benchmark ring size in cycles
     QString mode_str = "FT2";    // Default mode
     const ModeConfig *mode = &MODE_FT2;  // Default to FT2
     
@@ -543,8 +9571,180 @@ int main(int argc, char *argv[]) {
             stream_mode = true;
         } else if (arg == "-t" || arg == "--multithread") {
             multithread = true;
+        } else if (arg == "--spectrum" && i + 1 < argc) {
+            spectrum_dest = QString(argv[++i]);
+        } else if (arg == "--spectrum-fft" && i + 1 < argc) {
+            spectrum_fft = QString(argv[++i]).toInt();
+            if (spectrum_fft < 256 || spectrum_fft > 65536 || (spectrum_fft & (spectrum_fft - 1)) != 0) {
+                qStdErr << "Error: --spectrum-fft must be a power of two between 256 and 65536\n";
+                qStdErr.flush();
+                return 1;
+            }
+        } else if (arg == "--spectrum-rate" && i + 1 < argc) {
+            spectrum_rate = QString(argv[++i]).toDouble();
+            if (spectrum_rate <= 0.0) {
+                qStdErr << "Error: --spectrum-rate must be positive\n";
+                qStdErr.flush();
+                return 1;
+            }
+        } else if (arg == "--spectrum-avg" && i + 1 < argc) {
+            spectrum_avg = QString(argv[++i]).toDouble();
+        } else if (arg == "--workers" && i + 1 < argc) {
+            decode_worker_count = qMax(1, QString(argv[++i]).toInt());
+        } else if (arg == "--hints" && i + 1 < argc) {
+            hint_top_k = qMax(0, QString(argv[++i]).toInt());
+        } else if (arg == "--hint-workers" && i + 1 < argc) {
+            hint_worker_count = qMax(0, QString(argv[++i]).toInt());
+        } else if (arg == "--hint-age" && i + 1 < argc) {
+            hint_age = qMax(1, QString(argv[++i]).toInt());
+        } else if (arg == "--remove-dc") {
+            remove_dc = true;
+        } else if (arg == "--rtl-tcp" && i + 1 < argc) {
+            QString addr = QString(argv[++i]);
+            int colon = addr.lastIndexOf(':');
+            rtl.host = colon > 0 ? addr.left(colon) : addr;
+            rtl.port = colon > 0 ? addr.mid(colon + 1) : QString("1234");
+            stream_mode = true;
+        } else if (arg == "--capture" && i + 1 < argc) {
+            capture_cmd = QString(argv[++i]);
+            stream_mode = true;
+        } else if (arg == "--follow" && i + 1 < argc) {
+            follow_path = QString(argv[++i]);
+            stream_mode = true;
+        } else if (arg == "--follow-idle" && i + 1 < argc) {
+            follow_idle = qMax(0, QString(argv[++i]).toInt());
+        } else if (arg == "--rtl-freq" && i + 1 < argc) {
+            if (!parse_frequency_hz(QString(argv[++i]), rtl.dial_hz)) {
+                qStdErr << "Error: Invalid --rtl-freq '" << argv[i] << "'\n";
+                qStdErr.flush();
+                return 1;
+            }
+        } else if (arg == "--rtl-rate" && i + 1 < argc) {
+            rtl.rate = QString(argv[++i]).toInt();
+            if (rtl.rate < 96000 || rtl.rate % 24000 != 0) {
+                qStdErr << "Error: --rtl-rate must be a multiple of 24000 and at least 96000\n";
+                qStdErr.flush();
+                return 1;
+            }
+        } else if (arg == "--rtl-gain" && i + 1 < argc) {
+            QString gain = QString(argv[++i]);
+            rtl.gain_tenths = gain == "auto" ? -1 : qMax(0, (int)lround(gain.toDouble() * 10.0));
+        } else if (arg == "--rtl-ppm" && i + 1 < argc) {
+            rtl.ppm = QString(argv[++i]).toInt();
+        } else if (arg == "--rtl-jitter" && i + 1 < argc) {
+            rtl.jitter_ms = qBound(50, QString(argv[++i]).toInt(), 5000);
+        } else if (arg == "--decode-seq" && i + 1 < argc) {
+            QString seq = QString(argv[++i]).toLower();
+            if (seq == "even") {
+                decode_seq = TxSchedule::SEQ_EVEN;
+            } else if (seq == "odd") {
+                decode_seq = TxSchedule::SEQ_ODD;
+            } else if (seq == "both") {
+                decode_seq = TxSchedule::SEQ_BOTH;
+            } else {
+                qStdErr << "Error: --decode-seq must be even, odd or both\n";
+                qStdErr.flush();
+                return 1;
+            }
+        } else if (arg == "--tx-file" && i + 1 < argc) {
+            tx_file = QString(argv[++i]);
+        } else if (arg == "--tx-monitor") {
+            tx_monitor = true;
+        } else if (arg == "--batch-dir" && i + 1 < argc) {
+            batch_dir = QString(argv[++i]);
+        } else if (arg == "--archive" && i + 1 < argc) {
+            archives.append(QString(argv[++i]));
+        } else if (arg == "--queue" && i + 1 < argc) {
+            queue_dir = QString(argv[++i]);
+        } else if (arg == "--lease" && i + 1 < argc) {
+            lease_s = qMax(10, QString(argv[++i]).toInt());
+        } else if (arg == "--queue-merge" && i + 1 < argc) {
+            merge_dir = QString(argv[++i]);
+        } else if (arg == "--hop" && i + 1 < argc) {
+            for (const QString &f : QString(argv[++i]).split(',', Qt::SkipEmptyParts)) {
+                qint64 hz = 0;
+                if (!parse_frequency_hz(f, hz)) {
+                    qStdErr << "Error: Invalid --hop frequency '" << f << "'\n";
+                    qStdErr.flush();
+                    return 1;
+                }
+                hop_dials.append(hz);
+            }
+        } else if (arg == "--rigctld" && i + 1 < argc) {
+            QString addr = QString(argv[++i]);
+            int colon = addr.lastIndexOf(':');
+            rigctld_host = colon > 0 ? addr.left(colon) : addr;
+            rigctld_port = colon > 0 ? addr.mid(colon + 1) : QString("4532");
+        } else if (arg == "--hop-settle" && i + 1 < argc) {
+            hop_settle_ms = qBound(0, QString(argv[++i]).toInt(), 2000);
+        } else if (arg == "--watchlist" && i + 1 < argc) {
+            watchlist_path = QString(argv[++i]);
+        } else if (arg == "--alerts" && i + 1 < argc) {
+            alerts_dest = QString(argv[++i]);
+        } else if (arg == "--bench-watchlist" && i + 1 < argc) {
+            for (const QString &n : QString(argv[++i]).split(',', Qt::SkipEmptyParts)) {
+                if (n.toInt() > 0) bench_watchlist.append(n.toInt());
+            }
+        } else if (arg == "--chansim" && i + 1 < argc) {
+            chansim_spec = QString(argv[++i]);
+        } else if (arg == "--chansim-out" && i + 1 < argc) {
+            chansim_out = QString(argv[++i]);
+        } else if (arg == "--chansim-realtime") {
+            chansim_realtime = true;
+        } else if (arg == "--stagger" && i + 1 < argc) {
+            stagger_priority = qBound(0, QString(argv[++i]).toInt(), 9);
+        } else if (arg == "--stagger-lanes" && i + 1 < argc) {
+            stagger_lanes = qMax(1, QString(argv[++i]).toInt());
+        } else if (arg == "--dsp-threads" && i + 1 < argc) {
+            dsp_threads = qMax(1, QString(argv[++i]).toInt());
+        } else if (arg == "--dsp-cpus" && i + 1 < argc) {
+            if (!parse_cpu_list(QString(argv[++i]), dsp_cpus)) {
+                qStdErr << "Error: Invalid CPU list: " << argv[i] << "\n";
+                qStdErr.flush();
+                return 1;
+            }
+        } else if (arg == "--read-block-ms" && i + 1 < argc) {
+            read_block_ms = qBound(1, QString(argv[++i]).toInt(), 340);
+        } else if (arg == "--mqtt" && i + 1 < argc) {
+            mqtt_addr = QString(argv[++i]);
+        } else if (arg == "--mqtt-topic" && i + 1 < argc) {
+            mqtt_prefix = QString(argv[++i]);
+        } else if (arg == "--mqtt-stream" && i + 1 < argc) {
+            mqtt_stream = QString(argv[++i]);
+        } else if (arg == "--mqtt-band" && i + 1 < argc) {
+            mqtt_band = QString(argv[++i]);
+        } else if (arg == "--mqtt-qos" && i + 1 < argc) {
+            mqtt_cfg.qos = qBound(0, QString(argv[++i]).toInt(), 1);
+        } else if (arg == "--mqtt-version" && i + 1 < argc) {
+            mqtt_cfg.version = QString(argv[++i]).startsWith('5') ? 5 : 4;
+        } else if (arg == "--mqtt-spool" && i + 1 < argc) {
+            mqtt_cfg.spool_dir = QString(argv[++i]);
+        } else if (arg == "--mqtt-broker" && i + 1 < argc) {
+            mqtt_broker_addr = QString(argv[++i]);
+        } else if (arg == "--alloc-check" && i + 1 < argc) {
+            alloc_check = qMax(1, QString(argv[++i]).toInt());
+        } else if (arg == "--cluster" && i + 1 < argc) {
+            cluster_nodes = QString(argv[++i]).split(',', Qt::SkipEmptyParts);
+        } else if (arg == "--serve" && i + 1 < argc) {
+            serve_addr = QString(argv[++i]);
+        } else if (arg == "--handover-socket" && i + 1 < argc) {
+            handover_path = QString(argv[++i]);
+        } else if (arg == "--take-over" && i + 1 < argc) {
+            take_over_path = QString(argv[++i]);
+            stream_mode = true;
+        } else if (arg == "--bench-ingest" && i + 1 < argc) {
+            for (const QString &n : QString(argv[++i]).split(',', Qt::SkipEmptyParts)) {
+                if (n.toInt() > 0) bench_streams.append(n.toInt());
+            }
+        } else if (arg == "--bench-speed" && i + 1 < argc) {
+            bench_speed = qMax(0.01, QString(argv[++i]).toDouble());
+        } else if (arg == "--bench-seconds" && i + 1 < argc) {
+            bench_seconds = qMax(1, QString(argv[++i]).toInt());
+        } else if (arg == "--bench-ring" && i + 1 < argc) {
+            bench_ring = qMax(1.0, QString(argv[++i]).toDouble());
         } else if (arg == "--help" || arg == "-help") {
             qStdErr << "Usage: " << argv[0] << " -j <jt9_path> [options] [<wav_file>|-s]\n";
+            qStdErr << "       " << argv[0] << " gc      Reclaim shared memory and temp dirs of dead instances\n";
             qStdErr << "\n";
             qStdErr << "Decode FT2/FT4/FT8 signals from WAV file or stdin stream using jt9\n";
             qStdErr << "\n";
@@ -561,6 +9761,87 @@ int main(int argc, char *argv[]) {
             qStdErr << "                Triggers decodes at cycle boundaries aligned to UTC\n";
             qStdErr << "  -t, --multithread  Enable multithreaded FT8 decoding (FT8 only)\n";
             qStdErr << "                     Uses multiple CPU cores for faster decoding\n";
+            qStdErr << "  --spectrum <dest>  Stream mode: publish spectrum/waterfall records to a\n";
+            qStdErr << "                     file or udp:<host>:<port> (compact binary, see README)\n";
+            qStdErr << "  --spectrum-fft <n>   STFT size, power of two (default: 4096)\n";
+            qStdErr << "  --spectrum-rate <r>  Waterfall rows per second (default: 2)\n";
+            qStdErr << "  --spectrum-avg <s>   Averaged spectrum period in seconds (default: one cycle)\n";
+            qStdErr << "  --workers <n>      Stream/archive mode: jt9 decode workers (default: 1); with more\n";
+            qStdErr << "                     than one, a slow cycle no longer delays the next\n";
+            qStdErr << "  --hints <k>        Stream mode: run up to k extra AP decode passes per cycle\n";
+            qStdErr << "                     targeting stations and QSOs heard in recent cycles\n";
+            qStdErr << "  --hint-workers <n> Spare jt9 workers for hint passes (default: 0, use the\n";
+            qStdErr << "                     main worker when the pass fits before the next cycle)\n";
+            qStdErr << "  --hint-age <c>     Cycles a heard station stays a candidate (default: 4)\n";
+            qStdErr << "  --remove-dc        Stream mode: subtract each cycle's DC offset before decoding\n";
+            qStdErr << "                     (default: only measure it)\n";
+            qStdErr << "  --rtl-tcp <host[:port]>  Stream from an rtl_tcp server instead of stdin\n";
+            qStdErr << "                     (implies -s; USB demodulation built in, reconnects)\n";
+            qStdErr << "  --rtl-freq <f>       Dial frequency, e.g. 14.074M (required with --rtl-tcp)\n";
+            qStdErr << "  --rtl-rate <sps>     IQ sample rate, multiple of 24000 (default: 240000)\n";
+            qStdErr << "  --rtl-gain <dB|auto> Tuner gain (default: auto)\n";
+            qStdErr << "  --rtl-ppm <n>        Frequency correction in ppm (default: 0)\n";
+            qStdErr << "  --rtl-jitter <ms>    Network jitter buffer depth (default: 500)\n";
+            qStdErr << "  --capture <cmd>    Run a capture command (e.g. rtl_fm ...) and stream its stdout\n";
+            qStdErr << "                     (implies -s; restarted with backoff, cycles hit by the gap skipped)\n";
+            qStdErr << "  --follow <file.wav>  Decode a WAV file while it is being recorded, tailing its data\n";
+            qStdErr << "                     chunk with inotify (implies -s; ends when the file is finalized)\n";
+            qStdErr << "  --follow-idle <s>  End --follow after s seconds without new data (default: 60, 0: never)\n";
+            qStdErr << "  --decode-seq <s>   Stream mode: decode only even or odd sequences (default: both)\n";
+            qStdErr << "  --tx-file <path>   PTT/TX control file polled 4x per second; lines: 'ptt on',\n";
+            qStdErr << "                     'ptt off', 'tx even', 'tx odd', 'tx none'. TX cycles are skipped\n";
+            qStdErr << "  --tx-monitor       Run a cheap depth-1 monitor pass on TX cycles instead\n";
+            qStdErr << "  --batch-dir <dir>  Stream mode: decode *.wav / *.raw files from dir in idle\n";
+            qStdErr << "                     worker time, below live cycles; results in dir/done/\n";
+            qStdErr << "  --archive <path>   Decode the WAV/FLAC/raw members of a tar (.gz/.zst) or zip\n";
+            qStdErr << "                     archive without extracting it; repeatable, uses --workers\n";
+            qStdErr << "  --queue <dir>      Claim archives/recordings from a work queue directory shared\n";
+            qStdErr << "                     by several nodes; results in dir/results/ (uses --workers)\n";
+            qStdErr << "  --lease <s>        Queue lease expiry for crashed nodes (default: 120)\n";
+            qStdErr << "  --queue-merge <dir>  Print committed queue results in time order (no jt9)\n";
+            qStdErr << "  --hop <f,f,...>    Stream mode: hop one receiver between these dial frequencies\n";
+            qStdErr << "                     at cycle boundaries, weighted by recent decodes per band\n";
+            qStdErr << "  --rigctld <host[:port]>  Hamlib rigctld used to retune (default: localhost:4532)\n";
+            qStdErr << "  --hop-settle <ms>  Audio muted after each retune (default: 300)\n";
+            qStdErr << "  --watchlist <file>  Alert on decodes matching callsign, prefix, grid, entity,\n";
+            qStdErr << "                     text or regex rules; the file is reloaded when it changes\n";
+            qStdErr << "  --alerts <dest>    Alert channel: file, FIFO or udp:<host>:<port> (default: stderr)\n";
+            qStdErr << "  --bench-watchlist <n,n,...>  Benchmark watchlist matching with n patterns (no jt9)\n";
+            qStdErr << "  --chansim <spec>   Pass the input file (WAV, or raw PCM such as /dev/stdin) through\n";
+            qStdErr << "                     an HF channel model (no jt9): awgn|good|moderate|poor|flutter\n";
+            qStdErr << "                     then ,key=value: doppler delay drift qsb qsb_period impulse\n";
+            qStdErr << "                     impulse_db snr crowd crowd_db seed\n";
+            qStdErr << "  --chansim-out <f>  Simulator output: WAV file, or - for raw PCM on stdout (default)\n";
+            qStdErr << "  --chansim-realtime  Pace raw simulator output at real time (for -s)\n";
+            qStdErr << "  --stagger <0-9>    Stream mode: plan decode starts with the other instances on this\n";
+            qStdErr << "                     host sharing a cycle boundary; higher priority starts first\n";
+            qStdErr << "  --stagger-lanes <n>  Decodes the host runs side by side (default: CPU count)\n";
+            qStdErr << "  --dsp-threads <n>  Shared DSP pool threads (default: 2; CPU count for --bench-ingest)\n";
+            qStdErr << "  --dsp-cpus <list>  Pin DSP pool threads to these CPUs, e.g. 2-3 or 0,2,4\n";
+            qStdErr << "  --read-block-ms <ms>  Stream mode: largest block the reader hands to the ring,\n";
+            qStdErr << "                     1-340 (default: 20)\n";
+            qStdErr << "  --mqtt <[user:pass@]host[:port]>  Stream mode: publish each cycle's decodes as\n";
+            qStdErr << "                     one JSON message to this MQTT broker (port 1883)\n";
+            qStdErr << "  --mqtt-topic <p>   Topic prefix; topics are <p>/<stream>/<mode>/<band> (default: jt9_decode)\n";
+            qStdErr << "  --mqtt-stream <s>  Stream name in topics (default: host name)\n";
+            qStdErr << "  --mqtt-band <b>    Band in topics unless --hop supplies it (default: rx)\n";
+            qStdErr << "  --mqtt-qos <0|1>   MQTT QoS (default: 0)\n";
+            qStdErr << "  --mqtt-version <3|5>  MQTT 3.1.1 or 5.0 (default: 3)\n";
+            qStdErr << "  --mqtt-spool <dir>   Spool messages to disk while the broker is down (up to 64 MB)\n";
+            qStdErr << "  --mqtt-broker <[host:]port>  Run a minimal MQTT broker stand-in for testing (no jt9)\n";
+            qStdErr << "  --alloc-check <n>  Stream mode, jt9_decode_alloc only: exit with status 3 if any\n";
+            qStdErr << "                     cycle after the first n allocates on the cycle path\n";
+            qStdErr << "  --cluster <host:port,...>  Stream mode: send main decodes to these decode nodes\n";
+            qStdErr << "                     when they can meet the deadline; otherwise decode locally\n";
+            qStdErr << "  --serve <[host:]port>  Decode node: accept cycles from capture nodes (uses --workers)\n";
+            qStdErr << "  --handover-socket <path>  Stream mode: accept zero-downtime upgrade requests\n";
+            qStdErr << "  --take-over <path>   Take ring, input and stdout over from the instance\n";
+            qStdErr << "                     listening on path, then listen there (implies -s)\n";
+            qStdErr << "  --bench-ingest <n,n,...>  Benchmark the ingest path (no jt9) with n synthetic\n";
+            qStdErr << "                     streams per step; prints <IngestBench> lines\n";
+            qStdErr << "  --bench-speed <x>    Synthetic source rate, multiple of real time (default: 1)\n";
+            qStdErr << "  --bench-seconds <s>  Duration of each step (default: 30)\n";
+            qStdErr << "  --bench-ring <c>     Ring size per stream in cycles (default: 2)\n";
             qStdErr << "  --help        Show this help message\n";
             qStdErr << "\n";
             qStdErr << "Examples:\n";
@@ -572,6 +9853,13 @@ int main(int argc, char *argv[]) {
             qStdErr << "  rtl_fm -f 144.174M -s 12k | " << argv[0] << " -j /usr/local/bin/jt9 -m FT2 -s\n";
             qStdErr << "  rtl_fm -f 14.074M -s 12k | " << argv[0] << " -j /usr/local/bin/jt9 -m FT8 -s\n";
             qStdErr << "  sox input.wav -t raw -r 12000 -e signed -b 16 -c 1 - | " << argv[0] << " -j jt9 -m FT4 -s\n";
+            qStdErr << "  " << argv[0] << " -j /usr/local/bin/jt9 -m FT8 --rtl-tcp sdr.local:1234 --rtl-freq 14.074M\n";
+            qStdErr << "  " << argv[0] << " -j /usr/local/bin/jt9 -m FT8 --capture 'rtl_fm -M usb -f 14.074M -s 12k'\n";
+            qStdErr << "  " << argv[0] << " -j /usr/local/bin/jt9 -m FT8 --follow session.wav\n";
+            qStdErr << "  " << argv[0] << " -j /usr/local/bin/jt9 -m FT8 --workers 4 --archive recordings.tar.zst\n";
+            qStdErr << "  arecord -f S16_LE -r 12000 -c 1 -t raw | " << argv[0] << " -j jt9 -m FT8 -s --hop 7.074M,14.074M,21.074M\n";
+            qStdErr << "  " << argv[0] << " -j jt9 --workers 8 --serve 7400      # on the decode node\n";
+            qStdErr << "  rtl_fm -f 14.074M -s 12k | " << argv[0] << " -j jt9 -m FT8 -s --cluster decoder.local:7400\n";
             qStdErr.flush();
             return 0;
         } else if (!arg.startsWith("-")) {
@@ -585,7 +9873,99 @@ int main(int argc, char *argv[]) {
         i++;
     }
     
-    if (!stream_mode && wav_file.isEmpty()) {
+    if (!bench_streams.isEmpty()) {
+        // Ingest benchmark: synthetic streams only, jt9 is not started
+        qStdErr << "Ingest benchmark: " << mode->name << " cycles, " << bench_speed << "x real time, "
+                << bench_seconds << " s per step, ring " << bench_ring << " cycles per stream\n";
+        qStdErr.flush();
+        DspPool bench_pool(dsp_threads > 0 ? dsp_threads
+                                           : !dsp_cpus.isEmpty() ? dsp_cpus.size()
+                                           : qMax(2, QThread::idealThreadCount()), dsp_cpus);
+        IngestBenchmark bench(*mode, bench_speed, bench_seconds, bench_ring, &bench_pool);
+        for (int streams : bench_streams) {
+            qStdErr << "Running " << streams << " stream(s)...\n";
+            qStdErr.flush();
+            bench.run(streams);
+        }
+        return 0;
+    }
+    
+    if (!bench_watchlist.isEmpty()) {
+        // Watchlist benchmark: synthetic rules and traffic, jt9 is not started
+        WatchlistBenchmark bench;
+        for (int patterns : bench_watchlist) {
+            bench.run(patterns);
+        }
+        return 0;
+    }
+    
+    if (!merge_dir.isEmpty()) {
+        return merge_queue_results(merge_dir);
+    }
+    
+    if (!chansim_spec.isEmpty()) {
+        return run_channel_simulator(chansim_spec, *mode, wav_file, chansim_out, chansim_realtime);
+    }
+    
+    if (!mqtt_broker_addr.isEmpty()) {
+        // Broker stand-in: prints what publishers send, forwards to subscribers
+        MqttBroker broker;
+        if (!broker.listen(mqtt_broker_addr)) {
+            qStdErr << "Error: Cannot listen on " << mqtt_broker_addr << ": " << strerror(errno) << "\n";
+            qStdErr.flush();
+            return 1;
+        }
+        qStdErr << "MQTT broker stand-in listening on " << mqtt_broker_addr << "\n";
+        qStdErr.flush();
+        return app.exec();
+    }
+    
+    if ((!archives.isEmpty() || !queue_dir.isEmpty()) && (stream_mode || !wav_file.isEmpty())) {
+        qStdErr << "Error: --archive and --queue cannot be combined with -s or a WAV file\n";
+        qStdErr.flush();
+        return 1;
+    }
+    
+    if (!archives.isEmpty() && !queue_dir.isEmpty()) {
+        qStdErr << "Error: --archive and --queue are separate modes\n";
+        qStdErr.flush();
+        return 1;
+    }
+    
+    bool offline_batch = !archives.isEmpty() || !queue_dir.isEmpty();
+    bool serve_mode = !serve_addr.isEmpty();
+    if (serve_mode && (stream_mode || offline_batch || !wav_file.isEmpty())) {
+        qStdErr << "Error: --serve runs a decode node and cannot be combined with other inputs\n";
+        qStdErr.flush();
+        return 1;
+    }
+    
+    if (stagger_priority >= 0 && !stream_mode) {
+        qStdErr << "Error: --stagger requires stream mode (-s)\n";
+        qStdErr.flush();
+        return 1;
+    }
+    
+    if (!cluster_nodes.isEmpty() && !stream_mode) {
+        qStdErr << "Error: --cluster requires stream mode (-s)\n";
+        qStdErr.flush();
+        return 1;
+    }
+
+    if (!mqtt_addr.isEmpty() && (!stream_mode || !mqtt_cfg.setBroker(mqtt_addr))) {
+        qStdErr << "Error: --mqtt requires stream mode (-s) and [user:pass@]host[:port]\n";
+        qStdErr.flush();
+        return 1;
+    }
+    
+    if (alloc_check > 0 && (!AllocScope::enabled || !stream_mode)) {
+        qStdErr << "Error: --alloc-check requires stream mode (-s) and a build with allocation\n";
+        qStdErr << "counting (make alloc-count)\n";
+        qStdErr.flush();
+        return 1;
+    }
+    
+    if (!stream_mode && wav_file.isEmpty() && !offline_batch && !serve_mode) {
         qStdErr << "Error: No WAV file specified (use -s for stream mode)\n";
         qStdErr << "Usage: " << argv[0] << " -j <jt9_path> [options] [<wav_file>|-s]\n";
         qStdErr << "Use --help for more information\n";
@@ -599,6 +9979,30 @@ int main(int argc, char *argv[]) {
         return 1;
     }
     
+    if (!hop_dials.isEmpty() && !stream_mode) {
+        qStdErr << "Error: --hop requires stream mode (-s)\n";
+        qStdErr.flush();
+        return 1;
+    }
+    
+    if ((!capture_cmd.isEmpty()) + (!rtl.host.isEmpty()) + (!follow_path.isEmpty()) > 1) {
+        qStdErr << "Error: --capture, --rtl-tcp and --follow are separate inputs\n";
+        qStdErr.flush();
+        return 1;
+    }
+    
+    if (!follow_path.isEmpty() && !QFileInfo(follow_path).isFile()) {
+        qStdErr << "Error: Cannot open file: " << follow_path << "\n";
+        qStdErr.flush();
+        return 1;
+    }
+    
+    if (!rtl.host.isEmpty() && rtl.dial_hz <= RtlTcpReceiver::IF_OFFSET_HZ) {
+        qStdErr << "Error: --rtl-tcp needs a dial frequency (--rtl-freq)\n";
+        qStdErr.flush();
+        return 1;
+    }
+    
     if (jt9_path.isEmpty()) {
         qStdErr << "Error: jt9 path not specified\n";
         qStdErr << "Usage: " << argv[0] << " -j <jt9_path> [options] [<wav_file>|-s]\n";
@@ -607,22 +10011,44 @@ int main(int argc, char *argv[]) {
         return 1;
     }
     
-    // Create shared memory with Qt
-    QSharedMemory sharedMemory;
-    sharedMemory.setKey(app.applicationName());
-    
-    // Try to attach first (in case it exists from previous run)
-    if (sharedMemory.attach()) {
-        qStdErr << "Detaching from existing shared memory\n";
-        sharedMemory.detach();
+    // Alert matcher on the output path (loaded before any jt9 is started)
+    WatchlistMonitor *watch = nullptr;
+    if (!watchlist_path.isEmpty()) {
+        watch = new WatchlistMonitor(watchlist_path);
+        QString error;
+        if (!watch->open(alerts_dest, error)) {
+            qStdErr << "Error: Watchlist " << watchlist_path << ": " << error << "\n";
+            qStdErr.flush();
+            delete watch;
+            return 1;
+        }
     }
     
-    // Create new shared memory
-    if (!sharedMemory.create(sizeof(dec_data_t))) {
-        qStdErr << "Failed to create shared memory: " << sharedMemory.errorString() << "\n";
+    // Reclaim segments and temp dirs of instances that died without cleaning
+    // up, then register this one before creating its own
+    InstanceRegistry::SweepStats reclaimed = InstanceRegistry::sweep(false);
+    if (reclaimed.entries > 0 || reclaimed.dirs > 0) {
+        qStdErr << "Reclaimed " << reclaimed.segments << " shared memory segment(s) and " << reclaimed.dirs
+                << " temp dir(s) left by " << reclaimed.entries << " dead instance(s), "
+                << reclaimed.bytes / (1024 * 1024) << " MB\n";
         qStdErr.flush();
+    }
+    InstanceRegistry::open(instance_id);
+
+    // Create unique temporary directory path in /dev/shm for this instance
+    QString temp_dir_path = QString("/dev/shm/jt9_decode_%1").arg(instance_id);
+    
+    // Stream, archive and serve modes read jt9 output on a collector thread;
+    // WAV mode reads it all once jt9 exits
+    Jt9OutputCollector output_collector;
+    Jt9OutputCollector *collector = (stream_mode || offline_batch || serve_mode) ? &output_collector : nullptr;
+
+    // Primary jt9 worker: owns the shared memory segment, temp dir and process
+    Jt9Worker primary(app.applicationName(), temp_dir_path);
+    if (!primary.create()) {
         return 1;
     }
+    QSharedMemory &sharedMemory = *primary.memory();
     
     qStdErr << "Shared memory created with key: " << app.applicationName() << "\n";
     qStdErr << "Structure size: " << sizeof(dec_data_t) << " bytes\n";
@@ -630,8 +10056,7 @@ int main(int argc, char *argv[]) {
     
     // Lock and initialize
     sharedMemory.lock();
-    dec_data_t *dec_data = static_cast<dec_data_t*>(sharedMemory.data());
-    memset(dec_data, 0, sizeof(dec_data_t));
+    dec_data_t *dec_data = primary.data();
     
     // Set up common parameters for decoding (matching WSJT-X lines 5430-5490)
     dec_data->params.nmode = mode->mode_code;  // Mode code (52=FT2, 5=FT4, 8=FT8)
@@ -682,32 +10107,10 @@ int main(int argc, char *argv[]) {
     
     sharedMemory.unlock();
     
-    // Create unique temporary directory in /dev/shm for this instance
-    QString temp_dir_path = QString("/dev/shm/jt9_decode_%1_%2")
-        .arg(QCoreApplication::applicationPid())
-        .arg(QDateTime::currentMSecsSinceEpoch());
-    
-    QDir temp_dir;
-    if (!temp_dir.mkpath(temp_dir_path)) {
-        qStdErr << "Warning: Could not create temp directory in /dev/shm, falling back to /tmp\n";
-        temp_dir_path = "/tmp";
-    } else {
-        qStdErr << "Created temp directory: " << temp_dir_path << "\n";
-    }
-    
     // Start jt9 process
     qStdErr << "Starting jt9 decoder...\n";
     qStdErr.flush();
     
-    QProcess jt9;
-    QStringList args;
-    args << "-s" << app.applicationName()
-         << "-w" << "1"
-         << "-m" << "1"
-         << "-e" << "."
-         << "-a" << "."
-         << "-t" << temp_dir_path;
-    
     // Verify jt9 binary exists
     if (!QFile::exists(jt9_path)) {
         qStdErr << "jt9 binary not found at: " << jt9_path << "\n";
@@ -718,15 +10121,29 @@ int main(int argc, char *argv[]) {
     qStdErr << "Using jt9 at: " << jt9_path << "\n";
     qStdErr.flush();
     
-    // Capture jt9 output
-    jt9.setProcessChannelMode(QProcess::MergedChannels);
-    jt9.start(jt9_path, args);
-    
-    if (!jt9.waitForStarted()) {
-        qStdErr << "Failed to start jt9: " << jt9.errorString() << "\n";
-        qStdErr.flush();
+    if (!primary.start(jt9_path, collector)) {
         return 1;
     }
+    QProcess &jt9 = *primary.process();
+
+    // Additional decode workers (stream, archive and serve modes) and spare workers for AP hint passes
+    QList<Jt9Worker*> workers;
+    QList<Jt9Worker*> hint_workers;
+    workers.append(&primary);
+    if (stream_mode || offline_batch || serve_mode) {
+        bool ok = start_workers(workers, 2, decode_worker_count - 1, "w", app.applicationName(), temp_dir_path, jt9_path, collector);
+        if (ok && stream_mode && hint_top_k > 0) {
+            ok = start_workers(hint_workers, 1, hint_worker_count, "h", app.applicationName(), temp_dir_path, jt9_path, collector);
+        }
+        if (!ok) {
+            workers.removeFirst();
+            stop_workers(workers);
+            stop_workers(hint_workers);
+            primary.stop();
+            primary.removeTempDir();
+            return 1;
+        }
+    }
     
     qStdErr << "\nDecoder parameters:\n";
     qStdErr << "  Mode: " << mode->name << " (" << mode->mode_code << ")\n";
@@ -736,28 +10153,255 @@ int main(int argc, char *argv[]) {
     if (multithread && mode->mode_code == 8) {
         qStdErr << "  Multithreaded: enabled (FT8)\n";
     }
+    if (stream_mode && decode_worker_count > 1) {
+        qStdErr << "  Decode workers: " << decode_worker_count << "\n";
+    }
+    if (stream_mode && hint_top_k > 0) {
+        qStdErr << "  AP hints: top " << hint_top_k << " targets, "
+                << hint_worker_count << " spare worker(s), " << hint_age << " cycle memory\n";
+    }
     qStdErr.flush();
     
     int result = 0;
+    SpectrumMonitor *spectrum = nullptr;
+    SampleSource *source = nullptr;
     
     if (stream_mode) {
         // Streaming mode: asynchronous event-driven processing (WSJT-X style)
-        StreamDecoder decoder(&sharedMemory, dec_data, &jt9, *mode);
-        decoder.start();
+        // One DSP pool for cycle staging and spectra; it drains before it goes
+        DspPool dsp_pool(dsp_threads > 0 ? dsp_threads : !dsp_cpus.isEmpty() ? dsp_cpus.size() : 2, dsp_cpus);
+
+        // Optional ingest-side spectrum monitor (fed by the reader thread)
+        if (!spectrum_dest.isEmpty()) {
+            double avg_sec = spectrum_avg > 0.0 ? spectrum_avg : mode->cycle_ms / 1000.0;
+            spectrum = new SpectrumMonitor(spectrum_fft, spectrum_rate, avg_sec, freq_low, freq_high);
+            if (!spectrum->open(spectrum_dest)) {
+                qStdErr << "Error: Cannot open spectrum output " << spectrum_dest << "\n";
+                qStdErr.flush();
+                delete spectrum;
+                jt9.kill();
+                jt9.waitForFinished();
+                return 1;
+            }
+            spectrum->setPool(&dsp_pool);
+            qStdErr << "Spectrum output: " << spectrum_dest << " (" << spectrum->binCount() << " bins of "
+                    << QString::number(spectrum->binHz(), 'f', 2) << " Hz, "
+                    << spectrum_rate << " rows/s, average every " << avg_sec << " s)\n";
+            qStdErr.flush();
+        }
+
+        HintEngine *hints = hint_top_k > 0 ? new HintEngine(hint_top_k, hint_age) : nullptr;
+
+        // Zero-downtime upgrade: take the ring, input and stdout of a running instance
+        HandoverState handed;
+        int handed_fds[3];
+        int handed_nfds = 0;
+        if (!take_over_path.isEmpty()) {
+            qStdErr << "Requesting handover from " << take_over_path << "...\n";
+            qStdErr.flush();
+            if (!take_over(take_over_path, handed, handed_fds, handed_nfds)) {
+                qStdErr << "Error: Handover from " << take_over_path << " failed\n";
+                qStdErr.flush();
+                delete hints;
+                delete spectrum;
+                primary.stop();
+                workers.removeFirst();
+                stop_workers(workers);
+                stop_workers(hint_workers);
+                primary.removeTempDir();
+                return 1;
+            }
+            qStdOut.flush();
+            dup2(handed_fds[1], STDOUT_FILENO);
+            ::close(handed_fds[1]);
+        }
+
+        // Sample source: stdin PCM (possibly handed over), a supervised capture
+        // command, a WAV file being recorded, or the built-in rtl_tcp client
+        if (handed_nfds == 3) {
+            source = new StdinSource(handed_fds[2], handed.pending_byte);
+        } else if (!capture_cmd.isEmpty()) {
+            source = new CaptureSource(capture_cmd);
+        } else if (!follow_path.isEmpty()) {
+            source = new WavFollowSource(follow_path, mode->cycle_ms, follow_idle);
+        } else if (rtl.host.isEmpty()) {
+            source = new StdinSource();
+        } else {
+            source = new RtlTcpSource(rtl);
+        }
+        source->open();
+
+        TxSchedule *schedule = nullptr;
+        if (decode_seq != TxSchedule::SEQ_BOTH || !tx_file.isEmpty()) {
+            schedule = new TxSchedule(mode->cycle_ms, decode_seq, tx_file, tx_monitor);
+            qStdErr << "Decode schedule: " << (decode_seq == TxSchedule::SEQ_EVEN ? "even" :
+                                                decode_seq == TxSchedule::SEQ_ODD ? "odd" : "all")
+                    << " sequences";
+            if (!tx_file.isEmpty()) {
+                qStdErr << ", TX control " << tx_file << " (" << (tx_monitor ? "monitor" : "skip") << " TX cycles)";
+            }
+            qStdErr << "\n";
+            qStdErr.flush();
+        }
+
+        StreamDecoder decoder(source, workers, *mode, &dsp_pool, spectrum, hints, hint_workers, schedule);
+        bool ready = handed_nfds == 0 || decoder.resumeFrom(handed, handed_fds[0]);
+        decoder.setRemoveDc(remove_dc);
+        if (watch) decoder.setWatchlist(watch);
+        if (alloc_check > 0) decoder.setAllocCheck(alloc_check);
+        decoder.setReadBlockMs(read_block_ms);
         
-        // Run Qt event loop - processes jt9 output asynchronously
-        result = app.exec();
+        StaggerBoard *stagger = nullptr;
+        if (ready && stagger_priority >= 0) {
+            stagger = new StaggerBoard(stagger_priority, stagger_lanes);
+            QString error;
+            if (stagger->open(error)) {
+                decoder.setStagger(stagger);
+                qStdErr << "Stagger: " << stagger->describe() << "\n";
+            } else {
+                qStdErr << "Warning: Cannot open the stagger table (" << error << "), decoding unstaggered\n";
+                delete stagger;
+                stagger = nullptr;
+            }
+            qStdErr.flush();
+        }
+
+        BandHopper *hopper = nullptr;
+        RigctldClient *rig = nullptr;
+        if (ready && !hop_dials.isEmpty()) {
+            hopper = new BandHopper(hop_dials);
+            rig = new RigctldClient(rigctld_host, rigctld_port);
+            decoder.setBandHopper(hopper, rig, hop_settle_ms);
+            qStdErr << "Band hopping: " << hop_dials.size() << " band(s) via " << rig->describe()
+                    << ", " << hop_settle_ms << " ms settle\n";
+            qStdErr.flush();
+        }
+
+        BatchSpool *batch = nullptr;
+        if (ready && !batch_dir.isEmpty()) {
+            batch = new BatchSpool(batch_dir);
+            if (batch->open()) {
+                decoder.setBatchSpool(batch);
+                qStdErr << "Batch spool: " << batch_dir << " (decoded in idle worker time)\n";
+            } else {
+                qStdErr << "Warning: Cannot use batch directory " << batch_dir << "\n";
+            }
+            qStdErr.flush();
+        }
+
+        MqttPublisher *mqtt = nullptr;
+        if (ready && !mqtt_addr.isEmpty()) {
+            if (mqtt_stream.isEmpty()) {
+                char host[256] = "";
+                gethostname(host, sizeof(host) - 1);
+                mqtt_stream = host[0] ? QString(host).section('.', 0, 0) : QString("stream");
+            }
+            mqtt_cfg.client_id = QString("jt9_decode_%1").arg(getpid());
+            mqtt = new MqttPublisher(mqtt_cfg);
+            QString topic_base = mqtt_prefix + "/" + mqtt_stream + "/" + mode->name;
+            decoder.setMqtt(mqtt, topic_base, mqtt_band);
+            mqtt->start();
+            qStdErr << "MQTT: " << mqtt->describe() << ", topics " << topic_base << "/"
+                    << (hop_dials.isEmpty() ? mqtt_band : QString("<band>")) << "\n";
+            qStdErr.flush();
+        }
+
+        if (ready && !cluster_nodes.isEmpty()) {
+            decoder.setCluster(cluster_nodes);
+            qStdErr << "Cluster: " << cluster_nodes.join(", ") << " (main decodes, local fallback)\n";
+            qStdErr.flush();
+        }
+
+        // A taken-over instance keeps listening on the same path for the next upgrade
+        QString listen_path = handover_path.isEmpty() ? take_over_path : handover_path;
+        if (ready && !listen_path.isEmpty() && !decoder.listenForHandover(listen_path)) {
+            qStdErr << "Warning: Cannot listen for handover on " << listen_path << "\n";
+            qStdErr.flush();
+        }
+
+        if (ready) {
+            decoder.start();
+
+            // Run Qt event loop - processes jt9 output asynchronously
+            result = app.exec();
+        } else {
+            result = 1;
+        }
         
         // Cleanup: terminate jt9
         qStdErr << "Terminating jt9...\n";
-        sharedMemory.lock();
-        dec_data->ipc[1] = 999;
-        sharedMemory.unlock();
-        
-        if (!jt9.waitForFinished(2000)) {
-            jt9.kill();
-            jt9.waitForFinished();
+        primary.stop();
+        workers.removeFirst();
+        stop_workers(workers);
+        stop_workers(hint_workers);
+        delete hints;
+        delete schedule;
+        delete batch;
+        delete stagger;
+        delete mqtt;
+    } else if (serve_mode) {
+        // Decode node: capture nodes send conditioned cycles with their parameters
+        ClusterServer server(workers);
+        if (server.listen(serve_addr)) {
+            qStdErr << "Decode node listening on " << serve_addr << " with " << workers.size() << " jt9 worker(s)\n";
+            qStdErr.flush();
+            result = app.exec();
+        } else {
+            qStdErr << "Error: Cannot listen on " << serve_addr << ": " << strerror(errno) << "\n";
+            qStdErr.flush();
+            result = 1;
+        }
+        primary.stop();
+        workers.removeFirst();
+        stop_workers(workers);
+    } else if (offline_batch) {
+        // Archive / queue mode: members stream from the reader thread into the worker pool
+        WorkQueue *queue = nullptr;
+        ArchiveInputFn next_input;
+        if (!queue_dir.isEmpty()) {
+            queue = new WorkQueue(queue_dir, lease_s);
+            if (!queue->open()) {
+                qStdErr << "Error: Cannot use queue directory " << queue_dir << "\n";
+                qStdErr.flush();
+                result = 1;
+            }
+            next_input = [queue](ArchiveInput &input, const std::atomic<bool> &aborting) {
+                return queue->claim(input, aborting);
+            };
+            qStdErr << "Queue " << queue_dir << " as node " << queue->nodeName() << " on "
+                    << workers.size() << " jt9 worker(s), lease " << lease_s << " s\n";
+        } else {
+            std::shared_ptr<int> next = std::make_shared<int>(0);
+            next_input = [archives, next](ArchiveInput &input, const std::atomic<bool> &) {
+                if (*next >= archives.size()) return false;
+                input.path = archives[(*next)++];
+                input.name = QFileInfo(input.path).fileName();
+                return true;
+            };
+            qStdErr << "Decoding " << archives.size() << " archive(s) on " << workers.size() << " jt9 worker(s)\n";
+        }
+        qStdErr.flush();
+        if (result == 0) {
+            ArchiveDecoder decoder(next_input, workers, *mode);
+            if (watch) decoder.setWatchlist(watch);
+            QTimer heartbeat;
+            if (queue) {
+                decoder.setInputDone([queue](const ArchiveItemPtr &end, const QStringList &lines) {
+                    queue->commit(end, lines);
+                });
+                QObject::connect(&heartbeat, &QTimer::timeout, [queue]() { queue->heartbeat(); });
+                heartbeat.start(lease_s * 1000 / 4);
+            }
+            decoder.start();
+            result = app.exec();
         }
+        if (queue) {
+            queue->printStats();
+            delete queue;
+        }
+        primary.stop();
+        workers.removeFirst();
+        stop_workers(workers);
     } else {
         // WAV file mode: read file and decode once
         sharedMemory.lock();
@@ -821,6 +10465,8 @@ int main(int argc, char *argv[]) {
         
         for (const QString &line : lines) {
             if (line.length() > 6 && line[0].isDigit() && !line.startsWith('<')) {
+                DecodeRecord rec;
+                if (watch && parse_decode_line(line, rec)) watch->check(rec, line);
                 qStdOut << line << "\n";
                 qStdOut.flush();
             } else {
@@ -831,18 +10477,12 @@ int main(int argc, char *argv[]) {
         qStdErr << "jt9 finished with exit code: " << jt9.exitCode() << "\n";
         qStdErr.flush();
     }
+    delete source;
+    delete spectrum;
+    delete watch;
     
-    // Cleanup temp directory if we created one in /dev/shm
-    if (temp_dir_path.startsWith("/dev/shm/jt9_decode_")) {
-        QDir temp_dir(temp_dir_path);
-        if (temp_dir.exists()) {
-            if (temp_dir.removeRecursively()) {
-                qStdErr << "Cleaned up temp directory: " << temp_dir_path << "\n";
-            } else {
-                qStdErr << "Warning: Could not remove temp directory: " << temp_dir_path << "\n";
-            }
-        }
-    }
+    primary.removeTempDir();
+    InstanceRegistry::close();
     
     return result;
 }